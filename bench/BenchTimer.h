@@ -0,0 +1,40 @@
+#ifndef BENCH_TIMER_H
+#define BENCH_TIMER_H
+
+#include <algorithm>
+#include <chrono>
+
+// Timing helpers shared by the benches
+
+// Seconds since the first call
+inline double get_time()
+{
+  static const auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Runs prepare and then function N times and returns the fastest function run in
+// milliseconds, prepare (e.g. restoring the input) isn't timed
+template <typename Prepare, typename Function>
+double best_of_prepared(int runs, Prepare prepare, Function function)
+{
+  double best = 1e30;
+  for (int i = 0; i < runs; i++)
+  {
+    prepare();
+    double start = get_time();
+    function();
+    best = std::min(best, (get_time() - start) * 1000.0);
+  }
+  return best;
+}
+
+// Runs function(args...) N times and returns the fastest run in milliseconds
+template <typename Function, typename... Args>
+double best_of(int runs, Function function, Args &...args)
+{
+  return best_of_prepared(runs, []() {}, [&]()
+                          { function(args...); });
+}
+
+#endif
@@ -0,0 +1,165 @@
+// Dynamic BVH benchmark: moves N objects every frame and keeps a BVH over them current two
+// ways, refitting the tree built on the first frame or rebuilding it every frame, then times
+// frustum and ray queries against both. Refitting is much cheaper, but the tree gets worse
+// as objects drift from where it was built, which shows in the SAH cost and the query times.
+//
+//   bvh_bench [--runs N] [--objects N] [--frames N]
+//
+// Objects are spread through a 1000 unit cube and fly in straight lines at up to 20 units
+// per second, one frame is 1/60 s. Every time is the best of N runs.
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "BVH.h"
+#include "FrustumCulling.h"
+#include "BenchTimer.h"
+
+// Directions the camera looks in, one frustum each
+const int VIEW_COUNT = 8;
+// Rays cast per query pass, from the center of the cube in random directions
+const int RAY_COUNT = 1000;
+
+// A moving object, a box around its position
+struct MovingObject
+{
+  glm::vec3 position;
+  glm::vec3 velocity;
+  glm::vec3 extent;
+};
+
+// Frustum and ray query times of a tree, in milliseconds per view and microseconds per ray
+static void time_queries(int runs, const BVH &bvh, const std::vector<Frustum> &views, const std::vector<glm::vec3> &rays,
+                         std::vector<uint32_t> &visible, double &frustumMs, double &rayUs)
+{
+  frustumMs = best_of(runs, [&]()
+                      {
+    for (const Frustum &frustum : views)
+      bvh.QueryFrustum(frustum, visible.data()); }) /
+              views.size();
+  rayUs = best_of(runs, [&]()
+                  {
+    uint32_t object;
+    float distance;
+    for (const glm::vec3 &direction : rays)
+      bvh.Raycast(glm::vec3(0.0f, 0.0f, 0.0f), direction, INFINITY, object, distance); }) *
+          1000.0 / rays.size();
+}
+
+static void print_result(const char *name, double updateMs, float cost, double frustumMs, double rayUs)
+{
+  std::cout << "  " << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << updateMs << " ms" << std::setw(10) << cost << std::setw(10) << frustumMs
+            << " ms" << std::setw(10) << rayUs << " us" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  int runs = 5;
+  size_t objectCount = 100000;
+  int frames = 600;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+      runs = std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--objects") == 0 && i + 1 < argc)
+      objectCount = (size_t)std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+      frames = std::max(1, atoi(argv[++i]));
+    else
+    {
+      std::cerr << "Usage: " << argv[0] << " [--runs N] [--objects N] [--frames N]" << std::endl;
+      return 1;
+    }
+  }
+
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+  std::uniform_real_distribution<float> velocity(-20.0f / std::sqrt(3.0f), 20.0f / std::sqrt(3.0f));
+  std::uniform_real_distribution<float> size(0.25f, 2.5f);
+  std::vector<MovingObject> objects(objectCount);
+  BVH refitted, rebuilt;
+  for (MovingObject &object : objects)
+  {
+    object.position = glm::vec3(position(random), position(random), position(random));
+    object.velocity = glm::vec3(velocity(random), velocity(random), velocity(random));
+    object.extent = glm::vec3(size(random), size(random), size(random));
+    refitted.Add(object.position - object.extent, object.position + object.extent);
+    rebuilt.Add(object.position - object.extent, object.position + object.extent);
+  }
+
+  std::vector<Frustum> views;
+  glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+  for (int view = 0; view < VIEW_COUNT; view++)
+  {
+    float angle = glm::radians(360.0f * view / VIEW_COUNT);
+    glm::vec3 target(std::sin(angle), 0.2f, -std::cos(angle));
+    views.push_back(extract_frustum(projection * glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), target, glm::vec3(0.0f, 1.0f, 0.0f))));
+  }
+  std::vector<glm::vec3> rays;
+  std::normal_distribution<float> normal;
+  for (int i = 0; i < RAY_COUNT; i++)
+  {
+    glm::vec3 direction(normal(random), normal(random), normal(random));
+    float length = std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+    rays.push_back(direction * (1.0f / length));
+  }
+
+  double buildMs = best_of(runs, [&]()
+                           { refitted.Build(); });
+  std::cout << objectCount << " objects, " << refitted.nodes.size() << " nodes of " << sizeof(BVHNode)
+            << " bytes, built in " << std::fixed << std::setprecision(2) << buildMs << " ms, best of " << runs << std::endl;
+
+  // The flat SoA test every query is up against
+  std::vector<uint32_t> visible(objectCount);
+  CullingBounds bounds;
+  for (const MovingObject &object : objects)
+    bounds.Add(object.position - object.extent, object.position + object.extent);
+  double flatMs = best_of(runs, [&]()
+                          {
+    for (const Frustum &frustum : views)
+      cull_boxes(frustum, bounds, visible.data()); }) /
+                  views.size();
+  std::cout << "  flat " << culling_simd_path() << " cull_boxes: " << flatMs << " ms per view" << std::endl;
+
+  // Both trees have to find exactly what the flat test finds
+  size_t flatCount = cull_boxes(views[0], bounds, visible.data());
+  size_t treeCount = refitted.QueryFrustum(views[0], visible.data());
+  if (treeCount != flatCount)
+    std::cout << "  Warning: QueryFrustum found " << treeCount << " objects, cull_boxes " << flatCount << std::endl;
+
+  std::cout << "  " << std::left << std::setw(10) << "tree" << std::right << std::setw(13) << "update"
+            << std::setw(10) << "SAH cost" << std::setw(13) << "frustum" << std::setw(13) << "ray" << std::endl;
+  for (int frame = 1; frame <= frames; frame++)
+  {
+    for (size_t i = 0; i < objectCount; i++)
+    {
+      MovingObject &object = objects[i];
+      object.position = object.position + object.velocity * (1.0f / 60.0f);
+      refitted.Update((uint32_t)i, object.position - object.extent, object.position + object.extent);
+      rebuilt.Update((uint32_t)i, object.position - object.extent, object.position + object.extent);
+    }
+
+    // Reports after 1 frame and then every doubling, up to the last frame
+    if ((frame & (frame - 1)) != 0 && frame != frames)
+      continue;
+    std::cout << "frame " << frame << " (" << frame / 60.0 << " s)" << std::endl;
+    double refitMs = best_of(runs, [&]()
+                             { refitted.Refit(); });
+    double frustumMs, rayUs;
+    time_queries(runs, refitted, views, rays, visible, frustumMs, rayUs);
+    print_result("refit", refitMs, refitted.Cost(), frustumMs, rayUs);
+    double rebuildMs = best_of(runs, [&]()
+                               { rebuilt.Build(); });
+    time_queries(runs, rebuilt, views, rays, visible, frustumMs, rayUs);
+    print_result("rebuild", rebuildMs, rebuilt.Cost(), frustumMs, rayUs);
+  }
+  return 0;
+}
@@ -0,0 +1,114 @@
+// Job system benchmark: what spawning a job costs, and how work split into jobs scales with
+// the number of threads.
+//
+//   job_bench [--runs N] [--jobs N] [--threads N]
+//
+// Spawn overhead is timed with empty jobs: created and run one at a time by the thread that
+// waits for them, as children of one root, and as a ParallelFor of single item ranges. Scaling
+// runs a ParallelFor over a fixed amount of arithmetic with 1, 2, 4... threads up to N. Every
+// time is the best of N runs.
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+#include "BenchTimer.h"
+
+// Items the scaling test splits, and items per job
+const uint32_t SCALING_ITEMS = 1 << 20;
+const uint32_t SCALING_BATCH = 1024;
+// Iterations of arithmetic per item, a job is a few hundred microseconds of work
+const int SCALING_WORK = 64;
+
+// Job that does nothing, what is left is the system's own cost
+static void empty_job(JobSystem &, Job *, const void *)
+{
+}
+
+// Prints one spawn overhead result in nanoseconds per job
+static void print_overhead(const char *name, double ms, uint32_t jobCount)
+{
+  std::cout << "  " << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(10) << ms * 1e6 / jobCount << " ns/job" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  int runs = 10;
+  uint32_t jobCount = 100000;
+  unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+      runs = std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+      jobCount = (uint32_t)std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+      threads = (unsigned int)std::max(1, atoi(argv[++i]));
+    else
+    {
+      std::cerr << "Usage: " << argv[0] << " [--runs N] [--jobs N] [--threads N]" << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << "Spawn overhead, " << jobCount << " empty jobs, " << threads << " threads, best of " << runs << std::endl;
+  {
+    JobSystem jobs(threads);
+    double ms = best_of(runs, [&]()
+                        {
+      for (uint32_t i = 0; i < jobCount; i++)
+      {
+        Job *job = jobs.Create(&empty_job);
+        jobs.Run(job);
+        jobs.Wait(job);
+      } });
+    print_overhead("run and wait each", ms, jobCount);
+
+    ms = best_of(runs, [&]()
+                 {
+      Job *root = jobs.Create(nullptr);
+      for (uint32_t i = 0; i < jobCount; i++)
+        jobs.Run(jobs.Create(&empty_job, nullptr, 0, root));
+      jobs.Run(root);
+      jobs.Wait(root); });
+    print_overhead("children of a root", ms, jobCount);
+
+    ms = best_of(runs, [&]()
+                 { jobs.ParallelFor(jobCount, 1, [](uint32_t, uint32_t) {}); });
+    print_overhead("ParallelFor batch 1", ms, jobCount);
+    jobs.Delete();
+  }
+
+  // Same work on more and more threads, the result is kept so the work isn't optimized away
+  std::cout << "Scaling, " << SCALING_ITEMS << " items in jobs of " << SCALING_BATCH << std::endl;
+  std::vector<float> results(SCALING_ITEMS);
+  double single = 0.0;
+  for (unsigned int count = 1;; count = std::min(count * 2, threads))
+  {
+    JobSystem jobs(count);
+    double ms = best_of(runs, [&]()
+                        { jobs.ParallelFor(SCALING_ITEMS, SCALING_BATCH, [&](uint32_t first, uint32_t size)
+                                           {
+        for (uint32_t i = first; i < first + size; i++)
+        {
+          float x = (float)i;
+          for (int j = 0; j < SCALING_WORK; j++)
+            x = std::sqrt(x * 1.0001f + 1.0f);
+          results[i] = x;
+        } }); });
+    if (count == 1)
+      single = ms;
+    std::cout << "  " << std::setw(3) << count << " threads" << std::fixed << std::setprecision(3) << std::setw(12)
+              << ms << " ms" << std::setprecision(2) << std::setw(8) << single / ms << "x" << std::endl;
+    jobs.Delete();
+    if (count == threads)
+      break;
+  }
+  return 0;
+}
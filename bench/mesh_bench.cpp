@@ -0,0 +1,131 @@
+// Mesh optimization benchmark: times welding, the vertex cache reorder and the overdraw
+// reorder, and prints the ACMR of a 16 and a 32 entry FIFO cache after each step.
+//
+//   mesh_bench [--runs N] [--grid N] [mesh.obj|mesh.gltf|mesh.glb]
+//
+// Without a mesh it uses a grid of N x N quads with its triangles and vertices shuffled,
+// the worst case an exporter can hand us. Every time is the best of N runs.
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "MeshLoader.h"
+#include "MeshOptimizer.h"
+#include "BenchTimer.h"
+
+// Runs a function N times on a fresh copy of the mesh and returns the fastest run in milliseconds
+template <typename Function>
+static double best_on_copy(int runs, const MeshData &source, MeshData &result, Function function)
+{
+  return best_of_prepared(runs, [&]()
+                          { result = source; }, [&]()
+                          { function(result); });
+}
+
+static void print_result(const std::string &name, double ms, const MeshData &mesh)
+{
+  std::cout << "  " << std::left << std::setw(20) << name << std::right << std::setw(10) << std::fixed
+            << std::setprecision(2) << ms << " ms" << std::setw(10) << std::setprecision(3)
+            << compute_acmr(mesh.indices, mesh.vertices.size(), 16) << std::setw(10)
+            << compute_acmr(mesh.indices, mesh.vertices.size(), 32) << std::endl;
+}
+
+// A flat grid of size x size quads, every vertex written once per triangle corner and
+// the triangles in random order, so welding and both reorders have work to do
+static MeshData shuffled_grid(int size)
+{
+  MeshData mesh;
+  std::vector<uint32_t> triangles;
+  for (int y = 0; y < size; y++)
+    for (int x = 0; x < size; x++)
+    {
+      uint32_t quad[6] = {0, 1, 2, 0, 2, 3};
+      int corners[4][2] = {{x, y}, {x + 1, y}, {x + 1, y + 1}, {x, y + 1}};
+      for (uint32_t corner : quad)
+      {
+        MeshVertex vertex = {};
+        vertex.position[0] = (float)corners[corner][0] / size - 0.5f;
+        vertex.position[1] = (float)corners[corner][1] / size - 0.5f;
+        vertex.normal[2] = 1.0f;
+        vertex.texCoord[0] = (float)corners[corner][0] / size;
+        vertex.texCoord[1] = (float)corners[corner][1] / size;
+        mesh.vertices.push_back(vertex);
+      }
+    }
+
+  std::vector<uint32_t> order(mesh.vertices.size() / 3);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), std::mt19937(1234));
+  for (uint32_t triangle : order)
+    for (uint32_t corner = 0; corner < 3; corner++)
+      mesh.indices.push_back(triangle * 3 + corner);
+  mesh.sourceVertexCount = mesh.vertices.size();
+  return mesh;
+}
+
+int main(int argc, char **argv)
+{
+  int runs = 3;
+  int grid = 512;
+  const char *filename = nullptr;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+      runs = std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc)
+      grid = std::max(1, atoi(argv[++i]));
+    else if (argv[i][0] == '-')
+    {
+      std::cerr << "Usage: " << argv[0] << " [--runs N] [--grid N] [mesh]" << std::endl;
+      return 1;
+    }
+    else
+      filename = argv[i];
+  }
+
+  MeshData source, welded, cacheOptimized, overdrawOptimized;
+  if (filename != nullptr)
+  {
+    double start = get_time();
+    if (!load_mesh(filename, welded))
+      return 1;
+    std::cout << filename << ": loaded in " << std::fixed << std::setprecision(2) << (get_time() - start) * 1000.0
+              << " ms" << std::endl;
+    // Loading already welds, the file order is the baseline
+    source = welded;
+  }
+  else
+  {
+    std::cout << "Shuffled " << grid << "x" << grid << " grid" << std::endl;
+    source = shuffled_grid(grid);
+  }
+
+  std::cout << source.indices.size() / 3 << " triangles, " << source.sourceVertexCount << " vertices in the source, best of "
+            << runs << std::endl;
+  std::cout << "  " << std::left << std::setw(20) << "step" << std::right << std::setw(13) << "time"
+            << std::setw(10) << "ACMR 16" << std::setw(10) << "ACMR 32" << std::endl;
+  print_result("source", 0.0, source);
+
+  print_result("weld", best_on_copy(runs, source, welded, [](MeshData &mesh)
+                               { weld_vertices(mesh); }),
+               welded);
+  std::cout << "  " << welded.vertices.size() << " unique vertices" << std::endl;
+
+  print_result("vertex cache", best_on_copy(runs, welded, cacheOptimized, [](MeshData &mesh)
+                                       { optimize_vertex_cache(mesh.indices, mesh.vertices.size()); }),
+               cacheOptimized);
+  print_result("overdraw 1.05", best_on_copy(runs, cacheOptimized, overdrawOptimized, [](MeshData &mesh)
+                                        { optimize_overdraw(mesh.indices, mesh.vertices, 1.05f); }),
+               overdrawOptimized);
+  MeshData fetchOptimized;
+  print_result("vertex fetch", best_on_copy(runs, overdrawOptimized, fetchOptimized, [](MeshData &mesh)
+                                       { optimize_vertex_fetch(mesh); }),
+               fetchOptimized);
+  return 0;
+}
@@ -0,0 +1,120 @@
+// Mip generation benchmark: times the CPU mip chain with each filter on one and on every
+// hardware thread, and compares it with uploading level 0 and calling glGenerateMipmap.
+//
+//   mip_bench [--runs N] image.jpg
+//
+// Every measurement is the best of N runs. GPU times include the level 0 upload and a
+// glFinish, CPU + upload times include uploading every level explicitly.
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include "HeadlessContext.h"
+#include "MipChain.h"
+#include "BenchTimer.h"
+
+static void print_result(const std::string &name, double ms, double baseline)
+{
+  std::cout << "  " << std::left << std::setw(32) << name << std::right << std::setw(9) << std::fixed
+            << std::setprecision(2) << ms << " ms";
+  if (baseline > 0.0)
+    std::cout << std::setw(8) << std::setprecision(2) << baseline / ms << "x";
+  std::cout << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  int runs = 5;
+  const char *image = nullptr;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+      runs = std::max(1, atoi(argv[++i]));
+    else
+      image = argv[i];
+  }
+  if (image == nullptr)
+  {
+    std::cerr << "Usage: " << argv[0] << " [--runs N] image" << std::endl;
+    return 1;
+  }
+
+  int width, height, numColCh;
+  unsigned char *bytes = stbi_load(image, &width, &height, &numColCh, 4);
+  if (!bytes)
+  {
+    std::cerr << "Error: Failed to load " << image << ": " << stbi_failure_reason() << std::endl;
+    return 1;
+  }
+  unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+  std::cout << image << ": " << width << "x" << height << " RGBA, SIMD path " << mip_simd_path() << ", "
+            << threads << " threads, best of " << runs << std::endl;
+
+  std::cout << "CPU mip chain" << std::endl;
+  double box = best_of(runs, [&]
+                       { generate_mip_chain(bytes, width, height, 4, MIP_FILTER_BOX, false, 1); });
+  print_result("box, 1 thread", box, 0.0);
+  print_result("box, " + std::to_string(threads) + " threads",
+               best_of(runs, [&]
+                       { generate_mip_chain(bytes, width, height, 4, MIP_FILTER_BOX, false, threads); }),
+               box);
+  print_result("box sRGB, " + std::to_string(threads) + " threads",
+               best_of(runs, [&]
+                       { generate_mip_chain(bytes, width, height, 4, MIP_FILTER_BOX, true, threads); }),
+               box);
+  print_result("kaiser, 1 thread",
+               best_of(runs, [&]
+                       { generate_mip_chain(bytes, width, height, 4, MIP_FILTER_KAISER, false, 1); }),
+               box);
+  print_result("kaiser, " + std::to_string(threads) + " threads",
+               best_of(runs, [&]
+                       { generate_mip_chain(bytes, width, height, 4, MIP_FILTER_KAISER, false, threads); }),
+               box);
+  print_result("kaiser sRGB, " + std::to_string(threads) + " threads",
+               best_of(runs, [&]
+                       { generate_mip_chain(bytes, width, height, 4, MIP_FILTER_KAISER, true, threads); }),
+               box);
+
+  HeadlessContext context(3, 3);
+  context.MakeCurrent();
+  if (!gladLoadGLLoader((GLADloadproc)HeadlessContext::GetProcAddress))
+  {
+    std::cerr << "Error: Failed to initialize GLAD" << std::endl;
+    return 1;
+  }
+  std::cout << "Upload on " << glGetString(GL_RENDERER) << std::endl;
+
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  double gpu = best_of(runs, [&]
+                       {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, bytes);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glFinish(); });
+  print_result("level 0 + glGenerateMipmap", gpu, 0.0);
+
+  double cpu = best_of(runs, [&]
+                       {
+    std::vector<MipLevel> mips = generate_mip_chain(bytes, width, height, 4, MIP_FILTER_BOX, false, threads);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, bytes);
+    for (size_t i = 0; i < mips.size(); i++)
+      glTexImage2D(GL_TEXTURE_2D, (GLint)i + 1, GL_RGBA8, mips[i].width, mips[i].height, 0, GL_RGBA,
+                   GL_UNSIGNED_BYTE, mips[i].pixels.data());
+    glFinish(); });
+  print_result("CPU box chain + every level", cpu, gpu);
+
+  glDeleteTextures(1, &texture);
+  context.Delete();
+  stbi_image_free(bytes);
+  return 0;
+}
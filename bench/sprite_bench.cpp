@@ -0,0 +1,165 @@
+// Sprite batching benchmark: draws N sprites spread over a few textures and two programs
+// into an offscreen FBO, once through SpriteBatch and once with one draw call per sprite.
+//
+//   sprite_bench [--sprites N] [--frames N] [--textures N]
+//
+// Run it from the build directory, it loads res/shaders/sprite.vert and sprite.frag.
+// Times include a glFinish per frame so the GPU work is counted too.
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "HeadlessContext.h"
+#include "FBO.h"
+#include "shaderClass.h"
+#include "SpriteBatch.h"
+#include "BenchTimer.h"
+
+const unsigned int WIDTH = 800;
+const unsigned int HEIGHT = 800;
+
+// 2x2 texture of a single color, enough to tell the textures apart
+static GLuint solid_texture(const glm::vec4 &color)
+{
+  GLubyte pixel[4] = {(GLubyte)(color.x * 255), (GLubyte)(color.y * 255), (GLubyte)(color.z * 255), 255};
+  GLubyte pixels[16];
+  for (int i = 0; i < 4; i++)
+    memcpy(pixels + i * 4, pixel, 4);
+
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return texture;
+}
+
+struct Sprite
+{
+  glm::vec2 position, size;
+  GLuint texture;
+  int program;
+};
+
+// Renders the frames and prints draws per frame and sprites per second
+static void run(const char *name, const std::vector<Sprite> &sprites, Shader *programs[2], SpriteBatch &batch,
+                int frames, bool oneDrawPerSprite, const glm::mat4 &projection)
+{
+  unsigned long draws = 0;
+  glFinish();
+  double start = get_time();
+  for (int frame = 0; frame < frames; frame++)
+  {
+    glClear(GL_COLOR_BUFFER_BIT);
+    if (oneDrawPerSprite)
+    {
+      // What the scene code did before batching, every sprite flushed on its own
+      for (const Sprite &sprite : sprites)
+      {
+        batch.Begin(projection);
+        batch.Draw(*programs[sprite.program], sprite.texture, sprite.position, sprite.size);
+        batch.End();
+        draws += batch.drawCalls;
+      }
+    }
+    else
+    {
+      batch.Begin(projection);
+      for (const Sprite &sprite : sprites)
+        batch.Draw(*programs[sprite.program], sprite.texture, sprite.position, sprite.size);
+      batch.End();
+      draws += batch.drawCalls;
+    }
+    glFinish();
+  }
+  double seconds = get_time() - start;
+
+  std::cout << "  " << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << seconds * 1000.0 / frames << " ms/frame" << std::setw(10) << (double)draws / frames
+            << " draws/frame" << std::setw(14) << std::setprecision(0) << sprites.size() * frames / seconds
+            << " sprites/s" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  int spriteCount = 50000;
+  int frames = 50;
+  int textureCount = 8;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--sprites") == 0 && i + 1 < argc)
+      spriteCount = std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+      frames = std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--textures") == 0 && i + 1 < argc)
+      textureCount = std::max(1, atoi(argv[++i]));
+    else
+    {
+      std::cerr << "Usage: " << argv[0] << " [--sprites N] [--frames N] [--textures N]" << std::endl;
+      return 1;
+    }
+  }
+
+  HeadlessContext context(3, 3);
+  context.MakeCurrent();
+  if (!gladLoadGLLoader((GLADloadproc)HeadlessContext::GetProcAddress))
+  {
+    std::cerr << "Error: Failed to initialize GLAD" << std::endl;
+    return 1;
+  }
+  FBO offscreen(WIDTH, HEIGHT);
+  offscreen.Bind();
+  glViewport(0, 0, WIDTH, HEIGHT);
+
+  // Two identical programs, enough to make the sort key matter
+  Shader first("res/shaders/sprite.vert", "res/shaders/sprite.frag");
+  Shader second("res/shaders/sprite.vert", "res/shaders/sprite.frag");
+  Shader *programs[2] = {&first, &second};
+
+  std::vector<GLuint> textures;
+  for (int i = 0; i < textureCount; i++)
+    textures.push_back(solid_texture(glm::vec4((i & 1) ? 1.0f : 0.3f, (i & 2) ? 1.0f : 0.3f, (i & 4) ? 1.0f : 0.3f, 1.0f)));
+
+  // Textures and programs interleaved at random, the worst case for submission order
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> place(0.0f, 1.0f);
+  std::vector<Sprite> sprites(spriteCount);
+  for (Sprite &sprite : sprites)
+  {
+    sprite.position = glm::vec2(place(random) * WIDTH, place(random) * HEIGHT);
+    float size = 4.0f + place(random) * 12.0f;
+    sprite.size = glm::vec2(size, size);
+    sprite.texture = textures[random() % textures.size()];
+    sprite.program = (int)(random() % 2);
+  }
+
+  // Pixels to clip space, origin at the bottom left
+  glm::mat4 projection(1.0f);
+  projection[0][0] = 2.0f / WIDTH;
+  projection[1][1] = 2.0f / HEIGHT;
+  projection[3][0] = -1.0f;
+  projection[3][1] = -1.0f;
+
+  SpriteBatch batch(16384);
+  std::cout << glGetString(GL_RENDERER) << ": " << spriteCount << " sprites, " << textureCount
+            << " textures, 2 programs, " << frames << " frames" << std::endl;
+  run("SpriteBatch", sprites, programs, batch, frames, false, projection);
+  // One draw per sprite is slow, a few frames are enough
+  run("one draw per sprite", sprites, programs, batch, std::max(1, frames / 10), true, projection);
+
+  batch.Delete();
+  glDeleteTextures((GLsizei)textures.size(), textures.data());
+  first.Delete();
+  second.Delete();
+  offscreen.Delete();
+  context.Delete();
+  return 0;
+}
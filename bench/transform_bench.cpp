@@ -0,0 +1,106 @@
+// Transform hierarchy benchmark: times TransformHierarchy::Update over N transforms when every
+// node changed, when 1% did and when none did, on one thread and as jobs on several.
+//
+//   transform_bench [--runs N] [--transforms N] [--threads N]
+//
+// The hierarchy is 0.1% roots, then levels four times the size of the one above with random
+// parents, about the shape of a scene of objects with attached parts. Every time is the best
+// of N runs.
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "JobSystem.h"
+#include "TransformHierarchy.h"
+#include "BenchTimer.h"
+
+// Marks nodes dirty and times the Update, N times, returns the fastest in milliseconds
+static double best_update(int runs, TransformHierarchy &hierarchy, const std::vector<uint32_t> &changed, JobSystem *jobs)
+{
+  auto markDirty = [&]()
+  {
+    for (uint32_t node : changed)
+      hierarchy.SetRotation(node, hierarchy.rotations[hierarchy.Slot(node)]);
+  };
+  return best_of_prepared(runs, markDirty, [&]()
+                          { hierarchy.Update(jobs); });
+}
+
+int main(int argc, char **argv)
+{
+  int runs = 10;
+  size_t transformCount = 1000000;
+  unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+      runs = std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--transforms") == 0 && i + 1 < argc)
+      transformCount = (size_t)std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+      threads = (unsigned int)std::max(1, atoi(argv[++i]));
+    else
+    {
+      std::cerr << "Usage: " << argv[0] << " [--runs N] [--transforms N] [--threads N]" << std::endl;
+      return 1;
+    }
+  }
+
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+  std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+  TransformHierarchy hierarchy;
+  size_t levelStart = 0, levelSize = std::max<size_t>(1, transformCount / 1000);
+  while (hierarchy.Size() < transformCount)
+  {
+    size_t previousStart = levelStart, previousSize = hierarchy.Size() - levelStart;
+    levelStart = hierarchy.Size();
+    for (size_t i = 0; i < levelSize && hierarchy.Size() < transformCount; i++)
+    {
+      uint32_t parent = levelStart == 0 ? TRANSFORM_ROOT : (uint32_t)(previousStart + random() % previousSize);
+      float a = angle(random);
+      glm::quat rotation(std::cos(a * 0.5f), 0.0f, std::sin(a * 0.5f), 0.0f);
+      hierarchy.Add(parent, glm::vec3(offset(random), offset(random), offset(random)), rotation, glm::vec3(0.9f, 0.9f, 0.9f));
+    }
+    levelSize *= 4;
+  }
+
+  std::vector<uint32_t> everything(transformCount), some, nothing;
+  for (size_t i = 0; i < transformCount; i++)
+  {
+    everything[i] = (uint32_t)i;
+    if (random() % 100 == 0)
+      some.push_back((uint32_t)i);
+  }
+
+  // Parents were picked at random, the first Update sorts every level by parent
+  double start = get_time();
+  hierarchy.Update();
+  std::cout << transformCount << " transforms in " << hierarchy.levels.size() - 1 << " levels, sorted and updated in "
+            << std::fixed << std::setprecision(3) << (get_time() - start) * 1000.0 << " ms, best of " << runs << std::endl;
+  JobSystem jobs(threads);
+  std::cout << "  " << std::left << std::setw(14) << "changed" << std::right << std::setw(14) << "1 thread"
+            << std::setw(11) << jobs.ThreadCount() << " threads" << std::endl;
+  struct Case
+  {
+    const char *name;
+    const std::vector<uint32_t> &changed;
+  } cases[] = {{"all", everything}, {"1% (+ below)", some}, {"none", nothing}};
+  for (const Case &test : cases)
+  {
+    double single = best_update(runs, hierarchy, test.changed, nullptr);
+    double parallel = best_update(runs, hierarchy, test.changed, &jobs);
+    std::cout << "  " << std::left << std::setw(14) << test.name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(11) << single << " ms" << std::setw(16) << parallel << " ms" << std::endl;
+  }
+  jobs.Delete();
+  return 0;
+}
@@ -0,0 +1,104 @@
+#ifndef BVH_CLASS_H
+#define BVH_CLASS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "FrustumCulling.h"
+
+// Objects a leaf holds before the build considers splitting it at all
+const uint32_t BVH_MIN_SPLIT_OBJECTS = 2;
+// Leaves with more objects are split even when the SAH says it doesn't pay
+const uint32_t BVH_MAX_LEAF_OBJECTS = 8;
+// Buckets the SAH evaluates split positions with, per axis
+const int BVH_BINS = 16;
+
+// One node, 32 bytes so two share a cache line, and siblings are stored next to each other
+// so a node's children arrive together
+struct alignas(32) BVHNode
+{
+  float min[3];
+  // Inner nodes: index of the left child, the right one follows it. Leaves: first entry of BVH::objects
+  uint32_t leftOrFirst;
+  float max[3];
+  // Objects in a leaf, 0 for inner nodes
+  uint32_t count;
+
+  // True for nodes without children
+  bool IsLeaf() const { return count > 0; }
+};
+
+// Bounding volume hierarchy over the boxes of scene objects, for visibility and picking queries
+// in O(log n) instead of testing every object.
+//
+// Build sorts objects into nodes with a binned surface area heuristic. Objects that move get
+// their new box with Update, then Refit recomputes the node boxes bottom up without changing
+// the tree: much cheaper than Build, but the tree loses quality as objects drift from where
+// they were built, which Cost measures. Rebuild when it has grown well past the built cost
+class BVH
+{
+public:
+  // Nodes, the root first, children always come after their parent
+  std::vector<BVHNode> nodes;
+  // Object indices in leaf order, each leaf covers the range leftOrFirst..leftOrFirst + count
+  std::vector<uint32_t> objects;
+
+  // Adds an object and returns its index, it takes part in queries after the next Build
+  uint32_t Add(const glm::vec3 &min, const glm::vec3 &max);
+  // Moves an object, the nodes follow at the next Refit
+  void Update(uint32_t object, const glm::vec3 &min, const glm::vec3 &max);
+  // Removes every object and node
+  void Clear();
+  // Number of objects added
+  size_t ObjectCount() const { return boxes.size(); }
+
+  // Builds the tree from scratch over every object
+  void Build();
+  // Recomputes every node box from the current object boxes, keeping the tree
+  void Refit();
+  // Expected cost of a query relative to testing the root alone (the SAH cost), lower is better
+  float Cost() const;
+
+  // Writes the objects whose box touches the frustum to visible (room for ObjectCount indices),
+  // returns how many there are. Same result as cull_boxes, in leaf order
+  size_t QueryFrustum(const Frustum &frustum, uint32_t *visible) const;
+  // Writes the objects whose box overlaps the box min..max to overlapping, returns how many there are
+  size_t QueryBox(const glm::vec3 &min, const glm::vec3 &max, uint32_t *overlapping) const;
+  // Finds the object whose box the ray enters first within maxDistance, for picking.
+  // Returns false when it hits nothing
+  bool Raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, uint32_t &object,
+               float &distance) const;
+
+private:
+  // Box of one object
+  struct Box
+  {
+    float min[3];
+    float max[3];
+  };
+  std::vector<Box> boxes;
+  // Copies of the boxes that Build partitions in place of objects, so it reads them in order
+  struct BuildObject
+  {
+    Box box;
+    uint32_t object;
+  };
+  std::vector<BuildObject> building;
+  // Range of objects below each node, contiguous because Build partitions them, so a subtree
+  // entirely inside a query is copied out without visiting its nodes
+  struct Range
+  {
+    uint32_t first;
+    uint32_t count;
+  };
+  std::vector<Range> ranges;
+
+  // Sets a node's box to the union of its objects' boxes
+  void fitLeaf(BVHNode &node) const;
+  // Splits a leaf in two where the SAH is lowest, returns false when it stays a leaf
+  bool split(uint32_t nodeIndex);
+};
+
+#endif
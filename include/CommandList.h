@@ -0,0 +1,109 @@
+#ifndef COMMAND_LIST_CLASS_H
+#define COMMAND_LIST_CLASS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Kinds of packets a CommandList holds
+enum RenderCommandType
+{
+  RENDER_COMMAND_VIEWPORT,
+  RENDER_COMMAND_CLEAR,
+  RENDER_COMMAND_CAMERA,
+  RENDER_COMMAND_DRAW_INSTANCES
+};
+
+// Start of every packet, size counts the header and the payload up to the next packet
+struct RenderCommand
+{
+  uint32_t type;
+  uint32_t size;
+};
+
+// Area of the framebuffer drawn to, in pixels
+struct ViewportCommand
+{
+  RenderCommand header;
+  int32_t x, y, width, height;
+};
+
+// Clears color and depth
+struct ClearCommand
+{
+  RenderCommand header;
+  float color[4];
+};
+
+// View and projection matrices for the draws that follow
+struct CameraCommand
+{
+  RenderCommand header;
+  glm::mat4 view;
+  glm::mat4 proj;
+};
+
+// Consecutive instances drawn together
+struct InstanceRun
+{
+  uint32_t first;
+  uint32_t count;
+};
+
+// Draws runs of the scene's instances with one model matrix, runCount InstanceRuns follow
+struct DrawInstancesCommand
+{
+  RenderCommand header;
+  glm::mat4 model;
+  float scale;
+  uint32_t runCount;
+
+  // The runs after the packet
+  const InstanceRun *Runs() const { return (const InstanceRun *)(this + 1); }
+};
+
+// One frame of rendering recorded as packets, without any graphics API calls, so it can be
+// built on one thread and executed by the thread that owns the context. The packets are in
+// one growing buffer that is reused frame after frame, recording allocates nothing once it
+// has grown to the size of a frame.
+//
+// Executing walks the packets:
+//   for (const RenderCommand *command = list.First(); command != nullptr; command = list.Next(command))
+//     switch (command->type) ...
+class CommandList
+{
+public:
+  // Frame the list was recorded for
+  uint64_t frame;
+
+  // Constructor that makes an empty list
+  CommandList();
+
+  // Removes every packet, keeping the memory
+  void Reset(uint64_t frame);
+  // Sets the area of the framebuffer drawn to
+  void Viewport(int x, int y, int width, int height);
+  // Clears color and depth
+  void Clear(float red, float green, float blue, float alpha);
+  // Sets the view and projection matrices
+  void Camera(const glm::mat4 &view, const glm::mat4 &proj);
+  // Draws runs of instances with a model matrix and the shader's scale
+  void DrawInstances(const glm::mat4 &model, float scale, const InstanceRun *runs, uint32_t runCount);
+
+  // First packet, null when the list is empty
+  const RenderCommand *First() const;
+  // Packet after command, null after the last one
+  const RenderCommand *Next(const RenderCommand *command) const;
+  // Bytes of packets recorded
+  size_t Size() const { return used; }
+
+private:
+  std::vector<unsigned char> bytes;
+  size_t used;
+
+  // Appends a packet of size bytes (header included) and returns it
+  void *add(RenderCommandType type, size_t size);
+};
+
+#endif
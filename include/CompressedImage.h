@@ -0,0 +1,54 @@
+#ifndef COMPRESSED_IMAGE_H
+#define COMPRESSED_IMAGE_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+// S3TC (BC1-BC3) formats are not part of core OpenGL, so glad doesn't define them
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT 0x8C4E
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// Block compressed image and its mip chain, as stored in a DDS or KTX2 container.
+// Rows are expected in OpenGL order (bottom row first), which is how texcompress writes them
+struct CompressedImage
+{
+  struct Level
+  {
+    GLsizei width;
+    GLsizei height;
+    // Byte range of the level inside data
+    size_t offset;
+    size_t size;
+  };
+
+  // Compressed internal format, e.g. GL_COMPRESSED_RGBA_BPTC_UNORM
+  GLenum format;
+  GLsizei width;
+  GLsizei height;
+  std::vector<Level> levels;
+  std::vector<unsigned char> data;
+};
+
+// True if the file name ends in .dds or .ktx2
+bool is_compressed_image(const char *filename);
+// Reads a DDS or KTX2 file, prints the reason and returns false if it can't be used
+bool load_compressed_image(const char *filename, CompressedImage &image);
+// Bytes per 4x4 block of a compressed format, 0 for unknown formats
+GLsizei compressed_block_size(GLenum format);
+// Bytes of one mip level of a compressed format
+size_t compressed_level_size(GLenum format, GLsizei width, GLsizei height);
+// True if the current context can sample the given compressed format
+bool compressed_format_supported(GLenum format);
+
+#endif
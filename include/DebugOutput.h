@@ -0,0 +1,38 @@
+#ifndef DEBUG_OUTPUT_CLASS_H
+#define DEBUG_OUTPUT_CLASS_H
+
+#include <glad/glad.h>
+#include <ostream>
+#include <string>
+
+// Routes the driver's KHR_debug messages (errors, buffer stalls, shader recompiles and the
+// like) into our logs, and names GL objects and render passes for the driver and capture tools.
+//
+// Messages are aggregated by id: the first few of each print right away, the repeats are
+// counted and summed up once per second by Update, so a warning raised every draw can't
+// flood the log. Everything is a no-op on contexts without KHR_debug (GL 4.3).
+class DebugOutput
+{
+public:
+  // Messages received from the driver and how many of them were printed
+  static unsigned long received, printed;
+
+  // Installs the message callback on the current context, returns false without KHR_debug.
+  // Synchronous output calls back inside the GL call that raised the message, which makes it
+  // easy to find but keeps the driver from running ahead, debug builds only
+  static bool Install(bool synchronous);
+  // Returns true once Install succeeded
+  static bool Installed();
+
+  // glPushDebugGroup/glPopDebugGroup around a render pass, printed messages name the open groups
+  static void PushGroup(const char *name);
+  static void PopGroup();
+  // glObjectLabel, e.g. GL_TEXTURE or GL_PROGRAM. The object has to exist, so bind it once first
+  static void Label(GLenum identifier, GLuint name, const std::string &label);
+
+  // Prints how often the muted messages repeated, at most once per second. Call once per frame
+  static void Update();
+  // Writes every message id seen with its count
+  static void Report(std::ostream &out);
+};
+#endif
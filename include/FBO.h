@@ -0,0 +1,30 @@
+#ifndef FBO_CLASS_H
+#define FBO_CLASS_H
+
+#include <glad/glad.h>
+
+class FBO
+{
+public:
+  // ID reference of the Framebuffer Object
+  GLuint ID;
+  // ID references of the color and depth renderbuffers attached to the FBO
+  GLuint colorRBO;
+  GLuint depthRBO;
+  // Size of the attachments in pixels
+  GLsizei width;
+  GLsizei height;
+  // Constructor that generates a Framebuffer Object with an RGBA8 color and a depth attachment
+  FBO(GLsizei width, GLsizei height);
+
+  // Binds the FBO as the draw and read framebuffer
+  void Bind();
+  // Unbinds the FBO, going back to the default framebuffer
+  void Unbind();
+  // Reads back the color attachment and writes it to a binary PPM image
+  bool SavePPM(const char *filename);
+  // Deletes the FBO and its attachments
+  void Delete();
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef FRAME_TIMER_CLASS_H
+#define FRAME_TIMER_CLASS_H
+
+#include <glad/glad.h>
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+// Records the CPU and GPU time of every frame and reports percentiles.
+// GPU time comes from GL_TIME_ELAPSED queries, which are read back a few
+// frames late so that measuring never stalls the pipeline
+class FrameTimer
+{
+public:
+  // Number of frames a GPU query may be in flight before it is read back
+  static const int QUERY_LATENCY = 4;
+
+  // Number of frames at the start that are timed but left out of the results,
+  // they include driver warm-up such as shader JIT and texture residency
+  int warmupFrames;
+  // Per frame timings in milliseconds, in frame order
+  std::vector<double> cpuTimes;
+  std::vector<double> gpuTimes;
+
+  // Summary of a series of timings in milliseconds
+  struct Summary
+  {
+    double min, p50, p95, p99, max, mean;
+  };
+
+  // Constructor that generates the GPU timer queries
+  FrameTimer(int warmupFrames);
+
+  // Marks the start of a frame
+  void BeginFrame();
+  // Marks the end of a frame, after the last draw call was submitted
+  void EndFrame();
+  // Waits for the outstanding GPU queries so every frame has a GPU time,
+  // then drops the warm-up frames
+  void Finish();
+
+  // Computes min/p50/p95/p99/max/mean of a series of timings
+  static Summary Summarize(std::vector<double> samples);
+  // Prints the CPU and GPU summaries in a human readable table
+  void Report(std::ostream &out);
+  // Writes the summaries and the raw samples as JSON
+  bool WriteJSON(const char *filename);
+  // Deletes the GPU timer queries
+  void Delete();
+
+private:
+  GLuint queries[QUERY_LATENCY];
+  // Frame index each query slot belongs to, -1 when the slot is free
+  long long queryFrame[QUERY_LATENCY];
+  long long frameIndex;
+  std::chrono::steady_clock::time_point frameStart;
+
+  // Reads back the result of a query slot if it is in use
+  void collect(int slot);
+};
+
+#endif
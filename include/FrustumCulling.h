@@ -0,0 +1,58 @@
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// The six planes of a view frustum, each stored as (a, b, c, d) with a normalized (a, b, c)
+// pointing inside: a point p is inside a plane when a * p.x + b * p.y + c * p.z + d >= 0
+struct Frustum
+{
+  float planes[6][4];
+};
+
+// Bounding volumes of many objects in SoA form, each array holds one value per object so the
+// tests load 4 or 8 objects per instruction. An object has an AABB (center and half extents)
+// and the sphere around it
+struct CullingBounds
+{
+  std::vector<float> centerX, centerY, centerZ;
+  std::vector<float> extentX, extentY, extentZ;
+  std::vector<float> radius;
+
+  // Appends the object with the given box, its sphere is the one through the box's corners
+  void Add(const glm::vec3 &min, const glm::vec3 &max);
+  // Replaces the box of object i, e.g. after it moved
+  void Set(size_t i, const glm::vec3 &min, const glm::vec3 &max);
+  // Removes every object
+  void Clear();
+  // Number of objects
+  size_t Size() const { return centerX.size(); }
+};
+
+// Planes of the frustum of a projection * view matrix (Gribb/Hartmann). Passing
+// projection * view * model gives the planes in the model's space, so bounds that only
+// move with the model don't have to be transformed every frame
+Frustum extract_frustum(const glm::mat4 &viewProjection);
+
+// Box containing the box min..max after the affine transform
+void transform_bounds(const glm::mat4 &transform, const glm::vec3 &min, const glm::vec3 &max, glm::vec3 &outMin,
+                      glm::vec3 &outMax);
+
+// Writes the indices of the objects whose sphere touches the frustum to visible (room for
+// bounds.Size() indices), in increasing order, and returns how many there are
+size_t cull_spheres(const Frustum &frustum, const CullingBounds &bounds, uint32_t *visible);
+// Same with the boxes, tighter than the spheres for a little more work. Both tests are
+// conservative: objects near a frustum corner may pass without being visible
+size_t cull_boxes(const Frustum &frustum, const CullingBounds &bounds, uint32_t *visible);
+// Same as cull_boxes for the objects first..first + count - 1 only, so jobs can each test a
+// range. visible needs room for count indices
+size_t cull_boxes_range(const Frustum &frustum, const CullingBounds &bounds, size_t first, size_t count,
+                        uint32_t *visible);
+
+// Name of the SIMD code path compiled in: "AVX2", "SSE2", "NEON" or "scalar"
+const char *culling_simd_path();
+
+#endif
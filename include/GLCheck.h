@@ -0,0 +1,55 @@
+#ifndef GL_CHECK_H
+#define GL_CHECK_H
+
+#include <glad/glad.h>
+
+// Error checks are compiled in everywhere but release (NDEBUG) builds, -DGL_CHECKS=0/1 overrides that
+#ifndef GL_CHECKS
+#ifdef NDEBUG
+#define GL_CHECKS 0
+#else
+#define GL_CHECKS 1
+#endif
+#endif
+
+// How a build with GL_CHECKS notices errors, picked by gl_checks_init for the current context
+enum GLCheckMode
+{
+  // Nothing is checked, release builds always use this
+  GL_CHECK_DISABLED,
+  // The driver reports every error through the DebugOutput callback, at the call that raised it
+  GL_CHECK_DEBUG_OUTPUT,
+  // No KHR_debug (macOS), gl_check_failed asks glGetError, which waits for the driver
+  GL_CHECK_GET_ERROR
+};
+
+// Mode picked by gl_checks_init
+extern GLCheckMode gl_check_mode;
+// Set by the debug callback when an error was reported, cleared by gl_check_failed
+extern bool gl_error_reported;
+
+// Picks the check mode and installs the debug callback, call it once after gladLoadGL.
+// With validateInterval > 0 gl_validate_frame also drains glGetError every that many frames, in any build
+void gl_checks_init(int validateInterval = 0);
+
+// Returns true if a GL call failed since the last check. It is compiled out of release builds and
+// only queries the driver without KHR_debug, still keep it out of the per frame path
+inline bool gl_check_failed()
+{
+#if GL_CHECKS
+  if (gl_check_mode == GL_CHECK_DEBUG_OUTPUT)
+  {
+    bool reported = gl_error_reported;
+    gl_error_reported = false;
+    return reported;
+  }
+  return gl_check_mode == GL_CHECK_GET_ERROR && glGetError() != GL_NO_ERROR;
+#else
+  return false;
+#endif
+}
+
+// Call once per frame, every validateInterval frames it reports the errors raised since the last validation
+void gl_validate_frame();
+
+#endif
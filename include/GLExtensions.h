@@ -0,0 +1,10 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+// Returns true if the current context exposes the given extension, e.g. "GL_ARB_buffer_storage".
+// The list is read from the driver on first use, call it after gladLoadGL
+bool has_gl_extension(const char *name);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef HEADLESS_CONTEXT_CLASS_H
+#define HEADLESS_CONTEXT_CLASS_H
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+// OpenGL 3.3 core context without any window or surface, used to render
+// into an FBO on machines without a display (CI, render farm, llvmpipe)
+class HeadlessContext
+{
+public:
+  // EGL handles of the context
+  EGLDisplay display;
+  EGLConfig config;
+  EGLContext context;
+  // Constructor that creates a surfaceless OpenGL context with the given version.
+  // With share the context lives on the same display and shares its objects, for worker threads
+  HeadlessContext(int majorVersion, int minorVersion, const HeadlessContext *share = nullptr);
+
+  // Makes the context current on the calling thread
+  void MakeCurrent();
+  // Makes no context current on the calling thread
+  void Release();
+  // Returns the address of an OpenGL function, to be handed to gladLoadGLLoader
+  static void *GetProcAddress(const char *name);
+  // Destroys the context and terminates the display, unless the display belongs to the shared context
+  void Delete();
+
+private:
+  // False for shared contexts, the display is terminated with the context it was opened for
+  bool ownsDisplay;
+
+  // Opens the display and picks an OpenGL capable config
+  void initializeDisplay();
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef INDIRECT_BUFFER_CLASS_H
+#define INDIRECT_BUFFER_CLASS_H
+
+#include <glad/glad.h>
+#include <memory>
+#include <vector>
+
+#include "StreamingBuffer.h"
+
+// Layout of one indexed draw as read by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+  // Indices to draw, starting at firstIndex (in indices, not bytes) of the bound EBO
+  GLuint count;
+  GLuint instanceCount;
+  GLuint firstIndex;
+  // Added to every index, selects the object's vertices in a shared VBO
+  GLint baseVertex;
+  // First instance, offsets per instance attributes (ignored before OpenGL 4.2)
+  GLuint baseInstance;
+};
+
+// Per frame array of draw commands against the bound VAO and its EBO, drawn with a single call.
+//
+// Culling writes the commands of the visible objects straight into the buffer returned by
+// Map, which with OpenGL 4.0+ is GPU memory (a StreamingBuffer bound to
+// GL_DRAW_INDIRECT_BUFFER). Draw then uses, depending on what the driver offers:
+//   OpenGL 4.3   one glMultiDrawElementsIndirect
+//   OpenGL 4.0   one glDrawElementsIndirect per command
+//   OpenGL 3.3   commands stay on the CPU, one glDrawElementsBaseVertex each
+class IndirectBuffer
+{
+public:
+  // Number of commands that fit in a frame
+  GLsizei maxCommands;
+  // True when commands live in a GPU buffer, false for the OpenGL 3.3 loop
+  bool indirect;
+  // True when all commands go out in one glMultiDrawElementsIndirect
+  bool multiDraw;
+  // Driver draw calls made by the last Draw
+  unsigned long drawCalls;
+
+  // Constructor that makes room for maxCommands per frame
+  IndirectBuffer(GLsizei maxCommands);
+
+  // Returns room for maxCommands commands, to be written before Draw
+  DrawElementsIndirectCommand *Map();
+  // Ends writing, count is the number of commands written this frame
+  void Unmap(GLsizei count);
+  // Draws the commands written since Map with the VAO bound by the caller
+  void Draw(GLenum mode, GLenum indexType);
+  // Deletes the buffer
+  void Delete();
+
+private:
+  GLsizei commandCount;
+  // GPU storage, only created when indirect drawing is available
+  std::unique_ptr<StreamingBuffer> commands;
+  // CPU storage for the OpenGL 3.3 path
+  std::vector<DrawElementsIndirectCommand> fallback;
+};
+
+#endif
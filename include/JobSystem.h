@@ -0,0 +1,194 @@
+#ifndef JOB_SYSTEM_CLASS_H
+#define JOB_SYSTEM_CLASS_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+struct Job;
+
+// Function a job runs, data is the copy of the bytes the job was created with
+typedef void (*JobFunction)(JobSystem &jobs, Job *job, const void *data);
+
+// Jobs each thread allocates before it reuses the oldest, also the capacity of its deque
+const uint32_t JOB_POOL_SIZE = 4096;
+// Bytes of data a job carries
+const size_t JOB_DATA_SIZE = 44;
+// Times an idle worker looks for work again before it goes to sleep
+const int JOB_SPIN_COUNT = 64;
+
+// Unit of work, one cache line so threads running neighbouring jobs don't share one
+struct alignas(64) Job
+{
+  JobFunction function;
+  // Job that waits for this one to finish, or null
+  Job *parent;
+  // This job plus its unfinished children, the job is done at 0
+  std::atomic<int32_t> unfinished;
+  unsigned char data[JOB_DATA_SIZE];
+};
+
+// Chase-Lev work-stealing deque of a fixed capacity. The owning thread pushes and pops
+// at the bottom, last in first out so it works on what is still in its cache, other
+// threads steal the oldest jobs from the top, which are usually the biggest
+class JobDeque
+{
+public:
+  // Constructor that makes an empty deque for capacity jobs, a power of two
+  JobDeque(uint32_t capacity);
+
+  // Adds a job at the bottom, owner only. Returns false when the deque is full
+  bool Push(Job *job);
+  // Takes the newest job, owner only. Returns null when the deque is empty
+  Job *Pop();
+  // Takes the oldest job, any thread. Returns null when it is empty or another thread won the race
+  Job *Steal();
+
+private:
+  std::unique_ptr<std::atomic<Job *>[]> buffer;
+  int64_t mask;
+  // Next slot to push to, and oldest job. Apart so owner and thieves don't write the same line
+  alignas(64) std::atomic<int64_t> bottom;
+  alignas(64) std::atomic<int64_t> top;
+};
+
+// Pool of worker threads that run jobs, for work that splits into many small independent
+// pieces: texture decoding, culling, transform updates, command building.
+//
+// Every thread has its own deque and its own jobs: a thread runs what it spawned itself
+// first and only steals from a random other thread when it runs out, so threads rarely
+// touch the same memory. There are no fibers, a thread that waits for a job runs other
+// jobs until it is done.
+//
+// A job counts its unfinished children, which are created with it as their parent, and
+// it is only done once all of them are. Waiting for a job waits for everything below it:
+//   Job *root = jobs.Create(nullptr);
+//   for (...)
+//     jobs.Run(jobs.Create(work, &data, sizeof(data), root));
+//   jobs.Run(root);
+//   jobs.Wait(root);
+//
+// Long jobs that no frame waits for, like decoding a file, go to a separate background
+// queue with RunBackground instead. Only worker threads take them, and only when their
+// deques are empty, so Wait and RunOne on a frame's critical path never start one.
+//
+// Only the thread that created the system and jobs themselves create, run and wait for
+// jobs. Jobs live in a per thread ring of JOB_POOL_SIZE, so once a job is done it can only be
+// waited for until its thread has created about that many more
+class JobSystem
+{
+public:
+  // Constructor that starts the worker threads, so that threadCount threads run jobs including
+  // the calling one. 0 uses one per hardware thread but at least two, so jobs nobody waits for
+  // still run; with 1 jobs only run while the calling thread waits, background ones only in
+  // RunBackgroundOne
+  JobSystem(unsigned int threadCount = 0);
+
+  // Makes a job that runs function with a copy of size bytes of data, and counts towards parent
+  // (when not null) until it is done. It starts with Run
+  Job *Create(JobFunction function, const void *data = nullptr, size_t size = 0, Job *parent = nullptr);
+  // Queues a job on the calling thread's deque, where idle threads can steal it
+  void Run(Job *job);
+  // Queues a long job that only worker threads with nothing else to do pick up
+  void RunBackground(Job *job);
+  // Runs one queued background job on the calling thread, for a thread that waits for them
+  // anyway. Returns false when there is none
+  bool RunBackgroundOne();
+  // Runs other jobs until job and all its children are done
+  void Wait(const Job *job);
+  // Runs one queued job, the calling thread's own or a stolen one. Returns false when it found none
+  bool RunOne();
+  // True when job and all its children are done
+  bool Done(const Job *job) const { return job->unfinished.load(std::memory_order_acquire) == 0; }
+  // Calls function(first, count) over 0..count - 1 in ranges of batch, on all threads, and
+  // returns when every range is done. Ranges start at multiples of batch, only the last is shorter
+  template <typename Function>
+  void ParallelFor(uint32_t count, uint32_t batch, const Function &function);
+  // Number of threads that run jobs, the calling one included
+  unsigned int ThreadCount() const { return (unsigned int)workers.size(); }
+  // Stops the worker threads, queued jobs (background ones too) that didn't run are dropped
+  void Delete();
+
+private:
+  // Deque and job ring of one thread, index 0 is the thread that created the system
+  struct Worker
+  {
+    JobDeque deque;
+    std::unique_ptr<Job[]> pool;
+    uint32_t allocated;
+    // State of the xorshift that picks threads to steal from
+    uint32_t random;
+
+    Worker(uint32_t seed);
+  };
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+
+  // Workers sleep when there is nothing to steal, Run and RunBackground wake one when any are asleep
+  std::mutex mutex;
+  std::condition_variable wake;
+  uint64_t generation;
+  std::atomic<unsigned int> sleeping;
+  std::atomic<bool> stopping;
+
+  // Background jobs, oldest first. The count lets idle workers skip the lock when there are none
+  std::mutex backgroundMutex;
+  std::deque<Job *> background;
+  std::atomic<size_t> backgroundCount;
+
+  // What ParallelFor hands its jobs, the range left to split and the type erased function
+  struct RangeData
+  {
+    void (*call)(const void *function, uint32_t first, uint32_t count);
+    const void *function;
+    uint32_t first;
+    uint32_t count;
+    uint32_t batch;
+  };
+
+  // Worker of the calling thread
+  Worker &current();
+  // Takes a job from the calling thread's deque, or steals one from another thread
+  Job *find(Worker &worker);
+  // Takes the oldest background job, or returns null
+  Job *findBackground();
+  // Wakes a sleeping worker, if there is one, after a job was queued
+  void wakeWorker();
+  // Runs a job and marks it done
+  void execute(Job *job);
+  // Counts a job or child done, and its parent once it is done itself
+  void finish(Job *job);
+  // Worker thread loop
+  void workerLoop(unsigned int index);
+  // Splits off the upper half of its batches as a child until it is down to one, then runs that
+  static void rangeJob(JobSystem &jobs, Job *job, const void *data);
+  // Calls a ParallelFor function
+  template <typename Function>
+  static void callRange(const void *function, uint32_t first, uint32_t count)
+  {
+    (*(const Function *)function)(first, count);
+  }
+};
+
+// Calls function(first, count) over 0..count - 1 in ranges of batch, on all threads, and
+// returns when every range is done. Ranges start at multiples of batch, only the last is shorter
+template <typename Function>
+void JobSystem::ParallelFor(uint32_t count, uint32_t batch, const Function &function)
+{
+  if (count == 0)
+    return;
+  RangeData range = {&callRange<Function>, &function, 0, count, std::max<uint32_t>(1, batch)};
+  Job *root = Create(&JobSystem::rangeJob, &range, sizeof(range));
+  Run(root);
+  Wait(root);
+}
+
+#endif
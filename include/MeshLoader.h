@@ -0,0 +1,41 @@
+#ifndef MESH_LOADER_H
+#define MESH_LOADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Vertex layout of loaded meshes, the same 8 floats the built in quad uses:
+// position at location 0, normal at location 1 and texture coordinates at location 2
+struct MeshVertex
+{
+  float position[3];
+  float normal[3];
+  float texCoord[2];
+};
+
+// Indexed triangle list, texture coordinates follow OpenGL (v = 0 is the bottom row)
+struct MeshData
+{
+  std::vector<MeshVertex> vertices;
+  std::vector<uint32_t> indices;
+  // Vertices before identical ones were merged, one per face corner for OBJ files
+  size_t sourceVertexCount;
+  // Axis aligned bounds of the positions
+  float boundsMin[3];
+  float boundsMax[3];
+};
+
+// Reads a Wavefront OBJ, glTF 2.0 (.gltf with external or embedded buffers) or binary glTF (.glb) file.
+// Faces are triangulated, identical vertices merged and missing normals computed.
+// Prints the reason and returns false if the file can't be used
+bool load_mesh(const char *filename, MeshData &mesh);
+
+// Merges vertices with identical attributes through a hash map and rewrites the indices
+void weld_vertices(MeshData &mesh);
+// Computes area weighted normals from the triangles for the vertices whose normal is zero
+void compute_normals(MeshData &mesh);
+// Recomputes boundsMin and boundsMax from the positions
+void compute_bounds(MeshData &mesh);
+
+#endif
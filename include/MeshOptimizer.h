@@ -0,0 +1,32 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MeshLoader.h"
+
+// Vertex cache size the optimizer targets and ACMR is measured with by default. Post transform
+// caches of current GPUs are larger and not strictly FIFO, 32 is a good fit for all of them
+const unsigned int MESH_CACHE_SIZE = 32;
+
+// Average cache miss ratio: post transform cache misses per triangle of a FIFO cache of the given size.
+// 3 means no reuse at all, about 0.5 is the best a regular grid can do
+float compute_acmr(const std::vector<uint32_t> &indices, size_t vertexCount, unsigned int cacheSize = MESH_CACHE_SIZE);
+
+// Reorders the triangles for the post transform vertex cache, Tom Forsyth's linear speed algorithm
+void optimize_vertex_cache(std::vector<uint32_t> &indices, size_t vertexCount);
+
+// Reorders clusters of triangles so the outward facing ones are drawn first and hide what's behind
+// them, after Sander et al. Clusters split where the vertex cache restarts anyway, and at points
+// that keep the ACMR within threshold times the cache optimized one. Run it after optimize_vertex_cache
+void optimize_overdraw(std::vector<uint32_t> &indices, const std::vector<MeshVertex> &vertices, float threshold = 1.05f);
+
+// Reorders the vertices in the order the triangles first use them, so vertex fetch streams through memory
+void optimize_vertex_fetch(MeshData &mesh);
+
+// Runs all of the above
+void optimize_mesh(MeshData &mesh, float overdrawThreshold = 1.05f);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef MIP_CHAIN_H
+#define MIP_CHAIN_H
+
+#include <vector>
+
+// Filter used to build each mip level from the one above it
+enum MipFilter
+{
+  MIP_FILTER_BOX,   // 2x2 average, fast
+  MIP_FILTER_KAISER // 8 tap Kaiser windowed sinc, sharper and less aliasing
+};
+
+// One mip level of 8 bit pixels, rows bottom first like everything else uploaded to OpenGL
+struct MipLevel
+{
+  int width;
+  int height;
+  std::vector<unsigned char> pixels;
+};
+
+// Builds one level at half the size of the source.
+// With srgb the color channels are filtered in linear space, alpha is always linear
+MipLevel downsample_level(const unsigned char *pixels, int width, int height, int channels,
+                          MipFilter filter, bool srgb, unsigned int threads = 1);
+
+// Builds every level below the source down to 1x1, largest first (the source itself is not included).
+// Rows of each level are split across threads, 0 uses one per hardware thread
+std::vector<MipLevel> generate_mip_chain(const unsigned char *pixels, int width, int height, int channels,
+                                         MipFilter filter, bool srgb, unsigned int threads = 0);
+
+// Name of the SIMD code path compiled in: "AVX2", "SSE2", "NEON" or "scalar"
+const char *mip_simd_path();
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef PROGRAM_CACHE_CLASS_H
+#define PROGRAM_CACHE_CLASS_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// On disk cache of linked program binaries (glGetProgramBinary / glProgramBinary).
+//
+// Every program is stored as <directory>/<key>.bin where the key is a hash of its shader
+// sources and the driver's vendor, renderer and version strings, so editing a shader or
+// updating the driver misses the cache instead of loading a stale binary. Binaries the
+// driver refuses anyway are deleted and the caller falls back to compiling from source.
+//
+// File layout (little endian):
+//   Header          magic "GLPB", version, binary format, binary length, full key hash
+//   binary          the bytes returned by glGetProgramBinary
+class ProgramCache
+{
+public:
+  static const uint32_t VERSION = 1;
+
+  struct Header
+  {
+    char magic[4];
+    uint32_t version;
+    uint32_t binaryFormat;
+    uint32_t length;
+    uint64_t key;
+  };
+
+  // Directory the binaries are kept in
+  std::string directory;
+  // False when the driver can't return program binaries, Load and Store then do nothing
+  bool enabled;
+  // Programs loaded from the cache and programs that had to be compiled
+  unsigned long hits, misses;
+
+  // Constructor that reads the driver identity of the current context, call it after gladLoadGL
+  ProgramCache(const char *directory);
+
+  // Hash of the given shader sources on the current driver
+  uint64_t Key(const std::vector<std::string> &sources) const;
+  // Links the program from a cached binary, false if there is none or the driver rejected it
+  bool Load(GLuint program, uint64_t key);
+  // Writes the binary of a linked program, which must have been linked with
+  // GL_PROGRAM_BINARY_RETRIEVABLE_HINT set (see PrepareLink)
+  void Store(GLuint program, uint64_t key);
+  // Asks the driver to keep the binary of a program around, call it before glLinkProgram
+  void PrepareLink(GLuint program) const;
+
+private:
+  // Vendor, renderer and version of the driver, part of every key
+  std::string driver;
+  // Binary formats the driver accepts in glProgramBinary
+  std::vector<GLint> formats;
+
+  std::string path(uint64_t key) const;
+};
+
+#endif
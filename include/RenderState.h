@@ -0,0 +1,50 @@
+#ifndef RENDER_STATE_CLASS_H
+#define RENDER_STATE_CLASS_H
+
+#include <glad/glad.h>
+
+// Shadow copy of the OpenGL binding and enable state, so binding what is already bound
+// never reaches the driver. Every bind in the engine goes through here; calling the GL
+// bind functions directly leaves the shadow stale, call Invalidate after such code.
+//
+// Objects are deleted through here too, since deleting a bound object resets its bindings.
+// The state is per thread, which matches one context per thread (the shader reload
+// worker has its own). Binds to targets that aren't shadowed are always issued.
+class RenderState
+{
+public:
+  // Calls made into the driver and calls skipped because the state was already set,
+  // since the last ResetCounters
+  static thread_local unsigned long issued, elided;
+
+  // glUseProgram
+  static void UseProgram(GLuint program);
+  // glBindVertexArray, the element array binding belongs to the VAO and follows it
+  static void BindVertexArray(GLuint vertexArray);
+  // glBindBuffer
+  static void BindBuffer(GLenum target, GLuint buffer);
+  // glBindBufferBase, which also changes the generic binding of target
+  static void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+  // glBindFramebuffer, GL_FRAMEBUFFER sets both the draw and the read framebuffer
+  static void BindFramebuffer(GLenum target, GLuint framebuffer);
+  // glActiveTexture, unit is GL_TEXTURE0 + n
+  static void ActiveTexture(GLenum unit);
+  // glBindTexture on the active unit
+  static void BindTexture(GLenum target, GLuint texture);
+  // glEnable / glDisable
+  static void Enable(GLenum capability);
+  static void Disable(GLenum capability);
+
+  // Deletes objects and forgets every binding to them
+  static void DeleteBuffer(GLuint buffer);
+  static void DeleteTexture(GLuint texture);
+  static void DeleteVertexArray(GLuint vertexArray);
+  static void DeleteFramebuffer(GLuint framebuffer);
+
+  // Forgets everything, the next call of every kind is issued
+  static void Invalidate();
+  // Starts counting issued and elided calls from zero, e.g. at the start of a frame
+  static void ResetCounters();
+};
+
+#endif
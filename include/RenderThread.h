@@ -0,0 +1,73 @@
+#ifndef RENDER_THREAD_CLASS_H
+#define RENDER_THREAD_CLASS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "CommandList.h"
+#include "SPSCQueue.h"
+
+// Thread that owns the rendering context and executes the frames the main thread records.
+//
+// The main thread simulates and records frame N + 1 into one CommandList while this thread
+// submits frame N from the other, so a frame costs the longer of the two instead of their
+// sum. Lists go to the render thread and back through two lock-free single producer,
+// single consumer queues; a thread only sleeps when the other one is a whole frame behind.
+//
+// Per frame on the main thread:
+//   CommandList &list = renderThread.Begin();
+//   ... simulate and record ...
+//   renderThread.Submit();
+class RenderThread
+{
+public:
+  // Command lists, one being recorded while the other is executed
+  static const int LIST_COUNT = 2;
+
+  // Seconds the main thread spent in Begin waiting for a list to come back
+  double waitTime;
+
+  // Constructor that starts the thread. It calls makeCurrent first and release when it stops,
+  // and execute for every submitted list. The context must not be current on any other thread
+  RenderThread(std::function<void()> makeCurrent, std::function<void()> release,
+               std::function<void(const CommandList &)> execute);
+
+  // Returns an empty list for the next frame, waiting while the render thread still executes
+  // every other list
+  CommandList &Begin();
+  // Hands the list Begin returned to the render thread
+  void Submit();
+  // Waits for the submitted frames to be executed and stops the thread, which releases the context
+  void Delete();
+
+private:
+  std::function<void()> makeCurrent;
+  std::function<void()> release;
+  std::function<void(const CommandList &)> execute;
+  std::thread thread;
+
+  CommandList lists[LIST_COUNT];
+  // Recorded lists on their way to the render thread (null stops it), and executed ones on
+  // their way back
+  SPSCQueue<CommandList *> submitted;
+  SPSCQueue<CommandList *> executed;
+  CommandList *recording;
+  uint64_t frame;
+
+  // A thread finding its queue empty sleeps until the other one pushes
+  std::mutex mutex;
+  std::condition_variable pushed;
+  std::atomic<unsigned int> sleeping;
+
+  // Render thread loop
+  void threadLoop();
+  // Pushes a list and wakes the other thread if it sleeps
+  void push(SPSCQueue<CommandList *> &queue, CommandList *list);
+  // Pops a list, sleeping while the queue is empty
+  CommandList *pop(SPSCQueue<CommandList *> &queue);
+};
+
+#endif
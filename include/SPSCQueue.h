@@ -0,0 +1,58 @@
+#ifndef SPSC_QUEUE_CLASS_H
+#define SPSC_QUEUE_CLASS_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Lock-free queue of a fixed capacity between exactly one producer thread and one consumer
+// thread. Each side only writes its own index, so neither ever waits for the other: a full
+// or empty queue just makes Push or Pop return false
+template <typename T>
+class SPSCQueue
+{
+public:
+  // Constructor that makes an empty queue with room for capacity values
+  SPSCQueue(size_t capacity)
+      : slots(capacity), head(0), tail(0)
+  {
+  }
+
+  // Appends a value, producer only. Returns false when the queue is full
+  bool Push(const T &value)
+  {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == slots.size())
+      return false;
+    slots[t % slots.size()] = value;
+    // Publishes the value to the consumer
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Takes the oldest value, consumer only. Returns false when the queue is empty
+  bool Pop(T &value)
+  {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire))
+      return false;
+    value = slots[h % slots.size()];
+    // Hands the slot back to the producer
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // True when there is nothing to pop, exact on the consumer's side only
+  bool Empty() const
+  {
+    return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+  }
+
+private:
+  std::vector<T> slots;
+  // Values pushed and popped so far, on their own cache lines so the threads don't share one
+  alignas(64) std::atomic<size_t> head;
+  alignas(64) std::atomic<size_t> tail;
+};
+
+#endif
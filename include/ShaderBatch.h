@@ -0,0 +1,38 @@
+#ifndef SHADER_BATCH_CLASS_H
+#define SHADER_BATCH_CLASS_H
+
+#include <memory>
+#include <vector>
+
+#include "shaderClass.h"
+#include "ProgramCache.h"
+
+// Builds many shader programs at once. Every program is submitted to the driver up front
+// without asking for its status, so drivers with KHR_parallel_shader_compile compile them
+// all concurrently on their own threads. A program only blocks the first time it is used
+// (Shader::Activate) or when WaitAll is called
+class ShaderBatch
+{
+public:
+  // True when the driver reports progress through GL_COMPLETION_STATUS_KHR
+  bool parallel;
+
+  // Constructor of an empty batch, programs are looked up in the cache first when one is given
+  ShaderBatch(ProgramCache *cache = nullptr);
+
+  // Submits a program and returns it right away, the batch keeps ownership
+  Shader &Add(const char *vertexFile, const char *fragmentFile);
+  // Finishes the programs the driver is done with and returns how many are still compiling.
+  // Never blocks, without the extension nothing is known to be done until first use
+  size_t Pending();
+  // Blocks until every program is finished
+  void WaitAll();
+  // Deletes every program of the batch
+  void Delete();
+
+private:
+  ProgramCache *cache;
+  std::vector<std::unique_ptr<Shader>> shaders;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef SHADER_WATCHER_CLASS_H
+#define SHADER_WATCHER_CLASS_H
+
+#include <glad/glad.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "shaderClass.h"
+
+// Hot reloads shader programs while the application runs.
+//
+// A worker thread waits for edits to the watched files (inotify on Linux, modification
+// times elsewhere) and rebuilds the affected programs on its own context, which shares
+// objects with the render context. Finished programs are fenced and swapped into their
+// Shader by Update between frames once the fence has passed, so the render thread never
+// waits for a compile. A program that fails to build is dropped and the old one stays.
+class ShaderWatcher
+{
+public:
+  // Programs swapped in and rebuilds that failed since the watcher started. Update counts the
+  // first on the render thread, the worker the second
+  std::atomic<unsigned long> reloads, failures;
+
+  // Constructor that starts the worker. makeCurrent and release are called on the worker
+  // thread to bind and unbind a context that shares objects with the render context
+  ShaderWatcher(std::function<void()> makeCurrent, std::function<void()> release);
+
+  // Rebuilds the program whenever one of its files changes, the Shader must outlive the watcher
+  void Watch(Shader &shader, const char *vertexFile, const char *fragmentFile);
+  // Swaps in the programs that finished rebuilding, returns how many. Never blocks.
+  // Uniform values live in the program, so the caller sets its one time uniforms again
+  int Update();
+  // Stops the worker and deletes the programs that were never swapped in
+  void Delete();
+
+private:
+  struct Program
+  {
+    Shader *shader;
+    std::string vertexFile, fragmentFile;
+  };
+  struct Rebuilt
+  {
+    Shader *target;
+    std::unique_ptr<Shader> program;
+    // Signaled once the worker's context has finished building the program
+    GLsync fence;
+  };
+
+  std::function<void()> makeCurrent, release;
+  std::mutex mutex;
+  std::vector<Program> programs;
+  std::vector<Rebuilt> finished;
+  std::atomic<bool> running;
+  std::thread worker;
+
+  // inotify descriptor and the directory of every watch, -1 when polling modification times
+  int inotifyFd;
+  std::unordered_map<int, std::string> watchedDirectories;
+  // Last seen modification times, used when polling
+  std::unordered_map<std::string, long long> modificationTimes;
+
+  void workerLoop();
+  // Waits a short while for edits and returns the paths of the files that changed
+  std::vector<std::string> waitForChanges();
+  // Builds a new program from the current files, queues it for Update on success
+  void rebuild(const Program &program);
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef SPRITE_BATCH_CLASS_H
+#define SPRITE_BATCH_CLASS_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "shaderClass.h"
+#include "VAO.h"
+#include "EBO.h"
+#include "StreamingBuffer.h"
+
+// Draws large numbers of textured quads with as few draw calls as possible.
+//
+// Draw only appends the sprite to CPU side arrays (one per attribute). End sorts the sprites
+// by (layer, shader, texture), writes their vertices in that order into a StreamingBuffer and
+// issues one glDrawElementsBaseVertex per run of equal keys, so the number of draw calls is
+// the number of distinct layer/shader/texture combinations, not the number of sprites.
+// Sprites within a run keep the order they were drawn in.
+//
+// Per frame usage:
+//   batch.Begin(projection);
+//   batch.Draw(shader, texture.ID, position, size);   // any number of times
+//   batch.End();
+//
+// The programs need the layout of res/shaders/sprite.vert and a mat4 "projection" uniform.
+// Depth testing and blending are left to the caller.
+class SpriteBatch
+{
+public:
+  // Vertex layout written into the streaming buffer
+  struct Vertex
+  {
+    GLfloat x, y;
+    GLfloat u, v;
+    // RGBA8, divided by 255 in the vertex shader
+    GLubyte color[4];
+  };
+
+  // Sprites drawn and draw calls issued by the last End
+  unsigned long spriteCount, drawCalls;
+
+  // Constructor that allocates room for maxSprites per flush, larger batches are split
+  SpriteBatch(GLsizei maxSprites);
+
+  // Starts a new batch, projection maps sprite positions to clip space
+  void Begin(const glm::mat4 &projection);
+  // Queues a sprite. The rectangle spans position to position + size, uv is (u0, v0, u1, v1).
+  // Lower layers are drawn first
+  void Draw(Shader &shader, GLuint texture, const glm::vec2 &position, const glm::vec2 &size,
+            const glm::vec4 &uv = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+            const glm::vec4 &color = glm::vec4(1.0f), uint8_t layer = 0);
+  // Sorts and draws every queued sprite
+  void End();
+  // Deletes the buffers
+  void Delete();
+
+private:
+  GLsizei maxSprites;
+  glm::mat4 projection;
+
+  VAO vao;
+  StreamingBuffer vertices;
+  EBO indices;
+
+  // Queued sprites, one array per attribute
+  std::vector<float> x, y, width, height;
+  std::vector<glm::vec4> uvs;
+  std::vector<uint32_t> colors;
+  // Sort key: layer in bits 56-63, shader slot in bits 40-55, texture in bits 0-39
+  std::vector<uint64_t> keys;
+
+  // Programs seen this batch, the key stores their slot
+  std::vector<Shader *> shaders;
+  // Sprite indices in draw order, filled by End
+  std::vector<uint32_t> order;
+
+  // Returns the slot of a program, adding it if it is new this batch
+  uint64_t shaderSlot(Shader &shader);
+  // Writes and draws order[first, first + count)
+  void flush(size_t first, size_t count);
+};
+
+#endif
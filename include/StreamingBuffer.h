@@ -0,0 +1,61 @@
+#ifndef STREAMING_BUFFER_CLASS_H
+#define STREAMING_BUFFER_CLASS_H
+
+#include <glad/glad.h>
+
+// Buffer for data that is rewritten every frame (dynamic vertices, indices, instance data).
+// It is split into SEGMENT_COUNT segments used round robin: while the GPU reads the
+// segment of frame N, the CPU already writes the one of frame N + 1.
+//
+// With OpenGL 4.4 the whole buffer is mapped once, persistently,
+// and a fence per segment keeps the CPU from overwriting data the GPU still uses.
+// Otherwise (OpenGL 3.3 to 4.3) every Map orphans the buffer so the driver hands out fresh memory.
+//
+// Per frame usage:
+//   void *data = buffer.Map();          // at most segmentSize bytes
+//   ... write vertices ...
+//   buffer.Unmap();
+//   ... draw, reading from buffer.offset (e.g. baseVertex = buffer.offset / stride) ...
+//   buffer.Fence();
+class StreamingBuffer
+{
+public:
+  // Number of segments the buffer is split into
+  static const int SEGMENT_COUNT = 3;
+
+  // ID reference of the buffer object
+  GLuint ID;
+  // Target the buffer is bound to, e.g. GL_ARRAY_BUFFER
+  GLenum target;
+  // Bytes available per frame
+  GLsizeiptr segmentSize;
+  // Byte offset of the segment returned by the last Map
+  GLintptr offset;
+  // True when the persistent mapping path is used
+  bool persistent;
+  // Number of times Map had to wait for the GPU to release a segment
+  unsigned long stalls;
+
+  // Constructor that generates a buffer with room for segmentSize bytes per frame
+  StreamingBuffer(GLenum target, GLsizeiptr segmentSize);
+
+  // Returns a write only pointer to the next segment, waiting for the GPU if it is still reading it
+  void *Map();
+  // Ends writing to the current segment
+  void Unmap();
+  // Marks the current segment as in use by the draw calls issued so far
+  void Fence();
+  // Binds the buffer
+  void Bind();
+  // Unbinds the buffer
+  void Unbind();
+  // Deletes the buffer and its fences
+  void Delete();
+
+private:
+  unsigned char *mapped;
+  GLsync fences[SEGMENT_COUNT];
+  int segment;
+};
+
+#endif
@@ -7,13 +7,17 @@
 #include <stb_image.h>
 
 #include "shaderClass.h"
+#include "TexturePack.h"
 
 class Texture
 {
 public:
   GLuint ID;
   GLenum type;
+  // Loads an image with stb_image, or a .dds/.ktx2 container of block compressed data
   Texture(const char *image, GLenum texType, GLenum slot, GLenum format, GLenum pixelType);
+  // Uploads a baked texture and its mip chain straight from a memory mapped TexturePack
+  Texture(const TexturePack &pack, const char *name, GLenum texType, GLenum slot);
 
   // Assigns a texture unit to a texture
   void texUnit(Shader &shader, const char *uniform, GLuint unit);
@@ -23,5 +27,9 @@ public:
   void Unbind();
   // Deletes a texture
   void Delete();
+
+private:
+  // Uploads a block compressed DDS/KTX2 image and its stored mip chain
+  void loadCompressed(const char *image, GLenum slot);
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef TEXTURE_COMPRESSOR_H
+#define TEXTURE_COMPRESSOR_H
+
+#include <vector>
+
+// Block compressed formats the offline compressor can encode
+enum BlockFormat
+{
+  BLOCK_BC1, // RGB, 4 bits per pixel
+  BLOCK_BC3, // RGBA, 8 bits per pixel
+  BLOCK_BC7  // RGBA, 8 bits per pixel, higher quality (mode 6 only)
+};
+
+// Encodes a 4x4 block of RGBA8 pixels (row major, 64 bytes)
+void compress_bc1_block(const unsigned char *rgba, unsigned char *out);
+void compress_bc3_block(const unsigned char *rgba, unsigned char *out);
+void compress_bc7_block(const unsigned char *rgba, unsigned char *out);
+
+// Encodes a whole RGBA8 image, edge blocks are padded by repeating the last row/column
+std::vector<unsigned char> compress_image(const unsigned char *rgba, int width, int height, BlockFormat format);
+
+// Writes compressed mip levels (largest first) to a DDS file
+bool write_dds(const char *filename, BlockFormat format, bool srgb, int width, int height,
+               const std::vector<std::vector<unsigned char>> &levels);
+
+#endif
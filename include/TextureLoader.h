@@ -0,0 +1,124 @@
+#ifndef TEXTURE_LOADER_CLASS_H
+#define TEXTURE_LOADER_CLASS_H
+
+#include <glad/glad.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "JobSystem.h"
+#include "StreamingBuffer.h"
+#include "CompressedImage.h"
+#include "TexturePack.h"
+#include "MipChain.h"
+
+// Texture that is decoded by a job and uploaded over several frames.
+// Until it is ready, Bind binds the loader's placeholder texture instead
+class AsyncTexture
+{
+public:
+  enum State
+  {
+    DECODING,
+    UPLOADING,
+    READY,
+    FAILED
+  };
+
+  // ID reference of the texture, 0 until the upload starts
+  GLuint ID;
+  GLenum type;
+  // Image file the texture is loaded from
+  std::string image;
+  std::atomic<int> state;
+
+  AsyncTexture(const char *image, GLenum texType, GLuint placeholder);
+
+  // True once every mip level is uploaded
+  bool Ready() const;
+  // Binds the texture, or the placeholder while it is still loading
+  void Bind();
+  // Unbinds a texture
+  void Unbind();
+  // Deletes the texture
+  void Delete();
+
+private:
+  friend class TextureLoader;
+
+  GLuint placeholder;
+  // Decoded pixels, owned by stb_image until the upload is done
+  unsigned char *bytes;
+  int width, height, numColCh;
+  // Mip levels below level 0, built by the job that decoded the image
+  std::vector<MipLevel> mips;
+  // Next row to upload within the current level
+  int uploadedRows;
+  // Contents of a .dds/.ktx2 file, uploaded by rows of blocks
+  std::unique_ptr<CompressedImage> compressed;
+  // Baked texture inside a memory mapped pack, uploaded by rows of blocks or of pixels
+  const TexturePack *pack;
+  const TexturePack::Entry *packEntry;
+  size_t uploadedLevels;
+};
+
+// Decodes images as jobs and uploads them on the GL thread through a pixel buffer
+// object, never more than uploadBudget bytes per frame, so loading many textures
+// doesn't stall any single frame
+class TextureLoader
+{
+public:
+  // Bytes copied to the GPU per Update call
+  GLsizeiptr uploadBudget;
+
+  // Constructor that creates the placeholder texture, images are decoded as background jobs of
+  // jobs, which needs worker threads besides the GL thread. Must be called on the GL thread, which has to
+  // be the one that created jobs
+  TextureLoader(JobSystem &jobs, GLsizeiptr uploadBudget);
+
+  // Queues an image for decoding and returns its handle right away
+  std::shared_ptr<AsyncTexture> Load(const char *image, GLenum texType);
+  // Queues a baked texture of a pack for upload, there is nothing to decode. The pack must outlive the upload
+  std::shared_ptr<AsyncTexture> Load(const TexturePack &pack, const char *name, GLenum texType);
+  // Uploads decoded images within the per frame budget, call once per frame on the GL thread
+  void Update();
+  // Number of textures that are not ready (or failed) yet
+  size_t Pending();
+  // Keeps updating until every queued texture is ready, for runs that need a deterministic scene
+  void WaitAll();
+  // Waits for the decoding jobs that already started and deletes the placeholder
+  void Delete();
+
+private:
+  GLuint placeholder;
+  StreamingBuffer pixelBuffer;
+
+  JobSystem *jobs;
+  std::mutex mutex;
+  std::condition_variable decodedSignal;
+  // Textures waiting for a decoding job, and textures waiting for the GL thread
+  std::deque<std::shared_ptr<AsyncTexture>> decodeQueue;
+  std::deque<std::shared_ptr<AsyncTexture>> uploadQueue;
+  size_t pending;
+  // Decoding jobs that haven't finished, one per image Load queued
+  size_t decoding;
+
+  // Job that decodes the next image of the decode queue, data is the loader
+  static void decodeJob(JobSystem &jobs, Job *job, const void *data);
+  // Decodes the next image of the decode queue, if there still is one
+  void decodeNext();
+  // Runs a queued decoding job on the calling thread, or waits for one to finish when there are none
+  void helpDecode();
+  // Uploads as many rows of a texture and its mip levels as the remaining budget allows, returns the bytes used.
+  // The levels come from the decoded image and its mip chain, or from an uncompressed texture of a pack
+  GLsizeiptr uploadRows(AsyncTexture &texture, GLsizeiptr budget);
+  // Uploads as many block rows of a compressed texture and its mip levels as the remaining budget allows, returns
+  // the bytes used
+  GLsizeiptr uploadLevels(AsyncTexture &texture, GLsizeiptr budget);
+};
+
+#endif
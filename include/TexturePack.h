@@ -0,0 +1,76 @@
+#ifndef TEXTURE_PACK_CLASS_H
+#define TEXTURE_PACK_CLASS_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+
+// Binary pack of pre-decoded, pre-mipmapped textures written by texbake.
+//
+// Layout (little endian):
+//   Header                      magic "TPAK", version, texture count
+//   Entry[textureCount]         name, GL formats and the byte range of every mip level
+//   level data                  each level starts on a PACK_ALIGNMENT boundary
+//
+// The file is memory mapped and levels are handed to glTexImage2D straight from the
+// mapping, so loading costs page faults and a driver copy, no decoding at all
+class TexturePack
+{
+public:
+  static const uint32_t VERSION = 1;
+  static const uint32_t MAX_LEVELS = 16;
+  static const uint32_t NAME_LENGTH = 64;
+  // Level data is aligned to pages so every level maps to whole pages
+  static const uint64_t PACK_ALIGNMENT = 4096;
+
+  struct Header
+  {
+    char magic[4];
+    uint32_t version;
+    uint32_t textureCount;
+    uint32_t reserved;
+  };
+
+  struct Level
+  {
+    uint64_t offset;
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+  };
+
+  struct Entry
+  {
+    // File name of the source image without directory and extension, e.g. "img1"
+    char name[NAME_LENGTH];
+    // Sized internal format, e.g. GL_RGB8, or a compressed format
+    uint32_t internalFormat;
+    // Pixel format and type of the data, both 0 for compressed formats
+    uint32_t format;
+    uint32_t type;
+    uint32_t levelCount;
+    Level levels[MAX_LEVELS];
+  };
+
+  // Start of the mapped file and its size in bytes
+  const unsigned char *data;
+  size_t size;
+
+  // Constructor that memory maps a pack, exits if it is missing or malformed
+  TexturePack(const char *filename);
+
+  // Returns the entry of a texture, nullptr if the pack doesn't contain it
+  const Entry *Find(const char *name) const;
+  // Uploads one mip level of an entry into the texture bound to target
+  void UploadLevel(const Entry &entry, GLenum target, uint32_t level) const;
+  // Bytes a level of width x height needs in the entry's format, 0 for formats a pack can't hold
+  static uint64_t LevelSize(const Entry &entry, uint32_t width, uint32_t height);
+  // Unmaps the pack
+  void Delete();
+
+private:
+  const Header *header() const;
+  const Entry *entries() const;
+};
+
+#endif
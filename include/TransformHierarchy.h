@@ -0,0 +1,80 @@
+#ifndef TRANSFORM_HIERARCHY_CLASS_H
+#define TRANSFORM_HIERARCHY_CLASS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "JobSystem.h"
+
+// Parent of nodes without one
+const uint32_t TRANSFORM_ROOT = 0xFFFFFFFF;
+// Nodes of one level a job updates, smaller levels are updated on the calling thread alone
+const uint32_t TRANSFORM_JOB_NODES = 4096;
+
+// Scene graph of transforms stored as flat arrays instead of a tree of objects.
+//
+// Nodes are kept sorted by depth, so every level is a contiguous range and each parent comes
+// before its children: Update walks the levels in order computing world = parent world * local,
+// and the nodes of one level don't depend on each other, so each level is split into jobs.
+// Within a level nodes are sorted by parent, so the parents' matrices are read in order.
+// Local transforms are position, rotation and scale in separate arrays, world matrices are one
+// contiguous array, ready to upload as instance data.
+//
+// Changing a local transform marks the node dirty, Update only recomputes dirty nodes and the
+// nodes below them. Nodes are addressed by the handle Add returns, which stays valid when
+// adding nodes reorders the arrays
+class TransformHierarchy
+{
+public:
+  // Local transforms and world matrices, indexed by slot (see Slot), in depth order
+  std::vector<glm::vec3> positions;
+  std::vector<glm::quat> rotations;
+  std::vector<glm::vec3> scales;
+  std::vector<glm::mat4> worlds;
+  // Slot of each node's parent, TRANSFORM_ROOT for roots
+  std::vector<uint32_t> parents;
+  // Slots where each depth starts, the last entry is the number of nodes (current after Update)
+  std::vector<uint32_t> levels;
+
+  // Constructor that makes an empty hierarchy
+  TransformHierarchy();
+
+  // Adds a node below parent (a handle, or TRANSFORM_ROOT) and returns its handle
+  uint32_t Add(uint32_t parent, const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale);
+  // Replaces a node's local transform
+  void SetLocal(uint32_t node, const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale);
+  // Replaces only the rotation of a node
+  void SetRotation(uint32_t node, const glm::quat &rotation);
+  // World matrix of a node as of the last Update
+  const glm::mat4 &World(uint32_t node) const { return worlds[slots[node]]; }
+  // Slot of a node in the arrays, changes when nodes are added
+  uint32_t Slot(uint32_t node) const { return slots[node]; }
+  // Number of nodes
+  size_t Size() const { return parents.size(); }
+
+  // Recomputes the world matrices of dirty nodes and their descendants. With a job system,
+  // levels of more than TRANSFORM_JOB_NODES nodes are split into jobs
+  void Update(JobSystem *jobs = nullptr);
+
+private:
+  // Handle to slot and slot to handle
+  std::vector<uint32_t> slots;
+  std::vector<uint32_t> handles;
+  // Depth of each slot, roots are 0
+  std::vector<uint32_t> depths;
+  // Set for nodes whose world matrix has to be recomputed, also for nodes Update recomputed
+  // so their children see it
+  std::vector<uint8_t> dirty;
+  // False once a node was added out of depth and parent order, Update sorts again
+  bool sorted;
+
+  // Reorders every array by depth, and within a depth by parent
+  void sort();
+  // Recomputes the dirty nodes among slots first..first + count - 1
+  void updateRange(uint32_t first, uint32_t count);
+};
+
+#endif
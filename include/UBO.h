@@ -0,0 +1,28 @@
+#ifndef UBO_CLASS_H
+#define UBO_CLASS_H
+
+#include <glad/glad.h>
+
+class UBO
+{
+public:
+  // ID reference of the Uniform Buffer Object
+  GLuint ID;
+  // Binding point every Shader program reads the block from
+  GLuint binding;
+  // Size of the buffer in bytes
+  GLsizeiptr size;
+  // Constructor that generates a Uniform Buffer Object of a given size and attaches it to a binding point
+  UBO(GLsizeiptr size, GLuint binding);
+
+  // Overwrites the contents of the UBO starting at offset
+  void Update(const void *data, GLsizeiptr dataSize, GLintptr offset = 0);
+  // Binds the UBO
+  void Bind();
+  // Unbinds the UBO
+  void Unbind();
+  // Deletes the UBO
+  void Delete();
+};
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef UNIFORM_BLOCKS_H
+#define UNIFORM_BLOCKS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Uniform blocks shared by every Shader program. Each block has a fixed
+// binding point, Shader connects blocks it finds by name after linking,
+// so a UBO bound there once feeds all programs.
+
+// Binding point of the "Camera" block
+const GLuint CAMERA_BLOCK_BINDING = 0;
+
+// Mirrors the std140 layout of the "Camera" block in the shaders:
+//   layout(std140) uniform Camera { mat4 view; mat4 proj; };
+struct CameraBlock
+{
+  glm::mat4 view;
+  glm::mat4 proj;
+};
+static_assert(sizeof(CameraBlock) == 2 * 64, "CameraBlock must match the std140 layout");
+
+// Name and binding point of every shared block
+struct UniformBlockBinding
+{
+  const char *name;
+  GLuint binding;
+};
+const UniformBlockBinding UNIFORM_BLOCK_BINDINGS[] = {
+    {"Camera", CAMERA_BLOCK_BINDING},
+};
+
+#endif
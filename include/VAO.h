@@ -3,6 +3,8 @@
 
 #include <glad/glad.h>
 #include "VBO.h"
+#include "StreamingBuffer.h"
+#include "VertexFormat.h"
 
 class VAO
 {
@@ -12,8 +14,21 @@ public:
   // Constructor that generates a VAO ID
   VAO();
 
-  // Links a VBO to the VAO using a certain layout
-  void LinkAttrib(VBO &VBO, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, void *offset);
+  // Links a VBO to the VAO using a certain layout.
+  // A divisor above 0 makes the attribute per instance, advancing once every divisor instances
+  void LinkAttrib(VBO &VBO, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, void *offset,
+                  GLuint divisor = 0);
+  // Links a StreamingBuffer to the VAO, draws pick the current segment with a base vertex
+  // (per instance data needs the base instance of glDrawElementsInstancedBaseVertexBaseInstance, GL 4.2)
+  void LinkAttrib(StreamingBuffer &buffer, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride,
+                  void *offset, GLuint divisor = 0);
+  // Links every attribute of an interleaved VBO laid out as format, with its type and normalization
+  void LinkFormat(VBO &VBO, const VertexFormat &format, GLuint divisor = 0);
+  // Links a mat4 attribute, which takes the four locations layout to layout + 3, one per column
+  void LinkMat4Attrib(VBO &VBO, GLuint layout, GLsizeiptr stride, void *offset, GLuint divisor = 1);
+  void LinkMat4Attrib(StreamingBuffer &buffer, GLuint layout, GLsizeiptr stride, void *offset, GLuint divisor = 1);
+  // Names the VAO for debug messages and capture tools, it has to have been bound once
+  void Label(const char *name);
   // Binds the VAO
   void Bind();
   // Unbinds the VAO
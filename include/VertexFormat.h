@@ -0,0 +1,43 @@
+#ifndef VERTEX_FORMAT_CLASS_H
+#define VERTEX_FORMAT_CLASS_H
+
+#include <glad/glad.h>
+#include <vector>
+
+// Layout of an interleaved vertex buffer: which attribute sits where, in which type.
+// Attributes are stored 4 byte aligned, so a half float vec3 still takes 8 bytes.
+//
+// The compact types (GL_HALF_FLOAT, normalized GL_UNSIGNED_BYTE/GL_UNSIGNED_SHORT and
+// GL_INT_2_10_10_10_REV) arrive in the vertex shader as floats, shaders don't change.
+class VertexFormat
+{
+public:
+  struct Attribute
+  {
+    // Shader input location
+    GLuint location;
+    // Components stored, GL_INT_2_10_10_10_REV always stores 4
+    GLint components;
+    // GL_FLOAT, GL_HALF_FLOAT, GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_INT_2_10_10_10_REV
+    GLenum type;
+    // Integers are mapped to [0, 1] (unsigned) or [-1, 1] (signed) instead of converted as they are
+    GLboolean normalized;
+    // Bytes from the start of the vertex
+    GLuint offset;
+  };
+
+  std::vector<Attribute> attributes;
+  // Bytes per vertex
+  GLsizei stride;
+
+  // Constructor of an empty format
+  VertexFormat();
+
+  // Appends an attribute after the previous ones
+  VertexFormat &Add(GLuint location, GLint components, GLenum type, GLboolean normalized = GL_FALSE);
+};
+
+// Bytes an attribute of the given type and component count takes, before alignment
+GLuint vertex_attribute_size(GLint components, GLenum type);
+
+#endif
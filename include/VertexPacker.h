@@ -0,0 +1,45 @@
+#ifndef VERTEX_PACKER_H
+#define VERTEX_PACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MeshLoader.h"
+#include "VertexFormat.h"
+
+// Where pack_vertices reads one attribute from, in floats from the start of a source vertex
+struct VertexSource
+{
+  size_t offset;
+  int components;
+};
+
+// A mesh converted to compact_mesh_format. Positions are stored relative to the mesh bounds,
+// the original position is packed * positionScale + positionOffset (fold it into the model matrix)
+struct PackedMesh
+{
+  std::vector<unsigned char> vertices;
+  VertexFormat format;
+  float positionScale[3];
+  float positionOffset[3];
+};
+
+// Converts float vertices (stride floats apart) into the attributes of format, reading attribute i
+// from sources[i]. Components the source lacks are filled in as (0, 0, 0, 1), normalized
+// types clamp to their range and every conversion rounds to nearest
+std::vector<unsigned char> pack_vertices(const float *vertices, size_t vertexCount, size_t stride,
+                                         const VertexFormat &format, const VertexSource *sources);
+
+// 16 bytes per vertex instead of the 32 of MeshVertex: half float position (padded to 4 components),
+// GL_INT_2_10_10_10_REV normal and unorm16 texture coordinates, or half floats when they tile outside [0, 1]
+VertexFormat compact_mesh_format(bool unitTexCoords);
+// Packs a mesh into compact_mesh_format, positions are first mapped into [-1, 1] for the most precision
+PackedMesh pack_mesh(const MeshData &mesh);
+
+// Nearest half float of a float, overflowing to infinity, the scalar conversion the SIMD paths match
+uint16_t float_to_half(float value);
+// Name of the SIMD code path compiled in: "F16C", "SSE2", "NEON" or "scalar"
+const char *vertex_simd_path();
+
+#endif
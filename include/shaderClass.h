@@ -7,6 +7,12 @@
 #include <sstream>
 #include <iostream>
 #include <cerrno>
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#include <glm/glm.hpp>
+
+#include "ProgramCache.h"
 
 std::string get_file_contents(const char *filename);
 
@@ -15,13 +21,55 @@ class Shader
 public:
   // Reference ID of the Shader Program
   GLuint ID;
-  // Constructor that build the Shader Program from 2 different shaders
-  Shader(const char *vertexFile, const char *fragmentFile);
+  // Constructor that build the Shader Program from 2 different shaders.
+  // With a cache the linked binary is loaded from disk when the sources and driver are unchanged.
+  // Without wait the program is only submitted to the driver, which may compile it on its own
+  // threads, and the first Activate or Finish waits for it (see ShaderBatch)
+  Shader(const char *vertexFile, const char *fragmentFile, ProgramCache *cache = nullptr, bool wait = true);
 
   void checkCompileErrors(GLuint shader, const std::string &type);
-  // Activates the Shader Program
+  // True once Finish won't block, never waits for the driver
+  bool Ready() const;
+  // Waits for the driver to finish compiling and linking, then checks for errors and caches the uniforms
+  void Finish();
+  // True if the program linked, only meaningful once it is finished
+  bool Linked() const;
+  // Activates the Shader Program, finishing it first if needed
   void Activate();
   // Deletes the Shader Program
   void Delete();
+
+  // Returns the cached location of a uniform, -1 if the program has no such active uniform.
+  // The program must be finished, unfinished programs have no uniforms yet
+  GLint GetUniformLocation(const char *name) const;
+  // Sets a uniform of the Shader Program, which must be active
+  void setMat4(const char *name, const glm::mat4 &value) const;
+  void setFloat(const char *name, GLfloat value) const;
+  void setInt(const char *name, GLint value) const;
+
+  // Number of glGetUniformLocation calls made into the driver, only during construction in steady state
+  static std::atomic<unsigned long> driverLookups;
+
+private:
+  // Shader objects and cache key of a program the driver is still building, pending until Finish
+  bool pending;
+  GLuint vertexShader, fragmentShader;
+  ProgramCache *cache;
+  uint64_t cacheKey;
+
+  // Open addressing table of the active uniforms, filled once after linking
+  struct UniformSlot
+  {
+    std::uint32_t hash;
+    GLint location;
+    std::string name;
+  };
+  std::vector<UniformSlot> uniformTable;
+
+  // Queries every active uniform of the linked program and caches its location
+  void cacheUniforms();
+  void insertUniform(const std::string &name, GLint location);
+  // Connects every shared uniform block the program uses to its binding point
+  void bindUniformBlocks();
 };
 #endif
\ No newline at end of file
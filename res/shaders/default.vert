@@ -3,19 +3,26 @@
 layout(location=0)in vec3 aPos;
 layout(location=1)in vec3 aColor;
 layout(location=2)in vec2 aTex;
+// Per instance transform, takes locations 3 to 6
+layout(location=3)in mat4 aInstance;
 
 out vec3 color;
 out vec2 texCoord;
 
 uniform float scale;
 
-uniform float model;
-uniform float view;
-uniform float proj;
+uniform mat4 model;
+
+// Shared by every program, written once per frame (see UniformBlocks.h)
+layout(std140)uniform Camera
+{
+  mat4 view;
+  mat4 proj;
+};
 
 void main()
 {
-  gl_Position=gl_Position=proj*view*model*vec4(aPos,1.);
+  gl_Position=proj*view*model*aInstance*vec4(aPos,1.);
   color=aColor;
   texCoord=aTex;
 }
\ No newline at end of file
@@ -0,0 +1,19 @@
+#version 330 core
+
+layout(location=0)in vec2 aPos;
+layout(location=1)in vec2 aTex;
+layout(location=2)in vec4 aColor;
+
+out vec4 color;
+out vec2 texCoord;
+
+// Maps sprite positions to clip space, set by SpriteBatch
+uniform mat4 projection;
+
+void main()
+{
+  gl_Position=projection*vec4(aPos,0.,1.);
+  // Colors arrive as unnormalized RGBA8
+  color=aColor/255.;
+  texCoord=aTex;
+}
\ No newline at end of file
@@ -0,0 +1,460 @@
+#include "BVH.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// Half the surface area of a box, the SAH only compares areas so the factor 2 doesn't matter
+static float half_area(const float min[3], const float max[3])
+{
+  float x = max[0] - min[0], y = max[1] - min[1], z = max[2] - min[2];
+  return x * y + y * z + z * x;
+}
+
+// Grows the box min..max to contain the box boxMin..boxMax
+static void grow(float min[3], float max[3], const float boxMin[3], const float boxMax[3])
+{
+  for (int axis = 0; axis < 3; axis++)
+  {
+    min[axis] = std::min(min[axis], boxMin[axis]);
+    max[axis] = std::max(max[axis], boxMax[axis]);
+  }
+}
+
+// Empties the box min..max so the first grow sets it
+static void reset(float min[3], float max[3])
+{
+  for (int axis = 0; axis < 3; axis++)
+  {
+    min[axis] = INFINITY;
+    max[axis] = -INFINITY;
+  }
+}
+
+// Bucket of the SAH sweep a box falls into along an axis, by its doubled centroid
+static int bin_index(const float min[3], const float max[3], int axis, float centroidMin, float binScale, int binCount)
+{
+  return std::min(binCount - 1, (int)((min[axis] + max[axis] - centroidMin) * binScale));
+}
+
+// Adds an object and returns its index, it takes part in queries after the next Build
+uint32_t BVH::Add(const glm::vec3 &min, const glm::vec3 &max)
+{
+  boxes.push_back(Box());
+  Update((uint32_t)boxes.size() - 1, min, max);
+  return (uint32_t)boxes.size() - 1;
+}
+
+// Moves an object, the nodes follow at the next Refit
+void BVH::Update(uint32_t object, const glm::vec3 &min, const glm::vec3 &max)
+{
+  for (int axis = 0; axis < 3; axis++)
+  {
+    boxes[object].min[axis] = min[axis];
+    boxes[object].max[axis] = max[axis];
+  }
+}
+
+// Removes every object and node
+void BVH::Clear()
+{
+  boxes.clear();
+  objects.clear();
+  nodes.clear();
+  ranges.clear();
+}
+
+// Sets a node's box to the union of its objects' boxes
+void BVH::fitLeaf(BVHNode &node) const
+{
+  reset(node.min, node.max);
+  for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+    grow(node.min, node.max, boxes[objects[i]].min, boxes[objects[i]].max);
+}
+
+// Builds the tree from scratch over every object
+void BVH::Build()
+{
+  nodes.clear();
+  ranges.clear();
+  objects.resize(boxes.size());
+  std::iota(objects.begin(), objects.end(), 0);
+  if (boxes.empty())
+    return;
+  building.resize(boxes.size());
+  for (size_t i = 0; i < boxes.size(); i++)
+    building[i] = {boxes[i], (uint32_t)i};
+
+  // A binary tree with one object per leaf has 2n - 1 nodes, so this never reallocates
+  nodes.reserve(2 * boxes.size());
+  ranges.reserve(2 * boxes.size());
+  BVHNode root;
+  root.leftOrFirst = 0;
+  root.count = (uint32_t)boxes.size();
+  fitLeaf(root);
+  nodes.push_back(root);
+  ranges.push_back({root.leftOrFirst, root.count});
+
+  // Depth first with an explicit stack, large scenes make deep trees
+  std::vector<uint32_t> stack(1, 0);
+  while (!stack.empty())
+  {
+    uint32_t nodeIndex = stack.back();
+    stack.pop_back();
+    if (split(nodeIndex))
+    {
+      stack.push_back(nodes[nodeIndex].leftOrFirst + 1);
+      stack.push_back(nodes[nodeIndex].leftOrFirst);
+    }
+  }
+  for (size_t i = 0; i < building.size(); i++)
+    objects[i] = building[i].object;
+}
+
+// Splits a leaf in two where the SAH is lowest, returns false when it stays a leaf
+bool BVH::split(uint32_t nodeIndex)
+{
+  BVHNode node = nodes[nodeIndex];
+  if (node.count < BVH_MIN_SPLIT_OBJECTS)
+    return false;
+  uint32_t first = node.leftOrFirst;
+  uint32_t last = first + node.count;
+
+  // Objects are binned by their centroid (kept doubled, min + max, which sorts the same)
+  float centroidMin[3], centroidMax[3];
+  reset(centroidMin, centroidMax);
+  for (uint32_t i = first; i < last; i++)
+    for (int axis = 0; axis < 3; axis++)
+    {
+      float centroid = building[i].box.min[axis] + building[i].box.max[axis];
+      centroidMin[axis] = std::min(centroidMin[axis], centroid);
+      centroidMax[axis] = std::max(centroidMax[axis], centroid);
+    }
+
+  // One pass sorts every object into a bin along each of the three axes. Small nodes, which
+  // are most of them, get fewer bins: a bin per object already finds most good splits
+  int binCount = (int)std::min<uint32_t>(BVH_BINS, node.count);
+  struct Bin
+  {
+    float min[3], max[3];
+    uint32_t count;
+  } bins[3][BVH_BINS];
+  float binScale[3];
+  for (int axis = 0; axis < 3; axis++)
+  {
+    float extent = centroidMax[axis] - centroidMin[axis];
+    binScale[axis] = extent > 0.0f ? binCount / extent : 0.0f;
+    for (int b = 0; b < binCount; b++)
+    {
+      reset(bins[axis][b].min, bins[axis][b].max);
+      bins[axis][b].count = 0;
+    }
+  }
+  for (uint32_t i = first; i < last; i++)
+  {
+    const Box &box = building[i].box;
+    for (int axis = 0; axis < 3; axis++)
+    {
+      Bin &bin = bins[axis][bin_index(box.min, box.max, axis, centroidMin[axis], binScale[axis], binCount)];
+      grow(bin.min, bin.max, box.min, box.max);
+      bin.count++;
+    }
+  }
+
+  float bestCost = INFINITY;
+  int bestAxis = -1;
+  int bestSplit = 0;
+  for (int axis = 0; axis < 3; axis++)
+  {
+    // Every centroid in one plane, nothing to split along this axis
+    if (binScale[axis] == 0.0f)
+      continue;
+
+    // Sweeps from the left storing area * count of every prefix, then from the right adding the suffix
+    float leftCost[BVH_BINS - 1];
+    float min[3], max[3];
+    reset(min, max);
+    uint32_t count = 0;
+    for (int split = 1; split < binCount; split++)
+    {
+      grow(min, max, bins[axis][split - 1].min, bins[axis][split - 1].max);
+      count += bins[axis][split - 1].count;
+      leftCost[split - 1] = count > 0 ? count * half_area(min, max) : INFINITY;
+    }
+    reset(min, max);
+    count = 0;
+    for (int split = binCount - 1; split > 0; split--)
+    {
+      grow(min, max, bins[axis][split].min, bins[axis][split].max);
+      count += bins[axis][split].count;
+      float cost = leftCost[split - 1] + (count > 0 ? count * half_area(min, max) : INFINITY);
+      if (cost < bestCost)
+      {
+        bestCost = cost;
+        bestAxis = axis;
+        bestSplit = split;
+      }
+    }
+  }
+
+  // Every centroid in the same place, no split separates them
+  if (bestAxis < 0)
+    return false;
+  // Visiting a node costs about as much as testing one object, stay a leaf when that's cheaper
+  float area = half_area(node.min, node.max);
+  if (bestCost + area >= node.count * area && node.count <= BVH_MAX_LEAF_OBJECTS)
+    return false;
+
+  BuildObject *middle = std::partition(building.data() + first, building.data() + last, [&](const BuildObject &object)
+                                       { return bin_index(object.box.min, object.box.max, bestAxis, centroidMin[bestAxis],
+                                                          binScale[bestAxis], binCount) < bestSplit; });
+  uint32_t leftCount = (uint32_t)(middle - building.data()) - first;
+
+  // The children's boxes are the unions of the bins on either side of the split
+  BVHNode left, right;
+  left.leftOrFirst = first;
+  left.count = leftCount;
+  right.leftOrFirst = first + leftCount;
+  right.count = node.count - leftCount;
+  reset(left.min, left.max);
+  reset(right.min, right.max);
+  for (int b = 0; b < binCount; b++)
+  {
+    BVHNode &child = b < bestSplit ? left : right;
+    grow(child.min, child.max, bins[bestAxis][b].min, bins[bestAxis][b].max);
+  }
+  nodes[nodeIndex].leftOrFirst = (uint32_t)nodes.size();
+  nodes[nodeIndex].count = 0;
+  nodes.push_back(left);
+  nodes.push_back(right);
+  ranges.push_back({left.leftOrFirst, left.count});
+  ranges.push_back({right.leftOrFirst, right.count});
+  return true;
+}
+
+// Recomputes every node box from the current object boxes, keeping the tree
+void BVH::Refit()
+{
+  // Children come after their parent, walking backwards fits them first
+  for (size_t i = nodes.size(); i-- > 0;)
+  {
+    BVHNode &node = nodes[i];
+    if (node.IsLeaf())
+      fitLeaf(node);
+    else
+    {
+      const BVHNode &left = nodes[node.leftOrFirst];
+      const BVHNode &right = nodes[node.leftOrFirst + 1];
+      for (int axis = 0; axis < 3; axis++)
+      {
+        node.min[axis] = std::min(left.min[axis], right.min[axis]);
+        node.max[axis] = std::max(left.max[axis], right.max[axis]);
+      }
+    }
+  }
+}
+
+// Expected cost of a query relative to testing the root alone (the SAH cost), lower is better
+float BVH::Cost() const
+{
+  if (nodes.empty())
+    return 0.0f;
+  // A query reaches a node with a probability of its area over the root's, then pays 1 per
+  // node visited and 1 per object tested
+  double cost = 0.0;
+  for (const BVHNode &node : nodes)
+    cost += (double)half_area(node.min, node.max) * (node.IsLeaf() ? node.count : 1);
+  float rootArea = half_area(nodes[0].min, nodes[0].max);
+  return rootArea > 0.0f ? (float)(cost / rootArea) : (float)boxes.size();
+}
+
+// Writes the objects whose box touches the frustum to visible, returns how many there are
+size_t BVH::QueryFrustum(const Frustum &frustum, uint32_t *visible) const
+{
+  if (nodes.empty())
+    return 0;
+  float absolute[6][3];
+  for (int plane = 0; plane < 6; plane++)
+    for (int i = 0; i < 3; i++)
+      absolute[plane][i] = std::fabs(frustum.planes[plane][i]);
+
+  // Distance from the box's center to the plane, and how far the box reaches towards it
+  auto distance = [&](int plane, const float min[3], const float max[3], float &reach)
+  {
+    const float *p = frustum.planes[plane];
+    reach = 0.0f;
+    float d = p[3];
+    for (int axis = 0; axis < 3; axis++)
+    {
+      d += p[axis] * (min[axis] + max[axis]) * 0.5f;
+      reach += absolute[plane][axis] * (max[axis] - min[axis]) * 0.5f;
+    }
+    return d;
+  };
+
+  // Each entry carries the planes its node still has to be tested against: once a node is
+  // entirely inside a plane so is everything below it, and with none left the subtree is visible
+  struct Entry
+  {
+    uint32_t node;
+    uint32_t planes;
+  };
+  std::vector<Entry> stack;
+  stack.reserve(64);
+  stack.push_back({0, 0x3F});
+  size_t count = 0;
+  while (!stack.empty())
+  {
+    Entry entry = stack.back();
+    stack.pop_back();
+    const BVHNode &node = nodes[entry.node];
+
+    bool outside = false;
+    for (int plane = 0; plane < 6 && !outside; plane++)
+    {
+      if (!(entry.planes & (1 << plane)))
+        continue;
+      float reach;
+      float d = distance(plane, node.min, node.max, reach);
+      outside = d + reach < 0.0f;
+      if (d - reach >= 0.0f)
+        entry.planes &= ~(1 << plane);
+    }
+    if (outside)
+      continue;
+
+    if (entry.planes == 0)
+    {
+      const Range &range = ranges[entry.node];
+      std::copy(objects.begin() + range.first, objects.begin() + range.first + range.count, visible + count);
+      count += range.count;
+      continue;
+    }
+    if (!node.IsLeaf())
+    {
+      stack.push_back({node.leftOrFirst + 1, entry.planes});
+      stack.push_back({node.leftOrFirst, entry.planes});
+      continue;
+    }
+    for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+    {
+      const Box &box = boxes[objects[i]];
+      bool inside = true;
+      for (int plane = 0; plane < 6 && inside; plane++)
+      {
+        float reach;
+        inside = !(entry.planes & (1 << plane)) || distance(plane, box.min, box.max, reach) + reach >= 0.0f;
+      }
+      if (inside)
+        visible[count++] = objects[i];
+    }
+  }
+  return count;
+}
+
+// Writes the objects whose box overlaps the box min..max to overlapping, returns how many there are
+size_t BVH::QueryBox(const glm::vec3 &min, const glm::vec3 &max, uint32_t *overlapping) const
+{
+  if (nodes.empty())
+    return 0;
+  auto overlaps = [&](const float boxMin[3], const float boxMax[3])
+  {
+    return boxMin[0] <= max.x && boxMax[0] >= min.x && boxMin[1] <= max.y && boxMax[1] >= min.y &&
+           boxMin[2] <= max.z && boxMax[2] >= min.z;
+  };
+
+  std::vector<uint32_t> stack;
+  stack.reserve(64);
+  stack.push_back(0);
+  size_t count = 0;
+  while (!stack.empty())
+  {
+    const BVHNode &node = nodes[stack.back()];
+    stack.pop_back();
+    if (!overlaps(node.min, node.max))
+      continue;
+    if (!node.IsLeaf())
+    {
+      stack.push_back(node.leftOrFirst + 1);
+      stack.push_back(node.leftOrFirst);
+      continue;
+    }
+    for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+      if (overlaps(boxes[objects[i]].min, boxes[objects[i]].max))
+        overlapping[count++] = objects[i];
+  }
+  return count;
+}
+
+// Distance along the ray where it enters the box (0 when it starts inside), or INFINITY when it misses
+// the box before maxDistance. Slab test with the reciprocal of the direction
+static float ray_box(const float min[3], const float max[3], const glm::vec3 &origin, const glm::vec3 &inverse,
+                     float maxDistance)
+{
+  float enter = 0.0f, exit = maxDistance;
+  for (int axis = 0; axis < 3; axis++)
+  {
+    float t0 = (min[axis] - origin[axis]) * inverse[axis];
+    float t1 = (max[axis] - origin[axis]) * inverse[axis];
+    enter = std::max(enter, std::min(t0, t1));
+    exit = std::min(exit, std::max(t0, t1));
+  }
+  return enter <= exit ? enter : INFINITY;
+}
+
+// Finds the object whose box the ray enters first within maxDistance, returns false when it hits nothing
+bool BVH::Raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, uint32_t &object,
+                  float &distance) const
+{
+  if (nodes.empty())
+    return false;
+  glm::vec3 inverse(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+  // Nodes are pushed with the distance the ray enters them, the nearer child is visited first
+  // and anything entered beyond the closest hit so far is skipped
+  struct Entry
+  {
+    uint32_t node;
+    float enter;
+  };
+  std::vector<Entry> stack;
+  stack.reserve(64);
+  float enter = ray_box(nodes[0].min, nodes[0].max, origin, inverse, maxDistance);
+  if (enter != INFINITY)
+    stack.push_back({0, enter});
+  float closest = maxDistance;
+  bool hit = false;
+  while (!stack.empty())
+  {
+    Entry entry = stack.back();
+    stack.pop_back();
+    if (entry.enter > closest)
+      continue;
+    const BVHNode &node = nodes[entry.node];
+    if (node.IsLeaf())
+    {
+      for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++)
+      {
+        float t = ray_box(boxes[objects[i]].min, boxes[objects[i]].max, origin, inverse, closest);
+        if (t != INFINITY && t <= closest)
+        {
+          closest = t;
+          object = objects[i];
+          hit = true;
+        }
+      }
+      continue;
+    }
+
+    Entry left = {node.leftOrFirst, ray_box(nodes[node.leftOrFirst].min, nodes[node.leftOrFirst].max, origin, inverse, closest)};
+    Entry right = {node.leftOrFirst + 1, ray_box(nodes[node.leftOrFirst + 1].min, nodes[node.leftOrFirst + 1].max, origin, inverse, closest)};
+    if (left.enter > right.enter)
+      std::swap(left, right);
+    if (right.enter != INFINITY)
+      stack.push_back(right);
+    if (left.enter != INFINITY)
+      stack.push_back(left);
+  }
+  if (hit)
+    distance = closest;
+  return hit;
+}
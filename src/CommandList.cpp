@@ -0,0 +1,85 @@
+#include "CommandList.h"
+#include <algorithm>
+#include <cstring>
+
+// Packets start at multiples of this, enough for any of their members
+const size_t PACKET_ALIGNMENT = 16;
+
+// Constructor that makes an empty list
+CommandList::CommandList()
+    : frame(0), used(0)
+{
+}
+
+// Removes every packet, keeping the memory
+void CommandList::Reset(uint64_t frame)
+{
+  this->frame = frame;
+  used = 0;
+}
+
+// Appends a packet of size bytes (header included) and returns it
+void *CommandList::add(RenderCommandType type, size_t size)
+{
+  size = (size + PACKET_ALIGNMENT - 1) & ~(PACKET_ALIGNMENT - 1);
+  if (used + size > bytes.size())
+    bytes.resize(std::max(used + size, bytes.size() * 2));
+  RenderCommand *command = (RenderCommand *)&bytes[used];
+  command->type = type;
+  command->size = (uint32_t)size;
+  used += size;
+  return command;
+}
+
+// Sets the area of the framebuffer drawn to
+void CommandList::Viewport(int x, int y, int width, int height)
+{
+  ViewportCommand *command = (ViewportCommand *)add(RENDER_COMMAND_VIEWPORT, sizeof(ViewportCommand));
+  command->x = x;
+  command->y = y;
+  command->width = width;
+  command->height = height;
+}
+
+// Clears color and depth
+void CommandList::Clear(float red, float green, float blue, float alpha)
+{
+  ClearCommand *command = (ClearCommand *)add(RENDER_COMMAND_CLEAR, sizeof(ClearCommand));
+  command->color[0] = red;
+  command->color[1] = green;
+  command->color[2] = blue;
+  command->color[3] = alpha;
+}
+
+// Sets the view and projection matrices
+void CommandList::Camera(const glm::mat4 &view, const glm::mat4 &proj)
+{
+  CameraCommand *command = (CameraCommand *)add(RENDER_COMMAND_CAMERA, sizeof(CameraCommand));
+  command->view = view;
+  command->proj = proj;
+}
+
+// Draws runs of instances with a model matrix and the shader's scale
+void CommandList::DrawInstances(const glm::mat4 &model, float scale, const InstanceRun *runs, uint32_t runCount)
+{
+  DrawInstancesCommand *command = (DrawInstancesCommand *)add(
+      RENDER_COMMAND_DRAW_INSTANCES, sizeof(DrawInstancesCommand) + runCount * sizeof(InstanceRun));
+  command->model = model;
+  command->scale = scale;
+  command->runCount = runCount;
+  if (runCount > 0)
+    memcpy((unsigned char *)command + sizeof(DrawInstancesCommand), runs, runCount * sizeof(InstanceRun));
+}
+
+// First packet, null when the list is empty
+const RenderCommand *CommandList::First() const
+{
+  return used > 0 ? (const RenderCommand *)bytes.data() : nullptr;
+}
+
+// Packet after command, null after the last one
+const RenderCommand *CommandList::Next(const RenderCommand *command) const
+{
+  size_t offset = (const unsigned char *)command - bytes.data() + command->size;
+  return offset < used ? (const RenderCommand *)&bytes[offset] : nullptr;
+}
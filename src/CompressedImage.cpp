@@ -0,0 +1,346 @@
+#include "CompressedImage.h"
+#include "GLExtensions.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+// Reads a little endian 32 bit value
+static uint32_t read_u32(const unsigned char *bytes)
+{
+  return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+// Reads a little endian 64 bit value
+static uint64_t read_u64(const unsigned char *bytes)
+{
+  return (uint64_t)read_u32(bytes) | ((uint64_t)read_u32(bytes + 4) << 32);
+}
+
+static bool ends_with(const std::string &text, const char *suffix)
+{
+  size_t length = strlen(suffix);
+  if (text.size() < length)
+    return false;
+  std::string tail = text.substr(text.size() - length);
+  std::transform(tail.begin(), tail.end(), tail.begin(), ::tolower);
+  return tail == suffix;
+}
+
+// True if the file name ends in .dds or .ktx2
+bool is_compressed_image(const char *filename)
+{
+  return ends_with(filename, ".dds") || ends_with(filename, ".ktx2");
+}
+
+// Bytes per 4x4 block of a compressed format, 0 for unknown formats
+GLsizei compressed_block_size(GLenum format)
+{
+  switch (format)
+  {
+  case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+  case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+  case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+  case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+  case GL_COMPRESSED_RGB8_ETC2:
+  case GL_COMPRESSED_SRGB8_ETC2:
+  case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+  case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+    return 8;
+  case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+  case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+  case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+  case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+  case GL_COMPRESSED_RGBA_BPTC_UNORM:
+  case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+  case GL_COMPRESSED_RGBA8_ETC2_EAC:
+  case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+    return 16;
+  default:
+    return 0;
+  }
+}
+
+// Bytes of one mip level of a compressed format
+size_t compressed_level_size(GLenum format, GLsizei width, GLsizei height)
+{
+  size_t blocksX = std::max<GLsizei>(1, (width + 3) / 4);
+  size_t blocksY = std::max<GLsizei>(1, (height + 3) / 4);
+  return blocksX * blocksY * compressed_block_size(format);
+}
+
+// True if the current context can sample the given compressed format
+bool compressed_format_supported(GLenum format)
+{
+  switch (format)
+  {
+  case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+  case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+  case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+  case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    return has_gl_extension("GL_EXT_texture_compression_s3tc");
+  case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+  case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+  case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+  case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+    return has_gl_extension("GL_EXT_texture_compression_s3tc") &&
+           (has_gl_extension("GL_EXT_texture_sRGB") || has_gl_extension("GL_EXT_texture_compression_s3tc_srgb"));
+  case GL_COMPRESSED_RGBA_BPTC_UNORM:
+  case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+    return GLAD_GL_VERSION_4_2 || has_gl_extension("GL_ARB_texture_compression_bptc");
+  case GL_COMPRESSED_RGB8_ETC2:
+  case GL_COMPRESSED_SRGB8_ETC2:
+  case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+  case GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+  case GL_COMPRESSED_RGBA8_ETC2_EAC:
+  case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+    return GLAD_GL_VERSION_4_3 || has_gl_extension("GL_ARB_ES3_compatibility");
+  default:
+    return false;
+  }
+}
+
+// Fills in the level table of an image whose levels are stored back to back from offset
+// True if the header's size and level count describe a texture OpenGL can take, the level
+// count at most that of a full mip chain
+static bool valid_layout(uint32_t width, uint32_t height, uint32_t levelCount)
+{
+  if (width == 0 || height == 0 || width > INT32_MAX || height > INT32_MAX)
+    return false;
+  uint32_t fullChain = 1;
+  for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+    fullChain++;
+  return levelCount <= fullChain;
+}
+
+static bool layout_levels(CompressedImage &image, size_t offset, uint32_t levelCount)
+{
+  GLsizei width = image.width, height = image.height;
+  for (uint32_t i = 0; i < std::max<uint32_t>(levelCount, 1); i++)
+  {
+    size_t size = compressed_level_size(image.format, width, height);
+    if (offset > image.data.size() || size > image.data.size() - offset)
+      return false;
+    image.levels.push_back({width, height, offset, size});
+    offset += size;
+    width = std::max(1, width / 2);
+    height = std::max(1, height / 2);
+  }
+  return true;
+}
+
+// Maps a DXGI_FORMAT of the DDS DX10 header to an OpenGL format
+static GLenum dxgi_to_gl(uint32_t dxgiFormat)
+{
+  switch (dxgiFormat)
+  {
+  case 71: // DXGI_FORMAT_BC1_UNORM
+    return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+  case 72: // DXGI_FORMAT_BC1_UNORM_SRGB
+    return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+  case 74: // DXGI_FORMAT_BC2_UNORM
+    return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+  case 75: // DXGI_FORMAT_BC2_UNORM_SRGB
+    return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;
+  case 77: // DXGI_FORMAT_BC3_UNORM
+    return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+  case 78: // DXGI_FORMAT_BC3_UNORM_SRGB
+    return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+  case 98: // DXGI_FORMAT_BC7_UNORM
+    return GL_COMPRESSED_RGBA_BPTC_UNORM;
+  case 99: // DXGI_FORMAT_BC7_UNORM_SRGB
+    return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+  default:
+    return 0;
+  }
+}
+
+// Maps a VkFormat of the KTX2 header to an OpenGL format
+static GLenum vk_to_gl(uint32_t vkFormat)
+{
+  switch (vkFormat)
+  {
+  case 131: // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+    return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+  case 132: // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+    return GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+  case 133: // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+    return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+  case 134: // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+    return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+  case 135: // VK_FORMAT_BC2_UNORM_BLOCK
+    return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+  case 136: // VK_FORMAT_BC2_SRGB_BLOCK
+    return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;
+  case 137: // VK_FORMAT_BC3_UNORM_BLOCK
+    return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+  case 138: // VK_FORMAT_BC3_SRGB_BLOCK
+    return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+  case 145: // VK_FORMAT_BC7_UNORM_BLOCK
+    return GL_COMPRESSED_RGBA_BPTC_UNORM;
+  case 146: // VK_FORMAT_BC7_SRGB_BLOCK
+    return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+  case 147: // VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK
+    return GL_COMPRESSED_RGB8_ETC2;
+  case 148: // VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK
+    return GL_COMPRESSED_SRGB8_ETC2;
+  case 149: // VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK
+    return GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2;
+  case 150: // VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK
+    return GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2;
+  case 151: // VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK
+    return GL_COMPRESSED_RGBA8_ETC2_EAC;
+  case 152: // VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK
+    return GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC;
+  default:
+    return 0;
+  }
+}
+
+static bool parse_dds(const char *filename, CompressedImage &image)
+{
+  const std::vector<unsigned char> &bytes = image.data;
+  if (bytes.size() < 128 || memcmp(bytes.data(), "DDS ", 4) != 0)
+  {
+    std::cerr << "Error: " << filename << " is not a DDS file" << std::endl;
+    return false;
+  }
+
+  // DDS_HEADER follows the magic, DDS_PIXELFORMAT starts at byte 76
+  uint32_t height = read_u32(&bytes[12]);
+  uint32_t width = read_u32(&bytes[16]);
+  uint32_t levelCount = read_u32(&bytes[28]);
+  uint32_t pixelFlags = read_u32(&bytes[80]);
+  const unsigned char *fourCC = &bytes[84];
+  size_t dataOffset = 128;
+  if (!valid_layout(width, height, levelCount))
+  {
+    std::cerr << "Error: " << filename << " has an invalid size or level count" << std::endl;
+    return false;
+  }
+  image.width = (GLsizei)width;
+  image.height = (GLsizei)height;
+
+  const uint32_t DDPF_FOURCC = 0x4, DDPF_ALPHAPIXELS = 0x1;
+  image.format = 0;
+  if (pixelFlags & DDPF_FOURCC)
+  {
+    if (memcmp(fourCC, "DXT1", 4) == 0)
+      image.format = (pixelFlags & DDPF_ALPHAPIXELS) ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    else if (memcmp(fourCC, "DXT3", 4) == 0)
+      image.format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+    else if (memcmp(fourCC, "DXT5", 4) == 0)
+      image.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    else if (memcmp(fourCC, "DX10", 4) == 0 && bytes.size() >= 148)
+    {
+      // DDS_HEADER_DXT10 follows the main header
+      image.format = dxgi_to_gl(read_u32(&bytes[128]));
+      uint32_t dimension = read_u32(&bytes[132]);
+      uint32_t arraySize = read_u32(&bytes[140]);
+      if (dimension != 3 || arraySize > 1)
+      {
+        std::cerr << "Error: " << filename << " is not a single 2D texture" << std::endl;
+        return false;
+      }
+      dataOffset = 148;
+    }
+  }
+
+  if (image.format == 0)
+  {
+    std::cerr << "Error: " << filename << " uses a pixel format that is not supported" << std::endl;
+    return false;
+  }
+
+  if (!layout_levels(image, dataOffset, levelCount))
+  {
+    std::cerr << "Error: " << filename << " is truncated" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+static bool parse_ktx2(const char *filename, CompressedImage &image)
+{
+  static const unsigned char KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+  const std::vector<unsigned char> &bytes = image.data;
+  if (bytes.size() < 80 || memcmp(bytes.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+  {
+    std::cerr << "Error: " << filename << " is not a KTX2 file" << std::endl;
+    return false;
+  }
+
+  uint32_t vkFormat = read_u32(&bytes[12]);
+  uint32_t pixelWidth = read_u32(&bytes[20]);
+  // 1D textures have a height of 0
+  uint32_t pixelHeight = std::max<uint32_t>(read_u32(&bytes[24]), 1);
+  uint32_t depth = read_u32(&bytes[28]);
+  uint32_t layerCount = read_u32(&bytes[32]);
+  uint32_t faceCount = read_u32(&bytes[36]);
+  uint32_t levelCount = std::max<uint32_t>(read_u32(&bytes[40]), 1);
+  uint32_t supercompression = read_u32(&bytes[44]);
+
+  image.format = vk_to_gl(vkFormat);
+  if (image.format == 0)
+  {
+    std::cerr << "Error: " << filename << " uses VkFormat " << vkFormat << " which is not supported" << std::endl;
+    return false;
+  }
+  if (depth > 1 || layerCount > 1 || faceCount != 1 || supercompression != 0)
+  {
+    std::cerr << "Error: " << filename << " is not a single, non supercompressed 2D texture" << std::endl;
+    return false;
+  }
+
+  if (!valid_layout(pixelWidth, pixelHeight, levelCount))
+  {
+    std::cerr << "Error: " << filename << " has an invalid size or level count" << std::endl;
+    return false;
+  }
+  image.width = (GLsizei)pixelWidth;
+  image.height = (GLsizei)pixelHeight;
+
+  // The level index follows the 80 byte header, one {offset, length, uncompressed length} per level
+  if ((bytes.size() - 80) / 24 < levelCount)
+  {
+    std::cerr << "Error: " << filename << " is truncated" << std::endl;
+    return false;
+  }
+  GLsizei width = image.width, height = image.height;
+  for (uint32_t i = 0; i < levelCount; i++)
+  {
+    size_t entry = 80 + (size_t)i * 24;
+    uint64_t offset = read_u64(&bytes[entry]);
+    uint64_t length = read_u64(&bytes[entry + 8]);
+    if (offset > bytes.size() || length > bytes.size() - offset ||
+        length < compressed_level_size(image.format, width, height))
+    {
+      std::cerr << "Error: " << filename << " has an invalid level " << i << std::endl;
+      return false;
+    }
+    image.levels.push_back({width, height, (size_t)offset, (size_t)length});
+    width = std::max(1, width / 2);
+    height = std::max(1, height / 2);
+  }
+  return true;
+}
+
+// Reads a DDS or KTX2 file, prints the reason and returns false if it can't be used
+bool load_compressed_image(const char *filename, CompressedImage &image)
+{
+  std::ifstream in(filename, std::ios::binary);
+  if (!in)
+  {
+    std::cerr << "Error: Failed to open " << filename << std::endl;
+    return false;
+  }
+  image.data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  image.levels.clear();
+
+  if (ends_with(filename, ".ktx2"))
+    return parse_ktx2(filename, image);
+  return parse_dds(filename, image);
+}
@@ -0,0 +1,206 @@
+#include "DebugOutput.h"
+#include "GLCheck.h"
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Occurrences of a message id printed before its repeats are only counted
+const unsigned long PRINT_LIMIT = 3;
+// Seconds between two summaries of the muted repeats
+const double SUMMARY_INTERVAL = 1.0;
+// glObjectLabel fails on labels longer than GL_MAX_LABEL_LENGTH, which is at least 256
+const size_t MAX_LABEL_LENGTH = 255;
+
+// Everything the log knows about one message id
+struct MessageStats
+{
+  GLenum source, type;
+  GLuint id;
+  std::string message;
+  unsigned long count;
+  // Repeats since the last summary that were not printed
+  unsigned long muted;
+};
+
+unsigned long DebugOutput::received = 0;
+unsigned long DebugOutput::printed = 0;
+
+static bool installed = false;
+static bool synchronous = false;
+// Asynchronous output may call back on any driver thread
+static std::mutex statsMutex;
+// Keyed by source, type and id, ids are only unique within their source and type
+static std::map<unsigned long long, MessageStats> stats;
+// Debug groups open on the render thread, names the pass in synchronous messages
+static std::vector<std::string> groups;
+static std::chrono::steady_clock::time_point lastSummary;
+
+// Short name of a message type for the log
+static const char *type_name(GLenum type)
+{
+  switch (type)
+  {
+  case GL_DEBUG_TYPE_ERROR:
+    return "error";
+  case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+    return "deprecated";
+  case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+    return "undefined behavior";
+  case GL_DEBUG_TYPE_PORTABILITY:
+    return "portability";
+  case GL_DEBUG_TYPE_PERFORMANCE:
+    return "performance";
+  case GL_DEBUG_TYPE_MARKER:
+    return "marker";
+  default:
+    return "message";
+  }
+}
+
+// Prints one message, errors as errors and everything else as warnings
+static void print_message(const MessageStats &entry, const char *message, unsigned long repeats)
+{
+  std::ostream &out = std::cerr;
+  out << (entry.type == GL_DEBUG_TYPE_ERROR ? "Error: " : "Warning: ") << "GL " << type_name(entry.type)
+      << " 0x" << std::hex << entry.id << std::dec;
+  if (synchronous && !groups.empty())
+  {
+    out << " in ";
+    for (size_t i = 0; i < groups.size(); i++)
+      out << (i > 0 ? "/" : "") << groups[i];
+  }
+  if (repeats > 0)
+    out << " repeated " << repeats << " times";
+  out << ": " << message << std::endl;
+}
+
+// Counts every message, prints the first PRINT_LIMIT of each id
+static void GLAPIENTRY message_callback(GLenum source, GLenum type, GLuint id, GLenum,
+                                        GLsizei length, const GLchar *message, const void *)
+{
+  if (type == GL_DEBUG_TYPE_ERROR)
+    gl_error_reported = true;
+
+  std::lock_guard<std::mutex> lock(statsMutex);
+  DebugOutput::received++;
+
+  unsigned long long key = ((unsigned long long)source << 48) ^ ((unsigned long long)type << 32) ^ id;
+  MessageStats &entry = stats[key];
+  if (entry.count == 0)
+  {
+    entry.source = source;
+    entry.type = type;
+    entry.id = id;
+  }
+  entry.count++;
+  entry.message.assign(message, length >= 0 ? (size_t)length : std::char_traits<char>::length(message));
+
+  if (entry.count > PRINT_LIMIT)
+  {
+    entry.muted++;
+    return;
+  }
+  print_message(entry, entry.message.c_str(), 0);
+  DebugOutput::printed++;
+}
+
+// Installs the message callback on the current context, returns false without KHR_debug
+bool DebugOutput::Install(bool synchronousOutput)
+{
+  // glad only loads the KHR_debug entry points with a 4.3 context
+  if (glDebugMessageCallback == nullptr)
+    return false;
+
+  synchronous = synchronousOutput;
+  glEnable(GL_DEBUG_OUTPUT);
+  if (synchronous)
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  else
+    glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  glDebugMessageCallback(message_callback, nullptr);
+
+  // Notifications are per call chatter (buffer placement and the like), our own groups
+  // echo back as messages too. Everything else, performance warnings included, is kept
+  glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+  glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_PUSH_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+  glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_POP_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+
+  lastSummary = std::chrono::steady_clock::now();
+  installed = true;
+  return true;
+}
+
+// Returns true once Install succeeded
+bool DebugOutput::Installed()
+{
+  return installed;
+}
+
+// glPushDebugGroup, printed messages name the open groups
+void DebugOutput::PushGroup(const char *name)
+{
+  // Capture tools read the groups as well, so they don't depend on the callback
+  if (glPushDebugGroup == nullptr)
+    return;
+  glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+  groups.push_back(name);
+}
+
+// glPopDebugGroup
+void DebugOutput::PopGroup()
+{
+  if (glPopDebugGroup == nullptr || groups.empty())
+    return;
+  glPopDebugGroup();
+  groups.pop_back();
+}
+
+// glObjectLabel, the object has to exist
+void DebugOutput::Label(GLenum identifier, GLuint name, const std::string &label)
+{
+  if (glObjectLabel == nullptr)
+    return;
+  // Long paths keep their end, which is the part that tells objects apart
+  size_t start = label.size() > MAX_LABEL_LENGTH ? label.size() - MAX_LABEL_LENGTH : 0;
+  glObjectLabel(identifier, name, (GLsizei)(label.size() - start), label.c_str() + start);
+}
+
+// Prints how often the muted messages repeated, at most once per second
+void DebugOutput::Update()
+{
+  if (!installed)
+    return;
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (std::chrono::duration<double>(now - lastSummary).count() < SUMMARY_INTERVAL)
+    return;
+  lastSummary = now;
+
+  std::lock_guard<std::mutex> lock(statsMutex);
+  for (auto &pair : stats)
+  {
+    MessageStats &entry = pair.second;
+    if (entry.muted == 0)
+      continue;
+    print_message(entry, entry.message.c_str(), entry.muted);
+    entry.muted = 0;
+  }
+}
+
+// Writes every message id seen with its count
+void DebugOutput::Report(std::ostream &out)
+{
+  std::lock_guard<std::mutex> lock(statsMutex);
+  if (stats.empty())
+    return;
+
+  out << "GL debug messages: " << received << " received, " << printed << " printed\n";
+  for (const auto &pair : stats)
+  {
+    const MessageStats &entry = pair.second;
+    out << "  " << type_name(entry.type) << " 0x" << std::hex << entry.id << std::dec << " x" << entry.count
+        << ": " << entry.message << "\n";
+  }
+}
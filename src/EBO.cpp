@@ -1,27 +1,28 @@
 #include "EBO.h"
+#include "RenderState.h"
 
 // Constructor that generates a Elements Buffer Object and links it to indices
 EBO::EBO(GLuint *indices, GLsizeiptr size)
 {
   glGenBuffers(1, &ID);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
+  RenderState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, indices, GL_STATIC_DRAW);
 }
 
 // Binds the EBO
 void EBO::Bind()
 {
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
+  RenderState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
 }
 
 // Unbinds the EBO
 void EBO::Unbind()
 {
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  RenderState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 // Deletes the EBO
 void EBO::Delete()
 {
-  glDeleteBuffers(1, &ID);
+  RenderState::DeleteBuffer(ID);
 }
\ No newline at end of file
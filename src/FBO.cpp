@@ -0,0 +1,78 @@
+#include "FBO.h"
+#include "RenderState.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+
+// Constructor that generates a Framebuffer Object with an RGBA8 color and a depth attachment
+FBO::FBO(GLsizei width, GLsizei height)
+    : width(width), height(height)
+{
+  glGenFramebuffers(1, &ID);
+  RenderState::BindFramebuffer(GL_FRAMEBUFFER, ID);
+
+  // Color attachment the scene is rendered into
+  glGenRenderbuffers(1, &colorRBO);
+  glBindRenderbuffer(GL_RENDERBUFFER, colorRBO);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorRBO);
+
+  // Depth attachment so GL_DEPTH_TEST behaves like it does on a window
+  glGenRenderbuffers(1, &depthRBO);
+  glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+  {
+    std::cerr << "Error: Framebuffer is not complete (" << width << "x" << height << ")" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+// Binds the FBO as the draw and read framebuffer
+void FBO::Bind()
+{
+  RenderState::BindFramebuffer(GL_FRAMEBUFFER, ID);
+}
+
+// Unbinds the FBO, going back to the default framebuffer
+void FBO::Unbind()
+{
+  RenderState::BindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// Reads back the color attachment and writes it to a binary PPM image
+bool FBO::SavePPM(const char *filename)
+{
+  std::vector<unsigned char> pixels((size_t)width * height * 3);
+
+  Bind();
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+  std::ofstream out(filename, std::ios::binary);
+  if (!out)
+  {
+    std::cerr << "Error: Failed to open " << filename << " for writing" << std::endl;
+    return false;
+  }
+
+  out << "P6\n"
+      << width << " " << height << "\n255\n";
+  // OpenGL rows start at the bottom, PPM rows start at the top
+  for (GLsizei y = height - 1; y >= 0; y--)
+    out.write((const char *)&pixels[(size_t)y * width * 3], (std::streamsize)width * 3);
+
+  return (bool)out;
+}
+
+// Deletes the FBO and its attachments
+void FBO::Delete()
+{
+  glDeleteRenderbuffers(1, &colorRBO);
+  glDeleteRenderbuffers(1, &depthRBO);
+  RenderState::DeleteFramebuffer(ID);
+}
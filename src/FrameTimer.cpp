@@ -0,0 +1,175 @@
+#include "FrameTimer.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// Constructor that generates the GPU timer queries
+FrameTimer::FrameTimer(int warmupFrames)
+    : warmupFrames(warmupFrames), frameIndex(0)
+{
+  glGenQueries(QUERY_LATENCY, queries);
+  for (int i = 0; i < QUERY_LATENCY; i++)
+    queryFrame[i] = -1;
+}
+
+// Marks the start of a frame
+void FrameTimer::BeginFrame()
+{
+  // The slot is reused every QUERY_LATENCY frames, by now its result is (almost always) available
+  int slot = (int)(frameIndex % QUERY_LATENCY);
+  collect(slot);
+
+  cpuTimes.push_back(0.0);
+  gpuTimes.push_back(0.0);
+
+  frameStart = std::chrono::steady_clock::now();
+  glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+  queryFrame[slot] = frameIndex;
+}
+
+// Marks the end of a frame, after the last draw call was submitted
+void FrameTimer::EndFrame()
+{
+  glEndQuery(GL_TIME_ELAPSED);
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - frameStart;
+  cpuTimes[frameIndex] = elapsed.count();
+  frameIndex++;
+}
+
+// Waits for the outstanding GPU queries so every frame has a GPU time,
+// then drops the warm-up frames
+void FrameTimer::Finish()
+{
+  for (int i = 0; i < QUERY_LATENCY; i++)
+    collect(i);
+
+  size_t skipped = std::min<size_t>(std::max(warmupFrames, 0), cpuTimes.size());
+  cpuTimes.erase(cpuTimes.begin(), cpuTimes.begin() + skipped);
+  gpuTimes.erase(gpuTimes.begin(), gpuTimes.begin() + skipped);
+  warmupFrames = 0;
+}
+
+// Reads back the result of a query slot if it is in use
+void FrameTimer::collect(int slot)
+{
+  if (queryFrame[slot] < 0)
+    return;
+
+  GLuint64 nanoseconds = 0;
+  glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &nanoseconds);
+  gpuTimes[queryFrame[slot]] = nanoseconds / 1.0e6;
+  queryFrame[slot] = -1;
+}
+
+// Computes min/p50/p95/p99/max/mean of a series of timings
+FrameTimer::Summary FrameTimer::Summarize(std::vector<double> samples)
+{
+  Summary summary = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  if (samples.empty())
+    return summary;
+
+  std::sort(samples.begin(), samples.end());
+  // Nearest-rank percentile
+  auto percentile = [&samples](double p)
+  {
+    size_t rank = (size_t)std::ceil(p / 100.0 * samples.size());
+    return samples[std::max<size_t>(rank, 1) - 1];
+  };
+
+  double total = 0.0;
+  for (double sample : samples)
+    total += sample;
+
+  summary.min = samples.front();
+  summary.p50 = percentile(50.0);
+  summary.p95 = percentile(95.0);
+  summary.p99 = percentile(99.0);
+  summary.max = samples.back();
+  summary.mean = total / samples.size();
+  return summary;
+}
+
+// Prints the CPU and GPU summaries in a human readable table
+void FrameTimer::Report(std::ostream &out)
+{
+  Summary cpu = Summarize(cpuTimes);
+  Summary gpu = Summarize(gpuTimes);
+
+  out << "Frame times over " << cpuTimes.size() << " frames (ms)\n"
+      << std::fixed << std::setprecision(3)
+      << "         min       p50       p95       p99       max      mean\n";
+  const Summary *rows[] = {&cpu, &gpu};
+  const char *names[] = {"CPU", "GPU"};
+  for (int i = 0; i < 2; i++)
+  {
+    out << names[i]
+        << std::setw(9) << rows[i]->min << std::setw(10) << rows[i]->p50
+        << std::setw(10) << rows[i]->p95 << std::setw(10) << rows[i]->p99
+        << std::setw(10) << rows[i]->max << std::setw(10) << rows[i]->mean << "\n";
+  }
+  out << std::defaultfloat << std::flush;
+}
+
+// Escapes a string so it can be placed between JSON quotes
+static std::string json_escape(const char *text)
+{
+  std::string escaped;
+  for (const char *c = text; c != nullptr && *c != '\0'; c++)
+  {
+    if (*c == '"' || *c == '\\')
+      escaped += '\\';
+    if ((unsigned char)*c >= 0x20)
+      escaped += *c;
+  }
+  return escaped;
+}
+
+// Writes one summary and its samples as a JSON object
+static void write_series(std::ofstream &out, const char *name, const std::vector<double> &samples)
+{
+  FrameTimer::Summary summary = FrameTimer::Summarize(samples);
+  out << "  \"" << name << "\": {\n"
+      << "    \"min\": " << summary.min << ",\n"
+      << "    \"p50\": " << summary.p50 << ",\n"
+      << "    \"p95\": " << summary.p95 << ",\n"
+      << "    \"p99\": " << summary.p99 << ",\n"
+      << "    \"max\": " << summary.max << ",\n"
+      << "    \"mean\": " << summary.mean << ",\n"
+      << "    \"samples\": [";
+  for (size_t i = 0; i < samples.size(); i++)
+    out << (i == 0 ? "" : ", ") << samples[i];
+  out << "]\n  }";
+}
+
+// Writes the summaries and the raw samples as JSON
+bool FrameTimer::WriteJSON(const char *filename)
+{
+  std::ofstream out(filename);
+  if (!out)
+  {
+    std::cerr << "Error: Failed to open " << filename << " for writing" << std::endl;
+    return false;
+  }
+
+  out << std::setprecision(6)
+      << "{\n"
+      << "  \"renderer\": \"" << json_escape((const char *)glGetString(GL_RENDERER)) << "\",\n"
+      << "  \"version\": \"" << json_escape((const char *)glGetString(GL_VERSION)) << "\",\n"
+      << "  \"frames\": " << cpuTimes.size() << ",\n"
+      << "  \"unit\": \"ms\",\n";
+  write_series(out, "cpu", cpuTimes);
+  out << ",\n";
+  write_series(out, "gpu", gpuTimes);
+  out << "\n}\n";
+
+  return (bool)out;
+}
+
+// Deletes the GPU timer queries
+void FrameTimer::Delete()
+{
+  glDeleteQueries(QUERY_LATENCY, queries);
+}
@@ -0,0 +1,318 @@
+#include "FrustumCulling.h"
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CULLING_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CULLING_SIMD_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CULLING_SIMD_NEON
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Name of the SIMD code path compiled in: "AVX2", "SSE2", "NEON" or "scalar"
+const char *culling_simd_path()
+{
+#if defined(CULLING_SIMD_AVX2)
+  return "AVX2";
+#elif defined(CULLING_SIMD_SSE2)
+  return "SSE2";
+#elif defined(CULLING_SIMD_NEON)
+  return "NEON";
+#else
+  return "scalar";
+#endif
+}
+
+// Appends the object with the given box, its sphere is the one through the box's corners
+void CullingBounds::Add(const glm::vec3 &min, const glm::vec3 &max)
+{
+  centerX.push_back(0.0f);
+  centerY.push_back(0.0f);
+  centerZ.push_back(0.0f);
+  extentX.push_back(0.0f);
+  extentY.push_back(0.0f);
+  extentZ.push_back(0.0f);
+  radius.push_back(0.0f);
+  Set(Size() - 1, min, max);
+}
+
+// Replaces the box of object i, e.g. after it moved
+void CullingBounds::Set(size_t i, const glm::vec3 &min, const glm::vec3 &max)
+{
+  centerX[i] = (min.x + max.x) * 0.5f;
+  centerY[i] = (min.y + max.y) * 0.5f;
+  centerZ[i] = (min.z + max.z) * 0.5f;
+  extentX[i] = (max.x - min.x) * 0.5f;
+  extentY[i] = (max.y - min.y) * 0.5f;
+  extentZ[i] = (max.z - min.z) * 0.5f;
+  radius[i] = std::sqrt(extentX[i] * extentX[i] + extentY[i] * extentY[i] + extentZ[i] * extentZ[i]);
+}
+
+// Removes every object
+void CullingBounds::Clear()
+{
+  centerX.clear();
+  centerY.clear();
+  centerZ.clear();
+  extentX.clear();
+  extentY.clear();
+  extentZ.clear();
+  radius.clear();
+}
+
+// Planes of the frustum of a projection * view matrix (Gribb/Hartmann)
+Frustum extract_frustum(const glm::mat4 &viewProjection)
+{
+  // Clip space x, y and z each lie within [-w, w]: every plane is the last row plus or minus another
+  Frustum frustum;
+  for (int plane = 0; plane < 6; plane++)
+  {
+    int row = plane / 2;
+    float sign = plane % 2 == 0 ? 1.0f : -1.0f;
+    for (int column = 0; column < 4; column++)
+      frustum.planes[plane][column] = viewProjection[column][3] + sign * viewProjection[column][row];
+
+    float *p = frustum.planes[plane];
+    float length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+    if (length > 0.0f)
+      for (int i = 0; i < 4; i++)
+        p[i] /= length;
+  }
+  return frustum;
+}
+
+// Box containing the box min..max after the affine transform
+void transform_bounds(const glm::mat4 &transform, const glm::vec3 &min, const glm::vec3 &max, glm::vec3 &outMin,
+                      glm::vec3 &outMax)
+{
+  // Transform the center, and grow the extents by the absolute value of the matrix (Arvo)
+  glm::vec3 center = (min + max) * 0.5f;
+  glm::vec3 extent = (max - min) * 0.5f;
+  for (int row = 0; row < 3; row++)
+  {
+    float c = transform[3][row];
+    float e = 0.0f;
+    for (int column = 0; column < 3; column++)
+    {
+      c += transform[column][row] * center[column];
+      e += std::fabs(transform[column][row]) * extent[column];
+    }
+    outMin[row] = c - e;
+    outMax[row] = c + e;
+  }
+}
+
+// Plane normals with their components made positive, dotted with a box's extents they give
+// how far the box reaches towards the plane
+struct AbsolutePlanes
+{
+  float normals[6][3];
+
+  AbsolutePlanes(const Frustum &frustum)
+  {
+    for (int plane = 0; plane < 6; plane++)
+      for (int i = 0; i < 3; i++)
+        normals[plane][i] = std::fabs(frustum.planes[plane][i]);
+  }
+};
+
+// Tests one object, used for the objects left over after the SIMD loop
+static bool object_visible(const Frustum &frustum, const AbsolutePlanes &absolute, const CullingBounds &bounds,
+                           size_t i, bool boxes)
+{
+  for (int plane = 0; plane < 6; plane++)
+  {
+    const float *p = frustum.planes[plane];
+    float distance = p[0] * bounds.centerX[i] + p[1] * bounds.centerY[i] + p[2] * bounds.centerZ[i] + p[3];
+    if (boxes)
+    {
+      const float *n = absolute.normals[plane];
+      distance += n[0] * bounds.extentX[i] + n[1] * bounds.extentY[i] + n[2] * bounds.extentZ[i];
+    }
+    else
+      distance += bounds.radius[i];
+    if (distance < 0.0f)
+      return false;
+  }
+  return true;
+}
+
+// Index of the lowest set bit, mask must not be 0
+static unsigned int count_trailing_zeros(unsigned int mask)
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return (unsigned int)index;
+#else
+  return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+
+// Appends first + the index of every set bit of mask to visible
+static size_t append_visible(unsigned int mask, size_t first, uint32_t *visible, size_t count)
+{
+  while (mask != 0)
+  {
+    visible[count++] = (uint32_t)(first + count_trailing_zeros(mask));
+    mask &= mask - 1;
+  }
+  return count;
+}
+
+// Shared by both tests: an object is visible when its signed distance to every plane, plus
+// how far it reaches towards that plane (radius or projected extents), isn't negative.
+// Tests the objects first..objectCount - 1
+static size_t cull(const Frustum &frustum, const CullingBounds &bounds, uint32_t *visible, bool boxes, size_t first,
+                   size_t objectCount)
+{
+  AbsolutePlanes absolute(frustum);
+  size_t count = 0;
+  size_t i = first;
+
+#if defined(CULLING_SIMD_AVX2)
+  // 8 objects per iteration, the planes stay in registers
+  for (; i + 8 <= objectCount; i += 8)
+  {
+    __m256 cx = _mm256_loadu_ps(&bounds.centerX[i]);
+    __m256 cy = _mm256_loadu_ps(&bounds.centerY[i]);
+    __m256 cz = _mm256_loadu_ps(&bounds.centerZ[i]);
+    __m256 ex, ey, ez, r;
+    if (boxes)
+    {
+      ex = _mm256_loadu_ps(&bounds.extentX[i]);
+      ey = _mm256_loadu_ps(&bounds.extentY[i]);
+      ez = _mm256_loadu_ps(&bounds.extentZ[i]);
+    }
+    else
+      r = _mm256_loadu_ps(&bounds.radius[i]);
+
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (int plane = 0; plane < 6; plane++)
+    {
+      const float *p = frustum.planes[plane];
+      __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p[0]), cx), _mm256_set1_ps(p[3]));
+      distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(p[1]), cy));
+      distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(p[2]), cz));
+      if (boxes)
+      {
+        const float *n = absolute.normals[plane];
+        distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(n[0]), ex));
+        distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(n[1]), ey));
+        distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(n[2]), ez));
+      }
+      else
+        distance = _mm256_add_ps(distance, r);
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+    }
+    count = append_visible((unsigned int)_mm256_movemask_ps(inside), i, visible, count);
+  }
+#elif defined(CULLING_SIMD_SSE2)
+  // 4 objects per iteration
+  for (; i + 4 <= objectCount; i += 4)
+  {
+    __m128 cx = _mm_loadu_ps(&bounds.centerX[i]);
+    __m128 cy = _mm_loadu_ps(&bounds.centerY[i]);
+    __m128 cz = _mm_loadu_ps(&bounds.centerZ[i]);
+    __m128 ex, ey, ez, r;
+    if (boxes)
+    {
+      ex = _mm_loadu_ps(&bounds.extentX[i]);
+      ey = _mm_loadu_ps(&bounds.extentY[i]);
+      ez = _mm_loadu_ps(&bounds.extentZ[i]);
+    }
+    else
+      r = _mm_loadu_ps(&bounds.radius[i]);
+
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int plane = 0; plane < 6; plane++)
+    {
+      const float *p = frustum.planes[plane];
+      __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p[0]), cx), _mm_set1_ps(p[3]));
+      distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(p[1]), cy));
+      distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(p[2]), cz));
+      if (boxes)
+      {
+        const float *n = absolute.normals[plane];
+        distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(n[0]), ex));
+        distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(n[1]), ey));
+        distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(n[2]), ez));
+      }
+      else
+        distance = _mm_add_ps(distance, r);
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+    }
+    count = append_visible((unsigned int)_mm_movemask_ps(inside), i, visible, count);
+  }
+#elif defined(CULLING_SIMD_NEON)
+  // 4 objects per iteration, the lane bits are gathered with a horizontal add
+  const uint32_t laneBits[4] = {1, 2, 4, 8};
+  uint32x4_t bits = vld1q_u32(laneBits);
+  for (; i + 4 <= objectCount; i += 4)
+  {
+    float32x4_t cx = vld1q_f32(&bounds.centerX[i]);
+    float32x4_t cy = vld1q_f32(&bounds.centerY[i]);
+    float32x4_t cz = vld1q_f32(&bounds.centerZ[i]);
+    float32x4_t ex, ey, ez, r;
+    if (boxes)
+    {
+      ex = vld1q_f32(&bounds.extentX[i]);
+      ey = vld1q_f32(&bounds.extentY[i]);
+      ez = vld1q_f32(&bounds.extentZ[i]);
+    }
+    else
+      r = vld1q_f32(&bounds.radius[i]);
+
+    uint32x4_t inside = vdupq_n_u32(0xFFFFFFFF);
+    for (int plane = 0; plane < 6; plane++)
+    {
+      const float *p = frustum.planes[plane];
+      float32x4_t distance = vmlaq_n_f32(vdupq_n_f32(p[3]), cx, p[0]);
+      distance = vmlaq_n_f32(distance, cy, p[1]);
+      distance = vmlaq_n_f32(distance, cz, p[2]);
+      if (boxes)
+      {
+        const float *n = absolute.normals[plane];
+        distance = vmlaq_n_f32(distance, ex, n[0]);
+        distance = vmlaq_n_f32(distance, ey, n[1]);
+        distance = vmlaq_n_f32(distance, ez, n[2]);
+      }
+      else
+        distance = vaddq_f32(distance, r);
+      inside = vandq_u32(inside, vcgeq_f32(distance, vdupq_n_f32(0.0f)));
+    }
+    count = append_visible(vaddvq_u32(vandq_u32(inside, bits)), i, visible, count);
+  }
+#endif
+
+  for (; i < objectCount; i++)
+    if (object_visible(frustum, absolute, bounds, i, boxes))
+      visible[count++] = (uint32_t)i;
+  return count;
+}
+
+// Writes the indices of the objects whose sphere touches the frustum to visible, returns how many there are
+size_t cull_spheres(const Frustum &frustum, const CullingBounds &bounds, uint32_t *visible)
+{
+  return cull(frustum, bounds, visible, false, 0, bounds.Size());
+}
+
+// Same with the boxes, tighter than the spheres for a little more work
+size_t cull_boxes(const Frustum &frustum, const CullingBounds &bounds, uint32_t *visible)
+{
+  return cull(frustum, bounds, visible, true, 0, bounds.Size());
+}
+
+// Same as cull_boxes for the objects first..first + count - 1 only
+size_t cull_boxes_range(const Frustum &frustum, const CullingBounds &bounds, size_t first, size_t count,
+                        uint32_t *visible)
+{
+  return cull(frustum, bounds, visible, true, first, first + count);
+}
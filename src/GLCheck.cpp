@@ -0,0 +1,52 @@
+#include "GLCheck.h"
+#include "DebugOutput.h"
+#include <iostream>
+
+GLCheckMode gl_check_mode = GL_CHECK_DISABLED;
+bool gl_error_reported = false;
+
+// Frames between two glGetError validations, 0 never validates
+static int validationInterval = 0;
+// Frames since the last validation
+static int framesSinceValidation = 0;
+// Number of frames validated so far, for the report
+static unsigned long validatedFrames = 0;
+
+// Picks the check mode and installs the debug callback, call it once after gladLoadGL.
+// With validateInterval > 0 gl_validate_frame also drains glGetError every that many frames, in any build
+void gl_checks_init(int validateInterval)
+{
+  validationInterval = validateInterval;
+
+#if GL_CHECKS
+  // Synchronous output calls back inside the call that raised the error, so a breakpoint
+  // in the callback shows the culprit. It costs a little, which is fine in debug builds
+  if (!DebugOutput::Install(true))
+  {
+    gl_check_mode = GL_CHECK_GET_ERROR;
+    std::cout << "GL error checks: glGetError, KHR_debug is not available" << std::endl;
+    return;
+  }
+  gl_check_mode = GL_CHECK_DEBUG_OUTPUT;
+  std::cout << "GL error checks: KHR_debug callback" << std::endl;
+#endif
+}
+
+// Call once per frame, every validateInterval frames it reports the errors raised since the last validation
+void gl_validate_frame()
+{
+  if (validationInterval <= 0 || ++framesSinceValidation < validationInterval)
+    return;
+
+  // Errors are sticky flags, one per kind. A lost context keeps returning GL_CONTEXT_LOST, so stop eventually
+  for (int i = 0; i < 8; i++)
+  {
+    GLenum error = glGetError();
+    if (error == GL_NO_ERROR)
+      break;
+    std::cerr << "Warning: GL error 0x" << std::hex << error << std::dec << " raised in frames "
+              << validatedFrames << " to " << validatedFrames + framesSinceValidation - 1 << std::endl;
+  }
+  validatedFrames += framesSinceValidation;
+  framesSinceValidation = 0;
+}
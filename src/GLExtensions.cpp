@@ -0,0 +1,22 @@
+#include "GLExtensions.h"
+#include <string>
+#include <unordered_set>
+
+// Returns true if the current context exposes the given extension, e.g. "GL_ARB_buffer_storage".
+// The list is read from the driver on first use, call it after gladLoadGL
+bool has_gl_extension(const char *name)
+{
+  static std::unordered_set<std::string> extensions;
+  static bool loaded = false;
+
+  if (!loaded)
+  {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+      extensions.insert((const char *)glGetStringi(GL_EXTENSIONS, (GLuint)i));
+    loaded = true;
+  }
+
+  return extensions.count(name) != 0;
+}
@@ -0,0 +1,149 @@
+#include "HeadlessContext.h"
+#include "GLCheck.h"
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+
+// Returns true if the space separated extension list contains the given name
+static bool has_extension(const char *extensions, const char *name)
+{
+  if (extensions == nullptr)
+    return false;
+
+  size_t length = strlen(name);
+  for (const char *start = extensions; (start = strstr(start, name)) != nullptr; start += length)
+  {
+    bool atStart = start == extensions || start[-1] == ' ';
+    bool atEnd = start[length] == ' ' || start[length] == '\0';
+    if (atStart && atEnd)
+      return true;
+  }
+  return false;
+}
+
+// Opens the display and picks an OpenGL capable config
+void HeadlessContext::initializeDisplay()
+{
+  // Prefer the Mesa surfaceless platform, it needs neither X11 nor a DRM device
+  display = EGL_NO_DISPLAY;
+  const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  if (has_extension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+  {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay != nullptr)
+      display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+  }
+  if (display == EGL_NO_DISPLAY)
+    display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+  EGLint eglMajor, eglMinor;
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display, &eglMajor, &eglMinor))
+  {
+    std::cerr << "Error: Failed to initialize EGL display" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (!has_extension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context"))
+  {
+    std::cerr << "Error: EGL display does not support EGL_KHR_surfaceless_context" << std::endl;
+    eglTerminate(display);
+    exit(EXIT_FAILURE);
+  }
+
+  if (!eglBindAPI(EGL_OPENGL_API))
+  {
+    std::cerr << "Error: EGL does not support the desktop OpenGL API" << std::endl;
+    eglTerminate(display);
+    exit(EXIT_FAILURE);
+  }
+
+  // Any OpenGL capable config works, all rendering goes to an FBO. The surface
+  // type defaults to EGL_WINDOW_BIT which surfaceless displays don't offer
+  const EGLint configAttribs[] = {
+      EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+      EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+      EGL_NONE};
+  EGLint numConfigs = 0;
+  if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0)
+  {
+    std::cerr << "Error: No EGL config supports OpenGL" << std::endl;
+    eglTerminate(display);
+    exit(EXIT_FAILURE);
+  }
+}
+
+// Constructor that creates a surfaceless OpenGL context with the given version
+HeadlessContext::HeadlessContext(int majorVersion, int minorVersion, const HeadlessContext *share)
+{
+  if (share != nullptr)
+  {
+    // Shared contexts reuse the display and config, which also keeps them compatible
+    display = share->display;
+    config = share->config;
+    ownsDisplay = false;
+  }
+  else
+  {
+    initializeDisplay();
+    ownsDisplay = true;
+  }
+
+  // Ask for the same core profile the windowed path asks GLFW for
+  const EGLint contextAttribs[] = {
+      EGL_CONTEXT_MAJOR_VERSION, majorVersion,
+      EGL_CONTEXT_MINOR_VERSION, minorVersion,
+      EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+#if GL_CHECKS
+      // Debug contexts report every error through KHR_debug, see GLCheck.h
+      EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE,
+#endif
+      EGL_NONE};
+  context = eglCreateContext(display, config, share != nullptr ? share->context : EGL_NO_CONTEXT, contextAttribs);
+  if (context == EGL_NO_CONTEXT)
+  {
+    std::cerr << "Error: Failed to create an OpenGL " << majorVersion << "." << minorVersion
+              << " core context (EGL error 0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+    if (ownsDisplay)
+      eglTerminate(display);
+    exit(EXIT_FAILURE);
+  }
+
+  if (share != nullptr)
+    return;
+  std::cout << "Created headless OpenGL context on " << eglQueryString(display, EGL_VENDOR)
+            << " (EGL " << eglQueryString(display, EGL_VERSION) << ")" << std::endl;
+}
+
+// Makes the context current on the calling thread
+void HeadlessContext::MakeCurrent()
+{
+  // The bound API is per thread, worker threads start out with OpenGL ES
+  eglBindAPI(EGL_OPENGL_API);
+  if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+  {
+    std::cerr << "Error: Failed to make the headless context current" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+// Makes no context current on the calling thread
+void HeadlessContext::Release()
+{
+  eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+// Returns the address of an OpenGL function, to be handed to gladLoadGLLoader
+void *HeadlessContext::GetProcAddress(const char *name)
+{
+  return (void *)eglGetProcAddress(name);
+}
+
+// Destroys the context and terminates the display, unless the display belongs to the shared context
+void HeadlessContext::Delete()
+{
+  eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  eglDestroyContext(display, context);
+  if (ownsDisplay)
+    eglTerminate(display);
+}
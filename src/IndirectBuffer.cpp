@@ -0,0 +1,90 @@
+#include "IndirectBuffer.h"
+
+// Size in bytes of one index of the given type
+static GLsizeiptr index_size(GLenum indexType)
+{
+  return indexType == GL_UNSIGNED_BYTE ? 1 : indexType == GL_UNSIGNED_SHORT ? 2
+                                                                            : 4;
+}
+
+// Constructor that makes room for maxCommands per frame
+IndirectBuffer::IndirectBuffer(GLsizei maxCommands)
+    : maxCommands(maxCommands), drawCalls(0), commandCount(0)
+{
+  // The bundled glad only loads core entry points, so the ARB extensions on older contexts
+  // would still leave glDrawElementsIndirect and glMultiDrawElementsIndirect NULL
+  indirect = GLAD_GL_VERSION_4_0;
+  multiDraw = GLAD_GL_VERSION_4_3;
+
+  if (indirect)
+    commands.reset(new StreamingBuffer(GL_DRAW_INDIRECT_BUFFER, (GLsizeiptr)maxCommands * sizeof(DrawElementsIndirectCommand)));
+  else
+    fallback.resize(maxCommands);
+}
+
+// Returns room for maxCommands commands, to be written before Draw
+DrawElementsIndirectCommand *IndirectBuffer::Map()
+{
+  if (!indirect)
+    return fallback.data();
+  return (DrawElementsIndirectCommand *)commands->Map();
+}
+
+// Ends writing, count is the number of commands written this frame
+void IndirectBuffer::Unmap(GLsizei count)
+{
+  commandCount = count;
+  if (indirect)
+    commands->Unmap();
+}
+
+// Draws the commands written since Map with the VAO bound by the caller
+void IndirectBuffer::Draw(GLenum mode, GLenum indexType)
+{
+  drawCalls = 0;
+  if (commandCount == 0)
+    return;
+
+  if (!indirect)
+  {
+    // No indirect drawing, replay the commands one by one
+    GLsizeiptr indexBytes = index_size(indexType);
+    for (GLsizei i = 0; i < commandCount; i++)
+    {
+      const DrawElementsIndirectCommand &command = fallback[i];
+      void *firstIndex = (void *)(command.firstIndex * indexBytes);
+      if (command.instanceCount == 1)
+        glDrawElementsBaseVertex(mode, command.count, indexType, firstIndex, command.baseVertex);
+      else if (command.instanceCount > 1)
+        glDrawElementsInstancedBaseVertex(mode, command.count, indexType, firstIndex, command.instanceCount,
+                                          command.baseVertex);
+    }
+    drawCalls = commandCount;
+    return;
+  }
+
+  commands->Bind();
+  if (multiDraw)
+  {
+    glMultiDrawElementsIndirect(mode, indexType, (void *)commands->offset, commandCount, 0);
+    drawCalls = 1;
+  }
+  else
+  {
+    for (GLsizei i = 0; i < commandCount; i++)
+      glDrawElementsIndirect(mode, indexType, (void *)(commands->offset + i * sizeof(DrawElementsIndirectCommand)));
+    drawCalls = commandCount;
+  }
+  commands->Unbind();
+  commands->Fence();
+}
+
+// Deletes the buffer
+void IndirectBuffer::Delete()
+{
+  if (commands)
+  {
+    commands->Delete();
+    commands.reset();
+  }
+}
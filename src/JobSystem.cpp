@@ -0,0 +1,328 @@
+#include "JobSystem.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// System and worker index of a worker thread, threads that aren't workers use worker 0
+static thread_local JobSystem *threadSystem = nullptr;
+static thread_local unsigned int threadIndex = 0;
+
+// Constructor that makes an empty deque for capacity jobs, a power of two
+JobDeque::JobDeque(uint32_t capacity)
+    : buffer(new std::atomic<Job *>[capacity]), mask((int64_t)capacity - 1), bottom(0), top(0)
+{
+}
+
+// Adds a job at the bottom, owner only. Returns false when the deque is full
+bool JobDeque::Push(Job *job)
+{
+  int64_t b = bottom.load(std::memory_order_relaxed);
+  int64_t t = top.load(std::memory_order_acquire);
+  if (b - t > mask)
+    return false;
+  buffer[b & mask].store(job, std::memory_order_relaxed);
+  // Publishes the job, and everything written to it, to thieves
+  bottom.store(b + 1, std::memory_order_release);
+  return true;
+}
+
+// Takes the newest job, owner only. Returns null when the deque is empty
+Job *JobDeque::Pop()
+{
+  // Claims the bottom slot before looking at top, so a thief either sees the claim or loses
+  // the race for the last job below
+  int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+  bottom.store(b, std::memory_order_seq_cst);
+  int64_t t = top.load(std::memory_order_seq_cst);
+  if (t > b)
+  {
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  Job *job = buffer[b & mask].load(std::memory_order_relaxed);
+  if (t == b)
+  {
+    // The last job, thieves may be after it too
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+      job = nullptr;
+    bottom.store(b + 1, std::memory_order_relaxed);
+  }
+  return job;
+}
+
+// Takes the oldest job, any thread. Returns null when it is empty or another thread won the race
+Job *JobDeque::Steal()
+{
+  int64_t t = top.load(std::memory_order_seq_cst);
+  int64_t b = bottom.load(std::memory_order_seq_cst);
+  if (t >= b)
+    return nullptr;
+  Job *job = buffer[t & mask].load(std::memory_order_relaxed);
+  if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    return nullptr;
+  return job;
+}
+
+// Deque and job ring of one thread
+JobSystem::Worker::Worker(uint32_t seed)
+    : deque(JOB_POOL_SIZE), pool(new Job[JOB_POOL_SIZE]), allocated(0), random(seed)
+{
+  for (uint32_t i = 0; i < JOB_POOL_SIZE; i++)
+    pool[i].unfinished.store(0, std::memory_order_relaxed);
+}
+
+// Constructor that starts the worker threads, so that threadCount threads run jobs including
+// the calling one. 0 uses one per hardware thread but at least two
+JobSystem::JobSystem(unsigned int threadCount)
+    : generation(0), sleeping(0), stopping(false), backgroundCount(0)
+{
+  if (threadCount == 0)
+    threadCount = std::max(2u, std::thread::hardware_concurrency());
+  for (unsigned int i = 0; i < threadCount; i++)
+    workers.emplace_back(new Worker(0x9E3779B9u * (i + 1)));
+  for (unsigned int i = 1; i < threadCount; i++)
+    threads.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+// Worker of the calling thread
+JobSystem::Worker &JobSystem::current()
+{
+  return *workers[threadSystem == this ? threadIndex : 0];
+}
+
+// Makes a job that runs function with a copy of size bytes of data, and counts towards parent
+// (when not null) until it is done. It starts with Run
+Job *JobSystem::Create(JobFunction function, const void *data, size_t size, Job *parent)
+{
+  if (size > JOB_DATA_SIZE)
+  {
+    std::cerr << "Error: Job data of " << size << " bytes, jobs carry at most " << JOB_DATA_SIZE << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  // The oldest job of the ring is almost always long done. One that isn't, like a root waiting
+  // for its children, is skipped, after running a job so a ring full of queued jobs drains
+  Worker &worker = current();
+  Job *job = &worker.pool[worker.allocated++ & (JOB_POOL_SIZE - 1)];
+  while (!Done(job))
+  {
+    if (!RunOne())
+      std::this_thread::yield();
+    job = &worker.pool[worker.allocated++ & (JOB_POOL_SIZE - 1)];
+  }
+
+  job->function = function;
+  job->parent = parent;
+  job->unfinished.store(1, std::memory_order_relaxed);
+  if (size > 0)
+    memcpy(job->data, data, size);
+  if (parent != nullptr)
+    parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+  return job;
+}
+
+// Queues a job on the calling thread's deque, where idle threads can steal it
+void JobSystem::Run(Job *job)
+{
+  // A full deque means there is plenty to steal already
+  if (!current().deque.Push(job))
+  {
+    execute(job);
+    return;
+  }
+  wakeWorker();
+}
+
+// Queues a long job that only worker threads with nothing else to do pick up
+void JobSystem::RunBackground(Job *job)
+{
+  {
+    std::lock_guard<std::mutex> lock(backgroundMutex);
+    background.push_back(job);
+    backgroundCount.fetch_add(1, std::memory_order_seq_cst);
+  }
+  wakeWorker();
+}
+
+// Runs one queued background job on the calling thread, for a thread that waits for them
+// anyway. Returns false when there is none
+bool JobSystem::RunBackgroundOne()
+{
+  Job *job = findBackground();
+  if (job == nullptr)
+    return false;
+  execute(job);
+  return true;
+}
+
+// Wakes a sleeping worker, if there is one, after a job was queued
+void JobSystem::wakeWorker()
+{
+  // Pairs with a worker announcing itself asleep before it looks for work a last time: both
+  // modify sleeping, so either the worker's look comes after this and finds the job, or this
+  // sees the worker
+  if (sleeping.fetch_add(0, std::memory_order_seq_cst) > 0)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      generation++;
+    }
+    wake.notify_one();
+  }
+}
+
+// Runs other jobs until job and all its children are done
+void JobSystem::Wait(const Job *job)
+{
+  while (!Done(job))
+    if (!RunOne())
+      std::this_thread::yield();
+}
+
+// Runs one queued job, the calling thread's own or a stolen one. Returns false when it found none
+bool JobSystem::RunOne()
+{
+  Job *job = find(current());
+  if (job == nullptr)
+    return false;
+  execute(job);
+  return true;
+}
+
+// Takes a job from the calling thread's deque, or steals one from another thread
+Job *JobSystem::find(Worker &worker)
+{
+  Job *job = worker.deque.Pop();
+  if (job != nullptr)
+    return job;
+
+  // Starts at a random thread so thieves spread out instead of all raiding the same one
+  worker.random ^= worker.random << 13;
+  worker.random ^= worker.random >> 17;
+  worker.random ^= worker.random << 5;
+  size_t count = workers.size();
+  for (size_t i = 0, victim = worker.random % count; i < count; i++, victim = (victim + 1) % count)
+  {
+    if (workers[victim].get() == &worker)
+      continue;
+    job = workers[victim]->deque.Steal();
+    if (job != nullptr)
+      return job;
+  }
+  return nullptr;
+}
+
+// Takes the oldest background job, or returns null
+Job *JobSystem::findBackground()
+{
+  if (backgroundCount.load(std::memory_order_seq_cst) == 0)
+    return nullptr;
+  std::lock_guard<std::mutex> lock(backgroundMutex);
+  if (background.empty())
+    return nullptr;
+  Job *job = background.front();
+  background.pop_front();
+  backgroundCount.fetch_sub(1, std::memory_order_relaxed);
+  return job;
+}
+
+// Runs a job and marks it done
+void JobSystem::execute(Job *job)
+{
+  if (job->function != nullptr)
+    job->function(*this, job, job->data);
+  finish(job);
+}
+
+// Counts a job or child done, and its parent once it is done itself
+void JobSystem::finish(Job *job)
+{
+  // Read first, once the count is 0 the job's thread may reuse it
+  Job *parent = job->parent;
+  if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1 && parent != nullptr)
+    finish(parent);
+}
+
+// Worker thread loop
+void JobSystem::workerLoop(unsigned int index)
+{
+  threadSystem = this;
+  threadIndex = index;
+  Worker &worker = *workers[index];
+  int idle = 0;
+  while (!stopping.load(std::memory_order_relaxed))
+  {
+    // Background jobs only once there is nothing a frame may be waiting for
+    Job *job = find(worker);
+    if (job == nullptr)
+      job = findBackground();
+    if (job != nullptr)
+    {
+      execute(job);
+      idle = 0;
+      continue;
+    }
+    if (++idle < JOB_SPIN_COUNT)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    // Announces itself asleep, then looks once more so a job Run just queued isn't missed
+    idle = 0;
+    uint64_t seen;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      seen = generation;
+    }
+    sleeping.fetch_add(1, std::memory_order_seq_cst);
+    job = find(worker);
+    if (job == nullptr)
+      job = findBackground();
+    if (job == nullptr)
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [&]()
+                { return stopping.load(std::memory_order_relaxed) || generation != seen; });
+    }
+    sleeping.fetch_sub(1, std::memory_order_relaxed);
+    if (job != nullptr)
+      execute(job);
+  }
+}
+
+// Splits off the upper half of its batches as a child until it is down to one, then runs that
+void JobSystem::rangeJob(JobSystem &jobs, Job *job, const void *data)
+{
+  RangeData range = *(const RangeData *)data;
+  while (range.count > range.batch)
+  {
+    // The lower half keeps the odd batch, so only the very last range is ever shorter
+    uint32_t batches = (uint32_t)(((uint64_t)range.count + range.batch - 1) / range.batch);
+    uint32_t lower = (batches + 1) / 2 * range.batch;
+    RangeData upper = range;
+    upper.first = range.first + lower;
+    upper.count = range.count - lower;
+    range.count = lower;
+    jobs.Run(jobs.Create(&JobSystem::rangeJob, &upper, sizeof(upper), job));
+  }
+  range.call(range.function, range.first, range.count);
+}
+
+// Stops the worker threads, queued jobs (background ones too) that didn't run are dropped
+void JobSystem::Delete()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping.store(true, std::memory_order_relaxed);
+  }
+  wake.notify_all();
+  for (std::thread &thread : threads)
+    thread.join();
+  threads.clear();
+
+  std::lock_guard<std::mutex> lock(backgroundMutex);
+  background.clear();
+  backgroundCount.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,1015 @@
+#include "MeshLoader.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+// glTF accessor component types
+const int GLTF_BYTE = 5120;
+const int GLTF_UNSIGNED_BYTE = 5121;
+const int GLTF_SHORT = 5122;
+const int GLTF_UNSIGNED_SHORT = 5123;
+const int GLTF_UNSIGNED_INT = 5125;
+const int GLTF_FLOAT = 5126;
+// glTF primitive mode of triangle lists, the only one loaded
+const int GLTF_TRIANGLES = 4;
+// Node hierarchies and JSON nesting deeper than this are rejected, it also stops cycles
+const int MAX_DEPTH = 64;
+
+static bool ends_with(const std::string &text, const char *suffix)
+{
+  size_t length = strlen(suffix);
+  if (text.size() < length)
+    return false;
+  std::string tail = text.substr(text.size() - length);
+  std::transform(tail.begin(), tail.end(), tail.begin(), ::tolower);
+  return tail == suffix;
+}
+
+// Reads a whole file, returns false if it can't be opened
+static bool read_file(const std::string &filename, std::vector<unsigned char> &bytes)
+{
+  std::ifstream in(filename, std::ios::binary);
+  if (!in)
+    return false;
+  bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  return true;
+}
+
+// Reads a little endian 32 bit value
+static uint32_t read_u32(const unsigned char *bytes)
+{
+  return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+// ---------------------------------------------------------
+// Wavefront OBJ
+// ---------------------------------------------------------
+
+// Position, texture coordinate and normal index of one face corner, -1 when absent
+struct ObjCorner
+{
+  int position, texCoord, normal;
+
+  bool operator==(const ObjCorner &other) const
+  {
+    return position == other.position && texCoord == other.texCoord && normal == other.normal;
+  }
+};
+
+struct ObjCornerHash
+{
+  size_t operator()(const ObjCorner &corner) const
+  {
+    uint64_t key = (uint64_t)(uint32_t)corner.position * 0x9E3779B97F4A7C15ull;
+    key ^= (uint64_t)(uint32_t)corner.texCoord * 0xC2B2AE3D27D4EB4Full + (key >> 29);
+    key ^= (uint64_t)(uint32_t)corner.normal * 0x165667B19E3779F9ull + (key >> 32);
+    return (size_t)key;
+  }
+};
+
+// Turns a 1 based (or negative, relative to the end) OBJ index into a 0 based one, -1 if out of range
+static int obj_index(long index, size_t count)
+{
+  long resolved = index < 0 ? (long)count + index : index - 1;
+  return resolved >= 0 && resolved < (long)count ? (int)resolved : -1;
+}
+
+// Reads an OBJ file, corners that repeat the same position/texture/normal triple share a vertex
+static bool load_obj(const char *filename, MeshData &mesh)
+{
+  std::vector<unsigned char> file;
+  if (!read_file(filename, file))
+  {
+    std::cerr << "Error: Failed to open mesh " << filename << std::endl;
+    return false;
+  }
+  file.push_back('\0');
+
+  std::vector<float> positions, texCoords, normals;
+  std::unordered_map<ObjCorner, uint32_t, ObjCornerHash> corners;
+  std::vector<uint32_t> face;
+  mesh.sourceVertexCount = 0;
+
+  const char *cursor = (const char *)file.data();
+  for (int line = 1; *cursor != '\0'; line++)
+  {
+    const char *end = cursor + strcspn(cursor, "\n");
+    while (*cursor == ' ' || *cursor == '\t')
+      cursor++;
+
+    if (cursor[0] == 'v' && (cursor[1] == ' ' || cursor[1] == '\t'))
+    {
+      char *next = (char *)cursor + 1;
+      for (int i = 0; i < 3; i++)
+        positions.push_back(strtof(next, &next));
+    }
+    else if (cursor[0] == 'v' && cursor[1] == 't')
+    {
+      char *next = (char *)cursor + 2;
+      for (int i = 0; i < 2; i++)
+        texCoords.push_back(strtof(next, &next));
+    }
+    else if (cursor[0] == 'v' && cursor[1] == 'n')
+    {
+      char *next = (char *)cursor + 2;
+      for (int i = 0; i < 3; i++)
+        normals.push_back(strtof(next, &next));
+    }
+    else if (cursor[0] == 'f' && (cursor[1] == ' ' || cursor[1] == '\t'))
+    {
+      face.clear();
+      char *next = (char *)cursor + 1;
+      while (true)
+      {
+        while (*next == ' ' || *next == '\t' || *next == '\r')
+          next++;
+        if (next >= end)
+          break;
+
+        // v, v/vt, v//vn or v/vt/vn
+        ObjCorner corner = {obj_index(strtol(next, &next, 10), positions.size() / 3), -1, -1};
+        bool valid = corner.position >= 0;
+        if (*next == '/')
+        {
+          if (*++next != '/')
+          {
+            corner.texCoord = obj_index(strtol(next, &next, 10), texCoords.size() / 2);
+            valid = valid && corner.texCoord >= 0;
+          }
+          if (*next == '/')
+          {
+            corner.normal = obj_index(strtol(next + 1, &next, 10), normals.size() / 3);
+            valid = valid && corner.normal >= 0;
+          }
+        }
+        if (!valid || (next < end && *next != ' ' && *next != '\t' && *next != '\r'))
+        {
+          std::cerr << "Error: Invalid face in " << filename << " at line " << line << std::endl;
+          return false;
+        }
+
+        auto inserted = corners.emplace(corner, (uint32_t)mesh.vertices.size());
+        if (inserted.second)
+        {
+          MeshVertex vertex = {};
+          memcpy(vertex.position, &positions[corner.position * 3], sizeof(vertex.position));
+          if (corner.normal >= 0)
+            memcpy(vertex.normal, &normals[corner.normal * 3], sizeof(vertex.normal));
+          if (corner.texCoord >= 0)
+            memcpy(vertex.texCoord, &texCoords[corner.texCoord * 2], sizeof(vertex.texCoord));
+          mesh.vertices.push_back(vertex);
+        }
+        face.push_back(inserted.first->second);
+        mesh.sourceVertexCount++;
+      }
+
+      // Polygons are triangulated as fans, which is what exporters assume for convex faces
+      for (size_t i = 2; i < face.size(); i++)
+      {
+        mesh.indices.push_back(face[0]);
+        mesh.indices.push_back(face[i - 1]);
+        mesh.indices.push_back(face[i]);
+      }
+    }
+
+    cursor = *end == '\0' ? end : end + 1;
+  }
+  return true;
+}
+
+// ---------------------------------------------------------
+// glTF 2.0
+// ---------------------------------------------------------
+
+// Just enough JSON for glTF: parsed into a tree, numbers as doubles
+struct JsonValue
+{
+  enum Type
+  {
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+  };
+
+  Type type = JSON_NULL;
+  double number = 0.0;
+  std::string string;
+  std::vector<JsonValue> items;
+  std::vector<std::pair<std::string, JsonValue>> members;
+
+  // Member of an object, a null value if there is none
+  const JsonValue &operator[](const char *key) const
+  {
+    static const JsonValue none;
+    for (const auto &member : members)
+      if (member.first == key)
+        return member.second;
+    return none;
+  }
+
+  // Item of an array, a null value if out of range
+  const JsonValue &Item(size_t index) const
+  {
+    static const JsonValue none;
+    return index < items.size() ? items[index] : none;
+  }
+
+  // The number, or fallback for anything else
+  double Number(double fallback) const
+  {
+    return type == JSON_NUMBER ? number : fallback;
+  }
+
+  // The number as an index or size, fallback for anything else and for negative numbers
+  size_t Index(size_t fallback = SIZE_MAX) const
+  {
+    return type == JSON_NUMBER && number >= 0.0 && number < 9007199254740992.0 ? (size_t)number : fallback;
+  }
+};
+
+// Recursive descent JSON parser, sets failed instead of throwing
+struct JsonParser
+{
+  const char *cursor;
+  const char *end;
+  bool failed = false;
+
+  void SkipSpace()
+  {
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r'))
+      cursor++;
+  }
+
+  bool Consume(char expected)
+  {
+    SkipSpace();
+    if (cursor < end && *cursor == expected)
+    {
+      cursor++;
+      return true;
+    }
+    return false;
+  }
+
+  bool ParseString(std::string &out)
+  {
+    if (!Consume('"'))
+      return false;
+    while (cursor < end && *cursor != '"')
+    {
+      char c = *cursor++;
+      if (c != '\\')
+      {
+        out += c;
+        continue;
+      }
+      if (cursor >= end)
+        return false;
+      c = *cursor++;
+      switch (c)
+      {
+      case 'b':
+        out += '\b';
+        break;
+      case 'f':
+        out += '\f';
+        break;
+      case 'n':
+        out += '\n';
+        break;
+      case 'r':
+        out += '\r';
+        break;
+      case 't':
+        out += '\t';
+        break;
+      case 'u':
+      {
+        // Encoded as UTF-8, surrogate pairs are not combined (names and URIs only)
+        if (end - cursor < 4)
+          return false;
+        unsigned int code = (unsigned int)strtoul(std::string(cursor, 4).c_str(), nullptr, 16);
+        cursor += 4;
+        if (code < 0x80)
+          out += (char)code;
+        else if (code < 0x800)
+        {
+          out += (char)(0xC0 | (code >> 6));
+          out += (char)(0x80 | (code & 0x3F));
+        }
+        else
+        {
+          out += (char)(0xE0 | (code >> 12));
+          out += (char)(0x80 | ((code >> 6) & 0x3F));
+          out += (char)(0x80 | (code & 0x3F));
+        }
+        break;
+      }
+      default:
+        out += c;
+      }
+    }
+    return Consume('"');
+  }
+
+  void Parse(JsonValue &value, int depth)
+  {
+    SkipSpace();
+    if (failed || cursor >= end || depth > MAX_DEPTH)
+    {
+      failed = true;
+      return;
+    }
+
+    if (*cursor == '{')
+    {
+      cursor++;
+      value.type = JsonValue::JSON_OBJECT;
+      if (Consume('}'))
+        return;
+      do
+      {
+        value.members.emplace_back();
+        if (!ParseString(value.members.back().first) || !Consume(':'))
+        {
+          failed = true;
+          return;
+        }
+        Parse(value.members.back().second, depth + 1);
+      } while (!failed && Consume(','));
+      failed = failed || !Consume('}');
+    }
+    else if (*cursor == '[')
+    {
+      cursor++;
+      value.type = JsonValue::JSON_ARRAY;
+      if (Consume(']'))
+        return;
+      do
+      {
+        value.items.emplace_back();
+        Parse(value.items.back(), depth + 1);
+      } while (!failed && Consume(','));
+      failed = failed || !Consume(']');
+    }
+    else if (*cursor == '"')
+    {
+      value.type = JsonValue::JSON_STRING;
+      failed = !ParseString(value.string);
+    }
+    else if (end - cursor >= 4 && strncmp(cursor, "true", 4) == 0)
+    {
+      value.type = JsonValue::JSON_BOOL;
+      value.number = 1.0;
+      cursor += 4;
+    }
+    else if (end - cursor >= 5 && strncmp(cursor, "false", 5) == 0)
+    {
+      value.type = JsonValue::JSON_BOOL;
+      cursor += 5;
+    }
+    else if (end - cursor >= 4 && strncmp(cursor, "null", 4) == 0)
+      cursor += 4;
+    else
+    {
+      // The text is not null terminated, copy the longest run that can be part of a number
+      size_t length = 0;
+      while (cursor + length < end && cursor[length] != '\0' && strchr("+-0123456789.eE", cursor[length]) != nullptr)
+        length++;
+      std::string text(cursor, length);
+      char *parsedEnd = nullptr;
+      value.type = JsonValue::JSON_NUMBER;
+      value.number = strtod(text.c_str(), &parsedEnd);
+      failed = length == 0 || parsedEnd != text.c_str() + length;
+      cursor += length;
+    }
+  }
+};
+
+// Decodes base64, stops at the first character outside the alphabet (padding included)
+static std::vector<unsigned char> decode_base64(const char *text, size_t length)
+{
+  std::vector<unsigned char> bytes;
+  bytes.reserve(length / 4 * 3);
+  uint32_t bits = 0;
+  int bitCount = 0;
+  for (size_t i = 0; i < length; i++)
+  {
+    char c = text[i];
+    int value = c >= 'A' && c <= 'Z'   ? c - 'A'
+                : c >= 'a' && c <= 'z' ? c - 'a' + 26
+                : c >= '0' && c <= '9' ? c - '0' + 52
+                : c == '+'             ? 62
+                : c == '/'             ? 63
+                                       : -1;
+    if (value < 0)
+      break;
+    bits = (bits << 6) | (uint32_t)value;
+    bitCount += 6;
+    if (bitCount >= 8)
+    {
+      bitCount -= 8;
+      bytes.push_back((unsigned char)(bits >> bitCount));
+    }
+  }
+  return bytes;
+}
+
+// Column major 4x4 matrix of a node transform
+struct NodeTransform
+{
+  float m[16];
+
+  static NodeTransform Identity()
+  {
+    NodeTransform transform = {{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1}};
+    return transform;
+  }
+
+  NodeTransform operator*(const NodeTransform &other) const
+  {
+    NodeTransform result;
+    for (int column = 0; column < 4; column++)
+      for (int row = 0; row < 4; row++)
+      {
+        float sum = 0.0f;
+        for (int k = 0; k < 4; k++)
+          sum += m[k * 4 + row] * other.m[column * 4 + k];
+        result.m[column * 4 + row] = sum;
+      }
+    return result;
+  }
+};
+
+// The node's matrix, or translation * rotation * scale
+static NodeTransform node_transform(const JsonValue &node)
+{
+  NodeTransform transform = NodeTransform::Identity();
+  const JsonValue &matrix = node["matrix"];
+  if (matrix.items.size() == 16)
+  {
+    for (int i = 0; i < 16; i++)
+      transform.m[i] = (float)matrix.Item(i).Number(transform.m[i]);
+    return transform;
+  }
+
+  const JsonValue &t = node["translation"];
+  const JsonValue &r = node["rotation"];
+  const JsonValue &s = node["scale"];
+  float x = (float)r.Item(0).Number(0.0), y = (float)r.Item(1).Number(0.0), z = (float)r.Item(2).Number(0.0), w = (float)r.Item(3).Number(1.0);
+  float sx = (float)s.Item(0).Number(1.0), sy = (float)s.Item(1).Number(1.0), sz = (float)s.Item(2).Number(1.0);
+
+  // Rotation matrix of the unit quaternion, each column scaled
+  float rotation[9] = {
+      1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w),
+      2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w),
+      2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y)};
+  float scale[3] = {sx, sy, sz};
+  for (int column = 0; column < 3; column++)
+    for (int row = 0; row < 3; row++)
+      transform.m[column * 4 + row] = rotation[column * 3 + row] * scale[column];
+  for (int row = 0; row < 3; row++)
+    transform.m[12 + row] = (float)t.Item(row).Number(0.0);
+  return transform;
+}
+
+// Everything needed to resolve accessors
+struct GltfFile
+{
+  JsonValue json;
+  std::vector<std::vector<unsigned char>> buffers;
+  const char *filename;
+};
+
+// Number of components of an accessor type, 0 for the matrix types
+static int accessor_components(const std::string &type)
+{
+  if (type == "SCALAR")
+    return 1;
+  if (type == "VEC2")
+    return 2;
+  if (type == "VEC3")
+    return 3;
+  if (type == "VEC4")
+    return 4;
+  return 0;
+}
+
+// Bytes of one component, 0 for unknown component types
+static int component_size(int componentType)
+{
+  switch (componentType)
+  {
+  case GLTF_BYTE:
+  case GLTF_UNSIGNED_BYTE:
+    return 1;
+  case GLTF_SHORT:
+  case GLTF_UNSIGNED_SHORT:
+    return 2;
+  case GLTF_UNSIGNED_INT:
+  case GLTF_FLOAT:
+    return 4;
+  default:
+    return 0;
+  }
+}
+
+// Reads one component as a float, normalized integers are mapped to [0, 1] or [-1, 1]
+static float read_component(const unsigned char *bytes, int componentType, bool normalized)
+{
+  switch (componentType)
+  {
+  case GLTF_BYTE:
+    return normalized ? std::max(*(const int8_t *)bytes / 127.0f, -1.0f) : *(const int8_t *)bytes;
+  case GLTF_UNSIGNED_BYTE:
+    return normalized ? *bytes / 255.0f : *bytes;
+  case GLTF_SHORT:
+  {
+    int16_t value;
+    memcpy(&value, bytes, 2);
+    return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+  }
+  case GLTF_UNSIGNED_SHORT:
+  {
+    uint16_t value;
+    memcpy(&value, bytes, 2);
+    return normalized ? value / 65535.0f : value;
+  }
+  case GLTF_UNSIGNED_INT:
+    return (float)read_u32(bytes);
+  default:
+  {
+    float value;
+    memcpy(&value, bytes, 4);
+    return value;
+  }
+  }
+}
+
+// Finds the bytes of an accessor and checks that every element lies inside its buffer view
+static bool resolve_accessor(const GltfFile &gltf, size_t index, const unsigned char *&data, size_t &count,
+                             size_t &stride, int &components, int &componentType, bool &normalized)
+{
+  const JsonValue &accessor = gltf.json["accessors"].Item(index);
+  const JsonValue &view = gltf.json["bufferViews"].Item(accessor["bufferView"].Index());
+  size_t bufferIndex = view["buffer"].Index();
+  if (accessor.type != JsonValue::JSON_OBJECT || view.type != JsonValue::JSON_OBJECT || bufferIndex >= gltf.buffers.size())
+  {
+    std::cerr << "Error: Accessor " << index << " of " << gltf.filename << " has no buffer view"
+              << (accessor["sparse"].type != JsonValue::JSON_NULL ? " (sparse accessors are not supported)" : "") << std::endl;
+    return false;
+  }
+
+  count = accessor["count"].Index(0);
+  components = accessor_components(accessor["type"].string);
+  componentType = (int)accessor["componentType"].Number(0.0);
+  normalized = accessor["normalized"].number != 0.0;
+  size_t elementSize = (size_t)components * component_size(componentType);
+  stride = view["byteStride"].Index(0);
+  if (stride == 0)
+    stride = elementSize;
+
+  const std::vector<unsigned char> &buffer = gltf.buffers[bufferIndex];
+  size_t viewOffset = view["byteOffset"].Index(0);
+  size_t viewLength = view["byteLength"].Index(0);
+  size_t offset = accessor["byteOffset"].Index(0);
+  // Checked without multiplying, a huge count in a malformed file must not wrap around
+  bool fits = elementSize > 0 && viewOffset <= buffer.size() && viewLength <= buffer.size() - viewOffset &&
+              (count == 0 || (offset <= viewLength && elementSize <= viewLength - offset &&
+                              count <= (viewLength - offset - elementSize) / stride + 1));
+  if (!fits)
+  {
+    std::cerr << "Error: Accessor " << index << " of " << gltf.filename << " is out of bounds or has an unsupported type" << std::endl;
+    return false;
+  }
+
+  data = buffer.data() + viewOffset + offset;
+  return true;
+}
+
+// Reads an accessor as floats, components beyond the accessor's are left as they are
+static bool read_accessor(const GltfFile &gltf, size_t index, int wanted, std::vector<float> &out)
+{
+  const unsigned char *data;
+  size_t count, stride;
+  int components, componentType;
+  bool normalized;
+  if (!resolve_accessor(gltf, index, data, count, stride, components, componentType, normalized))
+    return false;
+
+  out.assign(count * wanted, 0.0f);
+  int size = component_size(componentType);
+  for (size_t i = 0; i < count; i++)
+    for (int c = 0; c < std::min(wanted, components); c++)
+      out[i * wanted + c] = read_component(data + i * stride + c * size, componentType, normalized);
+  return true;
+}
+
+// Reads an index accessor, which has to be unsigned integers. Floats would round indices above 2^24
+static bool read_indices(const GltfFile &gltf, size_t index, std::vector<uint32_t> &out)
+{
+  const unsigned char *data;
+  size_t count, stride;
+  int components, componentType;
+  bool normalized;
+  if (!resolve_accessor(gltf, index, data, count, stride, components, componentType, normalized))
+    return false;
+  if (components != 1 || (componentType != GLTF_UNSIGNED_BYTE && componentType != GLTF_UNSIGNED_SHORT &&
+                          componentType != GLTF_UNSIGNED_INT))
+  {
+    std::cerr << "Error: Index accessor " << index << " of " << gltf.filename << " is not unsigned integers" << std::endl;
+    return false;
+  }
+
+  out.resize(count);
+  for (size_t i = 0; i < count; i++)
+  {
+    const unsigned char *element = data + i * stride;
+    out[i] = componentType == GLTF_UNSIGNED_BYTE    ? *element
+             : componentType == GLTF_UNSIGNED_SHORT ? (uint32_t)(element[0] | (element[1] << 8))
+                                                    : read_u32(element);
+  }
+  return true;
+}
+
+// Loads the buffers of a .gltf or .glb file, binChunk is the GLB's embedded buffer
+static bool load_gltf_buffers(GltfFile &gltf, const std::vector<unsigned char> &binChunk)
+{
+  std::string directory = gltf.filename;
+  size_t slash = directory.find_last_of("/\\");
+  directory = slash == std::string::npos ? "" : directory.substr(0, slash + 1);
+
+  const JsonValue &buffers = gltf.json["buffers"];
+  for (size_t i = 0; i < buffers.items.size(); i++)
+  {
+    const std::string &uri = buffers.Item(i)["uri"].string;
+    std::vector<unsigned char> bytes;
+    if (uri.empty())
+      bytes = binChunk;
+    else if (uri.compare(0, 5, "data:") == 0)
+    {
+      size_t comma = uri.find(";base64,");
+      if (comma == std::string::npos)
+      {
+        std::cerr << "Error: Buffer " << i << " of " << gltf.filename << " is not base64 encoded" << std::endl;
+        return false;
+      }
+      bytes = decode_base64(uri.c_str() + comma + 8, uri.size() - comma - 8);
+    }
+    else if (!read_file(directory + uri, bytes))
+    {
+      std::cerr << "Error: Failed to open buffer " << directory + uri << std::endl;
+      return false;
+    }
+
+    if (bytes.size() < buffers.Item(i)["byteLength"].Index(0))
+    {
+      std::cerr << "Error: Buffer " << i << " of " << gltf.filename << " is shorter than its byteLength" << std::endl;
+      return false;
+    }
+    gltf.buffers.push_back(std::move(bytes));
+  }
+  return true;
+}
+
+// Appends the triangle primitives of a mesh, transformed into world space
+static bool append_gltf_mesh(const GltfFile &gltf, const JsonValue &gltfMesh, const NodeTransform &transform, MeshData &mesh)
+{
+  // Normals go through the cofactor matrix, which stays correct with non uniform scale
+  const float *m = transform.m;
+  float normalMatrix[9] = {
+      m[5] * m[10] - m[6] * m[9], m[2] * m[9] - m[1] * m[10], m[1] * m[6] - m[2] * m[5],
+      m[6] * m[8] - m[4] * m[10], m[0] * m[10] - m[2] * m[8], m[2] * m[4] - m[0] * m[6],
+      m[4] * m[9] - m[5] * m[8], m[1] * m[8] - m[0] * m[9], m[0] * m[5] - m[1] * m[4]};
+  // Mirroring transforms (negative determinant) flip the winding, which is swapped back below
+  bool mirrored = m[0] * normalMatrix[0] + m[1] * normalMatrix[3] + m[2] * normalMatrix[6] < 0.0f;
+
+  for (const JsonValue &primitive : gltfMesh["primitives"].items)
+  {
+    if ((int)primitive["mode"].Number(GLTF_TRIANGLES) != GLTF_TRIANGLES)
+    {
+      std::cerr << "Warning: Skipping a primitive of " << gltf.filename << " that is not a triangle list" << std::endl;
+      continue;
+    }
+
+    const JsonValue &attributes = primitive["attributes"];
+    std::vector<float> positions, normals, texCoords;
+    if (attributes["POSITION"].type != JsonValue::JSON_NUMBER ||
+        !read_accessor(gltf, attributes["POSITION"].Index(), 3, positions))
+    {
+      std::cerr << "Error: Primitive of " << gltf.filename << " has no readable positions" << std::endl;
+      return false;
+    }
+    size_t count = positions.size() / 3;
+    if ((attributes["NORMAL"].type == JsonValue::JSON_NUMBER && !read_accessor(gltf, attributes["NORMAL"].Index(), 3, normals)) ||
+        (attributes["TEXCOORD_0"].type == JsonValue::JSON_NUMBER && !read_accessor(gltf, attributes["TEXCOORD_0"].Index(), 2, texCoords)))
+      return false;
+    if ((!normals.empty() && normals.size() != count * 3) || (!texCoords.empty() && texCoords.size() != count * 2))
+    {
+      std::cerr << "Error: Attributes of a primitive of " << gltf.filename << " differ in length" << std::endl;
+      return false;
+    }
+
+    uint32_t base = (uint32_t)mesh.vertices.size();
+    for (size_t i = 0; i < count; i++)
+    {
+      MeshVertex vertex = {};
+      const float *p = &positions[i * 3];
+      for (int row = 0; row < 3; row++)
+        vertex.position[row] = m[row] * p[0] + m[4 + row] * p[1] + m[8 + row] * p[2] + m[12 + row];
+      if (!normals.empty())
+      {
+        const float *n = &normals[i * 3];
+        float length = 0.0f;
+        for (int row = 0; row < 3; row++)
+        {
+          vertex.normal[row] = normalMatrix[row * 3] * n[0] + normalMatrix[row * 3 + 1] * n[1] + normalMatrix[row * 3 + 2] * n[2];
+          length += vertex.normal[row] * vertex.normal[row];
+        }
+        for (int row = 0; length > 0.0f && row < 3; row++)
+          vertex.normal[row] /= std::sqrt(length);
+      }
+      // glTF puts v = 0 at the top of the image
+      if (!texCoords.empty())
+      {
+        vertex.texCoord[0] = texCoords[i * 2];
+        vertex.texCoord[1] = 1.0f - texCoords[i * 2 + 1];
+      }
+      mesh.vertices.push_back(vertex);
+    }
+
+    std::vector<uint32_t> indices;
+    if (primitive["indices"].type == JsonValue::JSON_NUMBER)
+    {
+      if (!read_indices(gltf, primitive["indices"].Index(), indices))
+        return false;
+    }
+    else
+    {
+      indices.resize(count);
+      for (size_t i = 0; i < count; i++)
+        indices[i] = (uint32_t)i;
+    }
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+      uint32_t triangle[3] = {indices[i], indices[i + 1], indices[i + 2]};
+      if (triangle[0] >= count || triangle[1] >= count || triangle[2] >= count)
+      {
+        std::cerr << "Error: Index out of range in " << gltf.filename << std::endl;
+        return false;
+      }
+      if (mirrored)
+        std::swap(triangle[1], triangle[2]);
+      for (uint32_t index : triangle)
+        mesh.indices.push_back(base + index);
+    }
+  }
+  return true;
+}
+
+// Walks a node and its children, appending the meshes they reference
+static bool append_gltf_node(const GltfFile &gltf, size_t index, const NodeTransform &parent, MeshData &mesh, int depth)
+{
+  const JsonValue &node = gltf.json["nodes"].Item(index);
+  if (node.type != JsonValue::JSON_OBJECT || depth > MAX_DEPTH)
+  {
+    std::cerr << "Error: Invalid node hierarchy in " << gltf.filename << std::endl;
+    return false;
+  }
+
+  NodeTransform transform = parent * node_transform(node);
+  if (node["mesh"].type == JsonValue::JSON_NUMBER &&
+      !append_gltf_mesh(gltf, gltf.json["meshes"].Item(node["mesh"].Index()), transform, mesh))
+    return false;
+  for (const JsonValue &child : node["children"].items)
+    if (!append_gltf_node(gltf, child.Index(), transform, mesh, depth + 1))
+      return false;
+  return true;
+}
+
+// Reads a .gltf or .glb file, every mesh instance of the default scene is flattened into one mesh
+static bool load_gltf(const char *filename, MeshData &mesh)
+{
+  std::vector<unsigned char> file;
+  if (!read_file(filename, file))
+  {
+    std::cerr << "Error: Failed to open mesh " << filename << std::endl;
+    return false;
+  }
+
+  // A GLB is a 12 byte header followed by a JSON chunk and an optional binary chunk
+  const char *jsonText = (const char *)file.data();
+  size_t jsonLength = file.size();
+  std::vector<unsigned char> binChunk;
+  if (file.size() >= 12 && memcmp(file.data(), "glTF", 4) == 0)
+  {
+    size_t length = std::min<size_t>(read_u32(&file[8]), file.size());
+    jsonLength = 0;
+    for (size_t offset = 12; offset + 8 <= length;)
+    {
+      size_t chunkLength = read_u32(&file[offset]);
+      uint32_t chunkType = read_u32(&file[offset + 4]);
+      if (offset + 8 + chunkLength > length)
+        break;
+      if (chunkType == 0x4E4F534A) // "JSON"
+      {
+        jsonText = (const char *)&file[offset + 8];
+        jsonLength = chunkLength;
+      }
+      else if (chunkType == 0x004E4942) // "BIN\0"
+        binChunk.assign(file.begin() + offset + 8, file.begin() + offset + 8 + chunkLength);
+      offset += 8 + ((chunkLength + 3) & ~(size_t)3);
+    }
+  }
+
+  GltfFile gltf;
+  gltf.filename = filename;
+  JsonParser parser = {jsonText, jsonText + jsonLength};
+  parser.Parse(gltf.json, 0);
+  if (parser.failed || gltf.json.type != JsonValue::JSON_OBJECT)
+  {
+    std::cerr << "Error: Failed to parse the glTF JSON of " << filename << std::endl;
+    return false;
+  }
+  if (!load_gltf_buffers(gltf, binChunk))
+    return false;
+
+  mesh.vertices.clear();
+  mesh.indices.clear();
+  const JsonValue &scenes = gltf.json["scenes"];
+  if (scenes.items.empty())
+  {
+    // Without scenes there are no instances either, take every mesh as it is
+    for (const JsonValue &gltfMesh : gltf.json["meshes"].items)
+      if (!append_gltf_mesh(gltf, gltfMesh, NodeTransform::Identity(), mesh))
+        return false;
+  }
+  else
+  {
+    const JsonValue &scene = scenes.Item(gltf.json["scene"].Index(0));
+    for (const JsonValue &root : scene["nodes"].items)
+      if (!append_gltf_node(gltf, root.Index(), NodeTransform::Identity(), mesh, 0))
+        return false;
+  }
+
+  // Exporters split vertices per primitive and per attribute set, merge what ended up identical
+  mesh.sourceVertexCount = mesh.vertices.size();
+  weld_vertices(mesh);
+  return true;
+}
+
+// ---------------------------------------------------------
+// Common
+// ---------------------------------------------------------
+
+// Reads a Wavefront OBJ, glTF 2.0 (.gltf with external or embedded buffers) or binary glTF (.glb) file
+bool load_mesh(const char *filename, MeshData &mesh)
+{
+  mesh.vertices.clear();
+  mesh.indices.clear();
+
+  bool loaded;
+  if (ends_with(filename, ".obj"))
+    loaded = load_obj(filename, mesh);
+  else if (ends_with(filename, ".gltf") || ends_with(filename, ".glb"))
+    loaded = load_gltf(filename, mesh);
+  else
+  {
+    std::cerr << "Error: Unknown mesh format " << filename << ", expected .obj, .gltf or .glb" << std::endl;
+    return false;
+  }
+  if (!loaded)
+    return false;
+
+  if (mesh.indices.empty())
+  {
+    std::cerr << "Error: Mesh " << filename << " has no triangles" << std::endl;
+    return false;
+  }
+
+  compute_normals(mesh);
+  compute_bounds(mesh);
+  return true;
+}
+
+// Hashes the bytes of a vertex. Floats like 0.5 have all their low bits clear, so every word
+// is mixed into the high bits and folded back down, otherwise the table's low bits would collide
+static uint32_t hash_vertex(const MeshVertex &vertex)
+{
+  uint32_t words[sizeof(MeshVertex) / 4];
+  memcpy(words, &vertex, sizeof(words));
+  uint32_t hash = 2166136261u;
+  for (uint32_t word : words)
+  {
+    hash = (hash ^ word) * 0x9E3779B1u;
+    hash ^= hash >> 15;
+  }
+  hash *= 0x85EBCA6Bu;
+  hash ^= hash >> 13;
+  return hash;
+}
+
+// Merges vertices with identical attributes through a hash map and rewrites the indices
+void weld_vertices(MeshData &mesh)
+{
+  // Open addressing over vertex indices, at most half full
+  size_t capacity = 16;
+  while (capacity < mesh.vertices.size() * 2)
+    capacity *= 2;
+  const uint32_t EMPTY = 0xFFFFFFFFu;
+  std::vector<uint32_t> table(capacity, EMPTY);
+  std::vector<uint32_t> remap(mesh.vertices.size());
+
+  size_t unique = 0;
+  for (size_t i = 0; i < mesh.vertices.size(); i++)
+  {
+    const MeshVertex &vertex = mesh.vertices[i];
+    size_t slot = hash_vertex(vertex) & (capacity - 1);
+    while (table[slot] != EMPTY && memcmp(&mesh.vertices[table[slot]], &vertex, sizeof(MeshVertex)) != 0)
+      slot = (slot + 1) & (capacity - 1);
+
+    if (table[slot] == EMPTY)
+    {
+      // Unique vertices are compacted to the front, which never overwrites one still to be read
+      mesh.vertices[unique] = vertex;
+      table[slot] = (uint32_t)unique++;
+    }
+    remap[i] = table[slot];
+  }
+
+  mesh.vertices.resize(unique);
+  for (uint32_t &index : mesh.indices)
+    index = remap[index];
+}
+
+// Computes area weighted normals from the triangles for the vertices whose normal is zero
+void compute_normals(MeshData &mesh)
+{
+  std::vector<bool> missing(mesh.vertices.size());
+  bool any = false;
+  for (size_t i = 0; i < mesh.vertices.size(); i++)
+  {
+    const float *n = mesh.vertices[i].normal;
+    missing[i] = n[0] == 0.0f && n[1] == 0.0f && n[2] == 0.0f;
+    any = any || missing[i];
+  }
+  if (!any)
+    return;
+
+  // The cross product's length is twice the triangle's area, so larger triangles weigh more
+  for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+  {
+    const float *a = mesh.vertices[mesh.indices[i]].position;
+    const float *b = mesh.vertices[mesh.indices[i + 1]].position;
+    const float *c = mesh.vertices[mesh.indices[i + 2]].position;
+    float ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    float ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    float normal[3] = {ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0]};
+    for (int corner = 0; corner < 3; corner++)
+    {
+      uint32_t index = mesh.indices[i + corner];
+      if (!missing[index])
+        continue;
+      for (int axis = 0; axis < 3; axis++)
+        mesh.vertices[index].normal[axis] += normal[axis];
+    }
+  }
+
+  for (size_t i = 0; i < mesh.vertices.size(); i++)
+  {
+    float *n = mesh.vertices[i].normal;
+    float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (!missing[i] || length == 0.0f)
+      continue;
+    for (int axis = 0; axis < 3; axis++)
+      n[axis] /= length;
+  }
+}
+
+// Recomputes boundsMin and boundsMax from the positions
+void compute_bounds(MeshData &mesh)
+{
+  for (int axis = 0; axis < 3; axis++)
+  {
+    mesh.boundsMin[axis] = mesh.vertices.empty() ? 0.0f : INFINITY;
+    mesh.boundsMax[axis] = mesh.vertices.empty() ? 0.0f : -INFINITY;
+  }
+  for (const MeshVertex &vertex : mesh.vertices)
+    for (int axis = 0; axis < 3; axis++)
+    {
+      mesh.boundsMin[axis] = std::min(mesh.boundsMin[axis], vertex.position[axis]);
+      mesh.boundsMax[axis] = std::max(mesh.boundsMax[axis], vertex.position[axis]);
+    }
+}
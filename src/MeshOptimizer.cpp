@@ -0,0 +1,328 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+
+// Scoring constants of Forsyth's "Linear-Speed Vertex Cache Optimisation"
+const float CACHE_DECAY_POWER = 1.5f;
+const float LAST_TRIANGLE_SCORE = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+// Valences scored from the table, higher ones are computed
+const unsigned int VALENCE_TABLE_SIZE = 32;
+// Marks a triangle, vertex or cache slot that isn't there
+const uint32_t NONE = 0xFFFFFFFFu;
+
+// Simulated FIFO post transform cache. A vertex is still cached until cacheSize vertices were
+// loaded after it, so counting misses is enough and no queue is needed
+struct FifoCache
+{
+  std::vector<uint64_t> loadedAt;
+  uint64_t misses;
+  unsigned int cacheSize;
+
+  FifoCache(size_t vertexCount, unsigned int cacheSize)
+      : loadedAt(vertexCount, 0), misses(cacheSize), cacheSize(cacheSize) {}
+
+  // Returns 1 if the vertex had to be transformed
+  unsigned int Access(uint32_t vertex)
+  {
+    if (misses - loadedAt[vertex] < cacheSize)
+      return 0;
+    loadedAt[vertex] = ++misses;
+    return 1;
+  }
+
+  // Forgets everything, as if the cache was flushed
+  void Reset()
+  {
+    misses += cacheSize;
+  }
+};
+
+// Average cache miss ratio: post transform cache misses per triangle of a FIFO cache of the given size
+float compute_acmr(const std::vector<uint32_t> &indices, size_t vertexCount, unsigned int cacheSize)
+{
+  if (indices.size() < 3)
+    return 0.0f;
+
+  FifoCache cache(vertexCount, cacheSize);
+  size_t misses = 0;
+  for (uint32_t index : indices)
+    misses += cache.Access(index);
+  return (float)misses / (float)(indices.size() / 3);
+}
+
+// Score of a vertex by its position in the LRU cache (-1 if not cached) and the triangles still using it
+static float vertex_score(int cachePosition, uint32_t remaining, const float *valenceScores)
+{
+  // Vertices no triangle needs anymore should leave the cache first
+  if (remaining == 0)
+    return -1.0f;
+
+  float score = 0.0f;
+  if (cachePosition >= 0 && cachePosition < 3)
+  {
+    // The triangle just drawn, deliberately not the best so strips don't get stuck
+    score = LAST_TRIANGLE_SCORE;
+  }
+  else if (cachePosition >= 3)
+  {
+    float scaler = 1.0f / (MESH_CACHE_SIZE - 3);
+    score = std::pow(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+  }
+
+  // Vertices with few triangles left are finished off, so they don't linger as lone stragglers
+  score += remaining < VALENCE_TABLE_SIZE ? valenceScores[remaining]
+                                          : VALENCE_BOOST_SCALE * std::pow((float)remaining, -VALENCE_BOOST_POWER);
+  return score;
+}
+
+// Reorders the triangles for the post transform vertex cache, Tom Forsyth's linear speed algorithm
+void optimize_vertex_cache(std::vector<uint32_t> &indices, size_t vertexCount)
+{
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0)
+    return;
+
+  float valenceScores[VALENCE_TABLE_SIZE];
+  valenceScores[0] = 0.0f;
+  for (unsigned int valence = 1; valence < VALENCE_TABLE_SIZE; valence++)
+    valenceScores[valence] = VALENCE_BOOST_SCALE * std::pow((float)valence, -VALENCE_BOOST_POWER);
+
+  // Triangles of every vertex, as one array of per vertex ranges. Triangles are swapped
+  // to the end of their vertex's range once drawn, so the first remaining[v] are live
+  std::vector<uint32_t> remaining(vertexCount, 0);
+  for (uint32_t index : indices)
+    remaining[index]++;
+  std::vector<uint32_t> offsets(vertexCount + 1, 0);
+  for (size_t v = 0; v < vertexCount; v++)
+    offsets[v + 1] = offsets[v] + remaining[v];
+  std::vector<uint32_t> adjacency(indices.size());
+  std::vector<uint32_t> filled(offsets.begin(), offsets.end() - 1);
+  for (size_t i = 0; i < indices.size(); i++)
+    adjacency[filled[indices[i]]++] = (uint32_t)(i / 3);
+
+  std::vector<float> vertexScores(vertexCount);
+  for (size_t v = 0; v < vertexCount; v++)
+    vertexScores[v] = vertex_score(-1, remaining[v], valenceScores);
+
+  std::vector<float> triangleScores(triangleCount);
+  std::vector<bool> drawn(triangleCount, false);
+  uint32_t best = 0;
+  for (size_t t = 0; t < triangleCount; t++)
+  {
+    triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+    if (triangleScores[t] > triangleScores[best])
+      best = (uint32_t)t;
+  }
+
+  // LRU cache, with room for the three vertices pushed out by each triangle
+  std::vector<uint32_t> cache, nextCache;
+  cache.reserve(MESH_CACHE_SIZE + 3);
+  nextCache.reserve(MESH_CACHE_SIZE + 3);
+  std::vector<uint32_t> output;
+  output.reserve(indices.size());
+  // Undrawn triangles before it have all been drawn, for the fallback scan
+  size_t scanCursor = 0;
+
+  for (size_t step = 0; step < triangleCount; step++)
+  {
+    // Nothing in the cache leads anywhere, continue with the first triangle left
+    if (best == NONE)
+    {
+      while (drawn[scanCursor])
+        scanCursor++;
+      best = (uint32_t)scanCursor;
+    }
+
+    const uint32_t *triangle = &indices[best * 3];
+    drawn[best] = true;
+    output.insert(output.end(), triangle, triangle + 3);
+
+    // Takes the triangle out of its vertices' live ranges
+    for (int corner = 0; corner < 3; corner++)
+    {
+      uint32_t v = triangle[corner];
+      uint32_t *begin = &adjacency[offsets[v]];
+      uint32_t *end = begin + remaining[v];
+      uint32_t *found = std::find(begin, end, best);
+      if (found != end)
+      {
+        std::swap(*found, *(end - 1));
+        remaining[v]--;
+      }
+    }
+
+    // The triangle's vertices move to the front, everything else shifts back
+    nextCache.assign(triangle, triangle + 3);
+    if (nextCache[1] == nextCache[0])
+      nextCache.erase(nextCache.begin() + 1);
+    if (nextCache.back() == nextCache[0] || (nextCache.size() == 3 && nextCache[2] == nextCache[1]))
+      nextCache.pop_back();
+    for (uint32_t v : cache)
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+        nextCache.push_back(v);
+    cache.swap(nextCache);
+
+    // Rescores the cached vertices and the ones that just fell out, and their live triangles
+    for (size_t i = 0; i < cache.size(); i++)
+    {
+      uint32_t v = cache[i];
+      float score = vertex_score(i < MESH_CACHE_SIZE ? (int)i : -1, remaining[v], valenceScores);
+      float delta = score - vertexScores[v];
+      vertexScores[v] = score;
+      for (uint32_t k = 0; k < remaining[v]; k++)
+        triangleScores[adjacency[offsets[v] + k]] += delta;
+    }
+    if (cache.size() > MESH_CACHE_SIZE)
+      cache.resize(MESH_CACHE_SIZE);
+
+    // Only triangles touching the cache are candidates, which keeps every step linear in the cache size
+    best = NONE;
+    float bestScore = -1.0f;
+    for (uint32_t v : cache)
+      for (uint32_t k = 0; k < remaining[v]; k++)
+      {
+        uint32_t t = adjacency[offsets[v] + k];
+        if (triangleScores[t] > bestScore)
+        {
+          bestScore = triangleScores[t];
+          best = t;
+        }
+      }
+  }
+
+  indices.swap(output);
+}
+
+// Reorders clusters of triangles so the outward facing ones are drawn first
+void optimize_overdraw(std::vector<uint32_t> &indices, const std::vector<MeshVertex> &vertices, float threshold)
+{
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount < 2)
+    return;
+
+  // Hard boundaries: triangles that miss on all three vertices, the cache restarts there in any order
+  FifoCache cache(vertices.size(), MESH_CACHE_SIZE);
+  std::vector<uint32_t> triangleMisses(triangleCount);
+  std::vector<size_t> hardStarts;
+  for (size_t t = 0; t < triangleCount; t++)
+  {
+    triangleMisses[t] = cache.Access(indices[t * 3]) + cache.Access(indices[t * 3 + 1]) + cache.Access(indices[t * 3 + 2]);
+    if (t == 0 || triangleMisses[t] == 3)
+      hardStarts.push_back(t);
+  }
+  hardStarts.push_back(triangleCount);
+
+  // Soft boundaries: split a cluster again wherever the misses so far, with the cache flushed at the
+  // split, stay within threshold of the cluster's ACMR. Smaller clusters sort better
+  std::vector<size_t> starts;
+  for (size_t c = 0; c + 1 < hardStarts.size(); c++)
+  {
+    size_t begin = hardStarts[c], end = hardStarts[c + 1];
+    size_t clusterMisses = 0;
+    for (size_t t = begin; t < end; t++)
+      clusterMisses += triangleMisses[t];
+    float limit = (float)clusterMisses / (float)(end - begin) * threshold;
+
+    cache.Reset();
+    size_t start = begin, misses = 0;
+    starts.push_back(begin);
+    for (size_t t = begin; t + 1 < end; t++)
+    {
+      misses += cache.Access(indices[t * 3]) + cache.Access(indices[t * 3 + 1]) + cache.Access(indices[t * 3 + 2]);
+      if ((float)misses <= limit * (float)(t + 1 - start))
+      {
+        starts.push_back(t + 1);
+        cache.Reset();
+        start = t + 1;
+        misses = 0;
+      }
+    }
+  }
+  starts.push_back(triangleCount);
+  size_t clusterCount = starts.size() - 1;
+
+  // Area weighted centroid and summed normal of each cluster and of the whole mesh
+  std::vector<float> clusterData(clusterCount * 6, 0.0f);
+  std::vector<float> clusterArea(clusterCount, 0.0f);
+  double meshCentroid[3] = {0.0, 0.0, 0.0};
+  double meshArea = 0.0;
+  for (size_t c = 0; c < clusterCount; c++)
+  {
+    float *centroid = &clusterData[c * 6];
+    float *normal = centroid + 3;
+    for (size_t t = starts[c]; t < starts[c + 1]; t++)
+    {
+      const float *a = vertices[indices[t * 3]].position;
+      const float *b = vertices[indices[t * 3 + 1]].position;
+      const float *d = vertices[indices[t * 3 + 2]].position;
+      float ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+      float ad[3] = {d[0] - a[0], d[1] - a[1], d[2] - a[2]};
+      float cross[3] = {ab[1] * ad[2] - ab[2] * ad[1], ab[2] * ad[0] - ab[0] * ad[2], ab[0] * ad[1] - ab[1] * ad[0]};
+      float area = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+      for (int axis = 0; axis < 3; axis++)
+      {
+        centroid[axis] += (a[axis] + b[axis] + d[axis]) / 3.0f * area;
+        normal[axis] += cross[axis];
+      }
+      clusterArea[c] += area;
+    }
+    for (int axis = 0; axis < 3; axis++)
+      meshCentroid[axis] += centroid[axis];
+    meshArea += clusterArea[c];
+  }
+  for (int axis = 0; meshArea > 0.0 && axis < 3; axis++)
+    meshCentroid[axis] /= meshArea;
+
+  // Clusters facing away from the center sit on the outside and occlude the rest, draw them first
+  std::vector<float> sortKeys(clusterCount, 0.0f);
+  for (size_t c = 0; c < clusterCount; c++)
+  {
+    const float *centroid = &clusterData[c * 6];
+    const float *normal = centroid + 3;
+    float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    if (clusterArea[c] == 0.0f || length == 0.0f)
+      continue;
+    for (int axis = 0; axis < 3; axis++)
+      sortKeys[c] += (float)(centroid[axis] / clusterArea[c] - meshCentroid[axis]) * normal[axis] / length;
+  }
+
+  std::vector<uint32_t> order(clusterCount);
+  for (size_t c = 0; c < clusterCount; c++)
+    order[c] = (uint32_t)c;
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+                   { return sortKeys[a] > sortKeys[b]; });
+
+  std::vector<uint32_t> output;
+  output.reserve(indices.size());
+  for (uint32_t c : order)
+    output.insert(output.end(), indices.begin() + starts[c] * 3, indices.begin() + starts[c + 1] * 3);
+  indices.swap(output);
+}
+
+// Reorders the vertices in the order the triangles first use them, unused vertices are dropped
+void optimize_vertex_fetch(MeshData &mesh)
+{
+  std::vector<uint32_t> remap(mesh.vertices.size(), NONE);
+  std::vector<MeshVertex> vertices;
+  vertices.reserve(mesh.vertices.size());
+  for (uint32_t &index : mesh.indices)
+  {
+    if (remap[index] == NONE)
+    {
+      remap[index] = (uint32_t)vertices.size();
+      vertices.push_back(mesh.vertices[index]);
+    }
+    index = remap[index];
+  }
+  mesh.vertices.swap(vertices);
+}
+
+// Runs all of the above
+void optimize_mesh(MeshData &mesh, float overdrawThreshold)
+{
+  optimize_vertex_cache(mesh.indices, mesh.vertices.size());
+  optimize_overdraw(mesh.indices, mesh.vertices, overdrawThreshold);
+  optimize_vertex_fetch(mesh);
+}
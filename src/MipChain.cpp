@@ -0,0 +1,330 @@
+#include "MipChain.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MIP_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIP_SIMD_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MIP_SIMD_NEON
+#endif
+
+// Name of the SIMD code path compiled in: "AVX2", "SSE2", "NEON" or "scalar"
+const char *mip_simd_path()
+{
+#if defined(MIP_SIMD_AVX2)
+  return "AVX2";
+#elif defined(MIP_SIMD_SSE2)
+  return "SSE2";
+#elif defined(MIP_SIMD_NEON)
+  return "NEON";
+#else
+  return "scalar";
+#endif
+}
+
+// Lookup tables between 8 bit sRGB and linear floats
+struct SrgbTables
+{
+  static const int ENCODE_SIZE = 4096;
+  float decode[256];
+  unsigned char encode[ENCODE_SIZE + 1];
+
+  SrgbTables()
+  {
+    for (int i = 0; i < 256; i++)
+    {
+      float c = i / 255.0f;
+      decode[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    for (int i = 0; i <= ENCODE_SIZE; i++)
+    {
+      float c = (float)i / ENCODE_SIZE;
+      float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+      encode[i] = (unsigned char)std::lround(std::min(1.0f, std::max(0.0f, s)) * 255.0f);
+    }
+  }
+};
+
+static const SrgbTables &srgb_tables()
+{
+  static const SrgbTables tables;
+  return tables;
+}
+
+// Source offsets (relative to 2 * output index) and weights of a 2:1 filter
+struct FilterTaps
+{
+  int first;
+  int count;
+  float weights[8];
+};
+
+static FilterTaps make_taps(MipFilter filter)
+{
+  FilterTaps taps;
+  if (filter == MIP_FILTER_BOX)
+  {
+    taps.first = 0;
+    taps.count = 2;
+    taps.weights[0] = taps.weights[1] = 0.5f;
+    return taps;
+  }
+
+  // Kaiser windowed sinc over 2 output pixels each side, alpha 4
+  const float alpha = 4.0f, radius = 2.0f;
+  auto bessel_i0 = [](float x)
+  {
+    float sum = 1.0f, term = 1.0f;
+    for (int k = 1; k < 20; k++)
+    {
+      term *= (x / (2.0f * k)) * (x / (2.0f * k));
+      sum += term;
+    }
+    return sum;
+  };
+
+  taps.first = -3;
+  taps.count = 8;
+  float total = 0.0f;
+  for (int i = 0; i < taps.count; i++)
+  {
+    // Distance between the source pixel center and the output pixel center, in output pixels
+    float t = ((taps.first + i) + 0.5f - 1.0f) / 2.0f;
+    float sinc = t == 0.0f ? 1.0f : std::sin(3.14159265f * t) / (3.14159265f * t);
+    float ratio = t / radius;
+    float window = bessel_i0(alpha * std::sqrt(std::max(0.0f, 1.0f - ratio * ratio))) / bessel_i0(alpha);
+    taps.weights[i] = sinc * window;
+    total += taps.weights[i];
+  }
+  for (int i = 0; i < taps.count; i++)
+    taps.weights[i] /= total;
+  return taps;
+}
+
+// Converts a row of 8 bit values to floats in [0, 1], through the sRGB curve when gamma is set
+static void load_row(const unsigned char *src, float *dst, int count, int channels, bool gamma)
+{
+  if (gamma)
+  {
+    const SrgbTables &tables = srgb_tables();
+    for (int i = 0; i < count; i++)
+      dst[i] = (channels == 4 && i % 4 == 3) ? src[i] / 255.0f : tables.decode[src[i]];
+    return;
+  }
+
+  int i = 0;
+  const float scale = 1.0f / 255.0f;
+#if defined(MIP_SIMD_AVX2)
+  const __m256 vscale = _mm256_set1_ps(scale);
+  for (; i + 8 <= count; i += 8)
+  {
+    __m128i bytes = _mm_loadl_epi64((const __m128i *)(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes)), vscale));
+  }
+#elif defined(MIP_SIMD_SSE2)
+  const __m128 vscale = _mm_set1_ps(scale);
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 8 <= count; i += 8)
+  {
+    __m128i words = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(src + i)), zero);
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero)), vscale));
+    _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(words, zero)), vscale));
+  }
+#elif defined(MIP_SIMD_NEON)
+  const float32x4_t vscale = vdupq_n_f32(scale);
+  for (; i + 8 <= count; i += 8)
+  {
+    uint16x8_t words = vmovl_u8(vld1_u8(src + i));
+    vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(words))), vscale));
+    vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(words))), vscale));
+  }
+#endif
+  for (; i < count; i++)
+    dst[i] = src[i] * scale;
+}
+
+// acc[i] += weight * row[i]
+static void accumulate_row(float *acc, const float *row, float weight, int count)
+{
+  int i = 0;
+#if defined(MIP_SIMD_AVX2)
+  const __m256 w = _mm256_set1_ps(weight);
+  for (; i + 8 <= count; i += 8)
+    _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(_mm256_loadu_ps(row + i), w)));
+#elif defined(MIP_SIMD_SSE2)
+  const __m128 w = _mm_set1_ps(weight);
+  for (; i + 4 <= count; i += 4)
+    _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(row + i), w)));
+#elif defined(MIP_SIMD_NEON)
+  const float32x4_t w = vdupq_n_f32(weight);
+  for (; i + 4 <= count; i += 4)
+    vst1q_f32(acc + i, vmlaq_f32(vld1q_f32(acc + i), vld1q_f32(row + i), w));
+#endif
+  for (; i < count; i++)
+    acc[i] += weight * row[i];
+}
+
+// Horizontal pass of one row: out[x] = sum of weight * acc[2x + offset], edges clamped
+static void filter_row(const float *acc, float *out, int width, int halfWidth, int channels, const FilterTaps &taps)
+{
+  for (int x = 0; x < halfWidth; x++)
+  {
+#if defined(MIP_SIMD_SSE2) || defined(MIP_SIMD_AVX2)
+    if (channels == 4)
+    {
+      // One RGBA pixel per SSE register
+      __m128 sum = _mm_setzero_ps();
+      for (int t = 0; t < taps.count; t++)
+      {
+        int sx = std::min(std::max(2 * x + taps.first + t, 0), width - 1);
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(acc + sx * 4), _mm_set1_ps(taps.weights[t])));
+      }
+      _mm_storeu_ps(out + x * 4, sum);
+      continue;
+    }
+#elif defined(MIP_SIMD_NEON)
+    if (channels == 4)
+    {
+      float32x4_t sum = vdupq_n_f32(0.0f);
+      for (int t = 0; t < taps.count; t++)
+      {
+        int sx = std::min(std::max(2 * x + taps.first + t, 0), width - 1);
+        sum = vmlaq_n_f32(sum, vld1q_f32(acc + sx * 4), taps.weights[t]);
+      }
+      vst1q_f32(out + x * 4, sum);
+      continue;
+    }
+#endif
+    for (int c = 0; c < channels; c++)
+    {
+      float sum = 0.0f;
+      for (int t = 0; t < taps.count; t++)
+      {
+        int sx = std::min(std::max(2 * x + taps.first + t, 0), width - 1);
+        sum += taps.weights[t] * acc[sx * channels + c];
+      }
+      out[x * channels + c] = sum;
+    }
+  }
+}
+
+// Converts floats in [0, 1] back to 8 bit, through the sRGB curve when gamma is set
+static void store_row(const float *src, unsigned char *dst, int count, int channels, bool gamma)
+{
+  if (gamma)
+  {
+    const SrgbTables &tables = srgb_tables();
+    for (int i = 0; i < count; i++)
+    {
+      float v = std::min(1.0f, std::max(0.0f, src[i]));
+      dst[i] = (channels == 4 && i % 4 == 3) ? (unsigned char)(v * 255.0f + 0.5f)
+                                             : tables.encode[(int)(v * SrgbTables::ENCODE_SIZE + 0.5f)];
+    }
+    return;
+  }
+
+  int i = 0;
+#if defined(MIP_SIMD_AVX2) || defined(MIP_SIMD_SSE2)
+  const __m128 scale = _mm_set1_ps(255.0f), zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+  for (; i + 8 <= count; i += 8)
+  {
+    // cvtps rounds to nearest, packs saturate to [0, 255]
+    __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), zero), one), scale));
+    __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), zero), one), scale));
+    __m128i words = _mm_packs_epi32(lo, hi);
+    _mm_storel_epi64((__m128i *)(dst + i), _mm_packus_epi16(words, words));
+  }
+#elif defined(MIP_SIMD_NEON)
+  const float32x4_t scale = vdupq_n_f32(255.0f), zero = vdupq_n_f32(0.0f), one = vdupq_n_f32(1.0f);
+  for (; i + 8 <= count; i += 8)
+  {
+    uint32x4_t lo = vcvtnq_u32_f32(vmulq_f32(vminq_f32(vmaxq_f32(vld1q_f32(src + i), zero), one), scale));
+    uint32x4_t hi = vcvtnq_u32_f32(vmulq_f32(vminq_f32(vmaxq_f32(vld1q_f32(src + i + 4), zero), one), scale));
+    vst1_u8(dst + i, vmovn_u16(vcombine_u16(vmovn_u32(lo), vmovn_u32(hi))));
+  }
+#endif
+  for (; i < count; i++)
+    dst[i] = (unsigned char)(std::min(1.0f, std::max(0.0f, src[i])) * 255.0f + 0.5f);
+}
+
+// Filters output rows [firstRow, lastRow) of a level
+static void downsample_rows(const unsigned char *pixels, int width, int height, int channels, const FilterTaps &taps,
+                            bool srgb, MipLevel &level, int firstRow, int lastRow)
+{
+  int rowCount = width * channels;
+  std::vector<float> row(rowCount), acc(rowCount), out(level.width * channels);
+
+  for (int y = firstRow; y < lastRow; y++)
+  {
+    // Vertical pass into acc, then horizontal pass into out
+    std::fill(acc.begin(), acc.end(), 0.0f);
+    for (int t = 0; t < taps.count; t++)
+    {
+      int sy = std::min(std::max(2 * y + taps.first + t, 0), height - 1);
+      load_row(pixels + (size_t)sy * rowCount, row.data(), rowCount, channels, srgb);
+      accumulate_row(acc.data(), row.data(), taps.weights[t], rowCount);
+    }
+    filter_row(acc.data(), out.data(), width, level.width, channels, taps);
+    store_row(out.data(), level.pixels.data() + (size_t)y * level.width * channels, level.width * channels, channels, srgb);
+  }
+}
+
+// Builds one level at half the size of the source.
+// With srgb the color channels are filtered in linear space, alpha is always linear
+MipLevel downsample_level(const unsigned char *pixels, int width, int height, int channels,
+                          MipFilter filter, bool srgb, unsigned int threads)
+{
+  MipLevel level;
+  level.width = std::max(1, width / 2);
+  level.height = std::max(1, height / 2);
+  level.pixels.resize((size_t)level.width * level.height * channels);
+
+  FilterTaps taps = make_taps(filter);
+  // Gamma only matters for color, single channel images are treated as data
+  bool gamma = srgb && channels >= 3;
+
+  // Small levels aren't worth a thread each
+  unsigned int workers = std::max(1u, std::min(threads, (unsigned int)(level.height / 64)));
+  if (workers == 1)
+  {
+    downsample_rows(pixels, width, height, channels, taps, gamma, level, 0, level.height);
+    return level;
+  }
+
+  std::vector<std::thread> pool;
+  int rowsPerWorker = (level.height + workers - 1) / workers;
+  for (unsigned int i = 0; i < workers; i++)
+  {
+    int first = i * rowsPerWorker, last = std::min(level.height, first + rowsPerWorker);
+    if (first < last)
+      pool.emplace_back(downsample_rows, pixels, width, height, channels, std::cref(taps), gamma, std::ref(level), first, last);
+  }
+  for (std::thread &worker : pool)
+    worker.join();
+  return level;
+}
+
+// Builds every level below the source down to 1x1, largest first (the source itself is not included).
+// Rows of each level are split across threads, 0 uses one per hardware thread
+std::vector<MipLevel> generate_mip_chain(const unsigned char *pixels, int width, int height, int channels,
+                                         MipFilter filter, bool srgb, unsigned int threads)
+{
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<MipLevel> chain;
+  while (width > 1 || height > 1)
+  {
+    chain.push_back(downsample_level(pixels, width, height, channels, filter, srgb, threads));
+    pixels = chain.back().pixels.data();
+    width = chain.back().width;
+    height = chain.back().height;
+  }
+  return chain;
+}
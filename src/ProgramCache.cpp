@@ -0,0 +1,154 @@
+#include "ProgramCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+// 64 bit FNV-1a over a byte range, chained through hash
+static uint64_t hash_bytes(const void *data, size_t size, uint64_t hash)
+{
+  const unsigned char *bytes = (const unsigned char *)data;
+  for (size_t i = 0; i < size; i++)
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  return hash;
+}
+
+// Constructor that reads the driver identity of the current context, call it after gladLoadGL
+ProgramCache::ProgramCache(const char *directory)
+    : directory(directory), enabled(false), hits(0), misses(0)
+{
+  // Core since 4.1. The bundled glad only loads core entry points, so GL_ARB_get_program_binary
+  // on an older context still leaves glProgramBinary NULL
+  if (!GLAD_GL_VERSION_4_1)
+    return;
+
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+  if (count <= 0)
+    return;
+  formats.resize(count);
+  glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+
+  driver = std::string((const char *)glGetString(GL_VENDOR)) + "\n" + (const char *)glGetString(GL_RENDERER) +
+           "\n" + (const char *)glGetString(GL_VERSION);
+
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  if (error)
+  {
+    std::cerr << "Warning: Shader cache disabled, can't create " << directory << ": " << error.message() << std::endl;
+    return;
+  }
+  enabled = true;
+}
+
+// Hash of the given shader sources on the current driver
+uint64_t ProgramCache::Key(const std::vector<std::string> &sources) const
+{
+  uint64_t hash = hash_bytes(driver.data(), driver.size(), 14695981039346656037ull);
+  for (const std::string &source : sources)
+  {
+    // Hash the length too so moving text from one stage to the next changes the key
+    uint64_t length = source.size();
+    hash = hash_bytes(&length, sizeof(length), hash);
+    hash = hash_bytes(source.data(), source.size(), hash);
+  }
+  return hash;
+}
+
+// Links the program from a cached binary, false if there is none or the driver rejected it
+bool ProgramCache::Load(GLuint program, uint64_t key)
+{
+  if (!enabled)
+    return false;
+
+  std::string file = path(key);
+  std::ifstream in(file, std::ios::binary);
+  if (!in)
+  {
+    misses++;
+    return false;
+  }
+
+  Header header;
+  std::vector<char> binary;
+  bool valid = false;
+  if (in.read((char *)&header, sizeof(header)) && memcmp(header.magic, "GLPB", 4) == 0 &&
+      header.version == VERSION && header.key == key &&
+      std::find(formats.begin(), formats.end(), (GLint)header.binaryFormat) != formats.end())
+  {
+    binary.resize(header.length);
+    valid = (bool)in.read(binary.data(), header.length) && in.peek() == EOF;
+  }
+  in.close();
+
+  GLint linked = GL_FALSE;
+  if (valid)
+  {
+    glProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei)header.length);
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  }
+  if (!linked)
+  {
+    // Stale or corrupt, drop it so the freshly compiled program replaces it
+    std::cerr << "Warning: Discarding shader cache entry " << file << std::endl;
+    std::remove(file.c_str());
+    misses++;
+    return false;
+  }
+
+  hits++;
+  return true;
+}
+
+// Writes the binary of a linked program, which must have been linked with
+// GL_PROGRAM_BINARY_RETRIEVABLE_HINT set (see PrepareLink)
+void ProgramCache::Store(GLuint program, uint64_t key)
+{
+  if (!enabled)
+    return;
+
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return;
+
+  Header header;
+  memcpy(header.magic, "GLPB", 4);
+  header.version = VERSION;
+  header.key = key;
+  std::vector<char> binary(length);
+  GLenum binaryFormat = 0;
+  glGetProgramBinary(program, length, &length, &binaryFormat, binary.data());
+  header.binaryFormat = binaryFormat;
+  header.length = (uint32_t)length;
+
+  // Write next to the final name and rename, a crash never leaves half a binary behind
+  std::string file = path(key);
+  std::string temporary = file + ".tmp";
+  std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+  out.write((const char *)&header, sizeof(header));
+  out.write(binary.data(), length);
+  out.close();
+  if (!out || std::rename(temporary.c_str(), file.c_str()) != 0)
+  {
+    std::cerr << "Warning: Failed to write shader cache entry " << file << std::endl;
+    std::remove(temporary.c_str());
+  }
+}
+
+// Asks the driver to keep the binary of a program around, call it before glLinkProgram
+void ProgramCache::PrepareLink(GLuint program) const
+{
+  if (enabled)
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+std::string ProgramCache::path(uint64_t key) const
+{
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+  return directory + "/" + name;
+}
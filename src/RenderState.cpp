@@ -0,0 +1,244 @@
+#include "RenderState.h"
+#include <cstddef>
+
+// Marks a binding whose value isn't known, it never matches an object name
+const GLuint UNKNOWN = 0xFFFFFFFFu;
+// Texture units shadowed, binds on higher units are always issued
+const int TEXTURE_UNITS = 32;
+// Capabilities shadowed by Enable/Disable
+const int CAPABILITY_COUNT = 8;
+
+// Targets with a shadowed binding, anything else goes straight to the driver
+static const GLenum BUFFER_TARGETS[] = {
+    GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_PIXEL_UNPACK_BUFFER,
+    GL_PIXEL_PACK_BUFFER, GL_DRAW_INDIRECT_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER};
+static const GLenum TEXTURE_TARGETS[] = {GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_3D};
+static const GLenum CAPABILITIES[CAPABILITY_COUNT] = {
+    GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE, GL_SCISSOR_TEST,
+    GL_STENCIL_TEST, GL_MULTISAMPLE, GL_FRAMEBUFFER_SRGB, GL_PRIMITIVE_RESTART};
+
+const int BUFFER_TARGET_COUNT = sizeof(BUFFER_TARGETS) / sizeof(BUFFER_TARGETS[0]);
+const int TEXTURE_TARGET_COUNT = sizeof(TEXTURE_TARGETS) / sizeof(TEXTURE_TARGETS[0]);
+
+// The shadowed state of the context current on this thread
+struct Shadow
+{
+  GLuint program;
+  GLuint vertexArray;
+  GLuint buffers[BUFFER_TARGET_COUNT];
+  GLuint drawFramebuffer, readFramebuffer;
+  GLenum activeTexture;
+  GLuint textures[TEXTURE_UNITS][TEXTURE_TARGET_COUNT];
+  // 0 disabled, 1 enabled, -1 unknown
+  int capabilities[CAPABILITY_COUNT];
+
+  Shadow() { Clear(); }
+
+  void Clear()
+  {
+    program = vertexArray = drawFramebuffer = readFramebuffer = UNKNOWN;
+    activeTexture = UNKNOWN;
+    for (GLuint &buffer : buffers)
+      buffer = UNKNOWN;
+    for (auto &unit : textures)
+      for (GLuint &texture : unit)
+        texture = UNKNOWN;
+    for (int &capability : capabilities)
+      capability = -1;
+  }
+};
+
+static thread_local Shadow shadow;
+thread_local unsigned long RenderState::issued = 0;
+thread_local unsigned long RenderState::elided = 0;
+
+// Index of target in a list, -1 if it isn't shadowed
+template <size_t N>
+static int find_target(const GLenum (&targets)[N], GLenum target)
+{
+  for (size_t i = 0; i < N; i++)
+  {
+    if (targets[i] == target)
+      return (int)i;
+  }
+  return -1;
+}
+
+// Records a binding, returns true if the call must be issued
+static bool update(GLuint &binding, GLuint value)
+{
+  if (binding == value)
+  {
+    RenderState::elided++;
+    return false;
+  }
+  binding = value;
+  RenderState::issued++;
+  return true;
+}
+
+// glUseProgram
+void RenderState::UseProgram(GLuint program)
+{
+  if (update(shadow.program, program))
+    glUseProgram(program);
+}
+
+// glBindVertexArray, the element array binding belongs to the VAO and follows it
+void RenderState::BindVertexArray(GLuint vertexArray)
+{
+  if (update(shadow.vertexArray, vertexArray))
+  {
+    glBindVertexArray(vertexArray);
+    shadow.buffers[find_target(BUFFER_TARGETS, GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+  }
+}
+
+// glBindBuffer
+void RenderState::BindBuffer(GLenum target, GLuint buffer)
+{
+  int index = find_target(BUFFER_TARGETS, target);
+  if (index < 0)
+  {
+    issued++;
+    glBindBuffer(target, buffer);
+  }
+  else if (update(shadow.buffers[index], buffer))
+    glBindBuffer(target, buffer);
+}
+
+// glBindBufferBase, which also changes the generic binding of target
+void RenderState::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+  // Indexed bindings aren't shadowed, only the generic binding they overwrite
+  issued++;
+  glBindBufferBase(target, index, buffer);
+  int generic = find_target(BUFFER_TARGETS, target);
+  if (generic >= 0)
+    shadow.buffers[generic] = buffer;
+}
+
+// glBindFramebuffer, GL_FRAMEBUFFER sets both the draw and the read framebuffer
+void RenderState::BindFramebuffer(GLenum target, GLuint framebuffer)
+{
+  bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+  bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+  if ((!draw || shadow.drawFramebuffer == framebuffer) && (!read || shadow.readFramebuffer == framebuffer))
+  {
+    elided++;
+    return;
+  }
+  if (draw)
+    shadow.drawFramebuffer = framebuffer;
+  if (read)
+    shadow.readFramebuffer = framebuffer;
+  issued++;
+  glBindFramebuffer(target, framebuffer);
+}
+
+// glActiveTexture, unit is GL_TEXTURE0 + n
+void RenderState::ActiveTexture(GLenum unit)
+{
+  if (update(shadow.activeTexture, unit))
+    glActiveTexture(unit);
+}
+
+// glBindTexture on the active unit
+void RenderState::BindTexture(GLenum target, GLuint texture)
+{
+  int index = find_target(TEXTURE_TARGETS, target);
+  // The active unit is unknown until the first ActiveTexture, binds can't be shadowed before that
+  GLuint unit = shadow.activeTexture - GL_TEXTURE0;
+  if (index < 0 || unit >= (GLuint)TEXTURE_UNITS)
+  {
+    issued++;
+    glBindTexture(target, texture);
+  }
+  else if (update(shadow.textures[unit][index], texture))
+    glBindTexture(target, texture);
+}
+
+// Records a capability, returns true if the call must be issued
+static bool update_capability(GLenum capability, int enabled)
+{
+  int index = find_target(CAPABILITIES, capability);
+  if (index >= 0 && shadow.capabilities[index] == enabled)
+  {
+    RenderState::elided++;
+    return false;
+  }
+  if (index >= 0)
+    shadow.capabilities[index] = enabled;
+  RenderState::issued++;
+  return true;
+}
+
+// glEnable / glDisable
+void RenderState::Enable(GLenum capability)
+{
+  if (update_capability(capability, 1))
+    glEnable(capability);
+}
+
+void RenderState::Disable(GLenum capability)
+{
+  if (update_capability(capability, 0))
+    glDisable(capability);
+}
+
+// Deletes objects and forgets every binding to them
+void RenderState::DeleteBuffer(GLuint buffer)
+{
+  glDeleteBuffers(1, &buffer);
+  // Deleting a bound buffer binds 0 in its place
+  for (GLuint &binding : shadow.buffers)
+  {
+    if (binding == buffer)
+      binding = 0;
+  }
+}
+
+void RenderState::DeleteTexture(GLuint texture)
+{
+  glDeleteTextures(1, &texture);
+  for (auto &unit : shadow.textures)
+  {
+    for (GLuint &binding : unit)
+    {
+      if (binding == texture)
+        binding = 0;
+    }
+  }
+}
+
+void RenderState::DeleteVertexArray(GLuint vertexArray)
+{
+  glDeleteVertexArrays(1, &vertexArray);
+  if (shadow.vertexArray == vertexArray)
+  {
+    shadow.vertexArray = 0;
+    shadow.buffers[find_target(BUFFER_TARGETS, GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+  }
+}
+
+void RenderState::DeleteFramebuffer(GLuint framebuffer)
+{
+  glDeleteFramebuffers(1, &framebuffer);
+  if (shadow.drawFramebuffer == framebuffer)
+    shadow.drawFramebuffer = 0;
+  if (shadow.readFramebuffer == framebuffer)
+    shadow.readFramebuffer = 0;
+}
+
+// Forgets everything, the next call of every kind is issued
+void RenderState::Invalidate()
+{
+  shadow.Clear();
+}
+
+// Starts counting issued and elided calls from zero, e.g. at the start of a frame
+void RenderState::ResetCounters()
+{
+  issued = 0;
+  elided = 0;
+}
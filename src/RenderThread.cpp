@@ -0,0 +1,92 @@
+#include "RenderThread.h"
+#include <chrono>
+
+// Constructor that starts the thread. It calls makeCurrent first and release when it stops,
+// and execute for every submitted list. The context must not be current on any other thread
+RenderThread::RenderThread(std::function<void()> makeCurrent, std::function<void()> release,
+                           std::function<void(const CommandList &)> execute)
+    : waitTime(0.0), makeCurrent(makeCurrent), release(release), execute(execute), submitted(LIST_COUNT + 1),
+      executed(LIST_COUNT), recording(nullptr), frame(0), sleeping(0)
+{
+  for (CommandList &list : lists)
+    executed.Push(&list);
+  thread = std::thread(&RenderThread::threadLoop, this);
+}
+
+// Returns an empty list for the next frame, waiting while the render thread still executes
+// every other list
+CommandList &RenderThread::Begin()
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  recording = pop(executed);
+  waitTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  recording->Reset(frame++);
+  return *recording;
+}
+
+// Hands the list Begin returned to the render thread
+void RenderThread::Submit()
+{
+  push(submitted, recording);
+  recording = nullptr;
+}
+
+// Render thread loop
+void RenderThread::threadLoop()
+{
+  makeCurrent();
+  while (true)
+  {
+    CommandList *list = pop(submitted);
+    if (list == nullptr)
+      break;
+    execute(*list);
+    push(executed, list);
+  }
+  release();
+}
+
+// Pushes a list and wakes the other thread if it sleeps
+void RenderThread::push(SPSCQueue<CommandList *> &queue, CommandList *list)
+{
+  // Lists only circulate, neither queue can be full
+  queue.Push(list);
+
+  // Pairs with pop announcing itself asleep before it checks the queue a last time: both
+  // modify sleeping, so either that check sees the list or this sees the sleeper
+  if (sleeping.fetch_add(0, std::memory_order_seq_cst) > 0)
+  {
+    {
+      // Waits out a sleeper between its last check and its wait, so the notify can't fall in between
+      std::lock_guard<std::mutex> lock(mutex);
+    }
+    pushed.notify_all();
+  }
+}
+
+// Pops a list, sleeping while the queue is empty
+CommandList *RenderThread::pop(SPSCQueue<CommandList *> &queue)
+{
+  CommandList *list;
+  if (queue.Pop(list))
+    return list;
+
+  sleeping.fetch_add(1, std::memory_order_seq_cst);
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    pushed.wait(lock, [&]()
+                { return !queue.Empty(); });
+  }
+  sleeping.fetch_sub(1, std::memory_order_relaxed);
+  queue.Pop(list);
+  return list;
+}
+
+// Waits for the submitted frames to be executed and stops the thread, which releases the context
+void RenderThread::Delete()
+{
+  if (!thread.joinable())
+    return;
+  push(submitted, nullptr);
+  thread.join();
+}
@@ -0,0 +1,46 @@
+#include "ShaderBatch.h"
+#include "GLExtensions.h"
+
+// Constructor of an empty batch, programs are looked up in the cache first when one is given
+ShaderBatch::ShaderBatch(ProgramCache *cache)
+    : cache(cache)
+{
+  parallel = has_gl_extension("GL_KHR_parallel_shader_compile") || has_gl_extension("GL_ARB_parallel_shader_compile");
+}
+
+// Submits a program and returns it right away, the batch keeps ownership
+Shader &ShaderBatch::Add(const char *vertexFile, const char *fragmentFile)
+{
+  shaders.emplace_back(new Shader(vertexFile, fragmentFile, cache, false));
+  return *shaders.back();
+}
+
+// Finishes the programs the driver is done with and returns how many are still compiling.
+// Never blocks, without the extension nothing is known to be done until first use
+size_t ShaderBatch::Pending()
+{
+  size_t pending = 0;
+  for (const std::unique_ptr<Shader> &shader : shaders)
+  {
+    if (shader->Ready())
+      shader->Finish();
+    else
+      pending++;
+  }
+  return pending;
+}
+
+// Blocks until every program is finished
+void ShaderBatch::WaitAll()
+{
+  for (const std::unique_ptr<Shader> &shader : shaders)
+    shader->Finish();
+}
+
+// Deletes every program of the batch
+void ShaderBatch::Delete()
+{
+  for (const std::unique_ptr<Shader> &shader : shaders)
+    shader->Delete();
+  shaders.clear();
+}
@@ -0,0 +1,226 @@
+#include "ShaderWatcher.h"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_set>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// How long the worker waits for edits before checking whether it should stop
+const int WATCH_INTERVAL_MS = 100;
+// Edits arriving this soon after the first one are handled together, editors save in several steps
+const int SETTLE_MS = 50;
+
+// "res/shaders/default.vert" -> "res/shaders"
+static std::string directory_of(const std::string &path)
+{
+  size_t slash = path.find_last_of("/\\");
+  return slash == std::string::npos ? std::string(".") : path.substr(0, slash);
+}
+
+// Modification time of a file in the clock's ticks, -1 if it doesn't exist right now
+static long long modification_time(const std::string &path)
+{
+  std::error_code error;
+  std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+  return error ? -1 : (long long)time.time_since_epoch().count();
+}
+
+// Constructor that starts the worker. makeCurrent and release are called on the worker
+// thread to bind and unbind a context that shares objects with the render context
+ShaderWatcher::ShaderWatcher(std::function<void()> makeCurrent, std::function<void()> release)
+    : reloads(0), failures(0), makeCurrent(makeCurrent), release(release), running(true), inotifyFd(-1)
+{
+#ifdef __linux__
+  inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotifyFd < 0)
+    std::cerr << "Warning: inotify is unavailable, polling shader files instead" << std::endl;
+#endif
+  worker = std::thread(&ShaderWatcher::workerLoop, this);
+}
+
+// Rebuilds the program whenever one of its files changes, the Shader must outlive the watcher
+void ShaderWatcher::Watch(Shader &shader, const char *vertexFile, const char *fragmentFile)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  programs.push_back(Program{&shader, vertexFile, fragmentFile});
+
+  for (const std::string &file : {programs.back().vertexFile, programs.back().fragmentFile})
+  {
+    modificationTimes[file] = modification_time(file);
+#ifdef __linux__
+    // Watch the directory rather than the file, editors often replace files by renaming over them
+    if (inotifyFd >= 0)
+    {
+      std::string directory = directory_of(file);
+      int watch = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+      if (watch >= 0)
+        watchedDirectories[watch] = directory;
+      else
+        std::cerr << "Warning: Failed to watch " << directory << std::endl;
+    }
+#endif
+  }
+}
+
+// Swaps in the programs that finished rebuilding, returns how many. Never blocks.
+// Uniform values live in the program, so the caller sets its one time uniforms again
+int ShaderWatcher::Update()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  int swapped = 0;
+  size_t done = 0;
+  for (; done < finished.size(); done++)
+  {
+    Rebuilt &rebuilt = finished[done];
+    // Fences of one context signal in order, so the rest can't be done either
+    if (glClientWaitSync(rebuilt.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+      break;
+    glDeleteSync(rebuilt.fence);
+
+    GLuint previous = rebuilt.target->ID;
+    *rebuilt.target = std::move(*rebuilt.program);
+    glDeleteProgram(previous);
+    swapped++;
+  }
+  finished.erase(finished.begin(), finished.begin() + done);
+  reloads.fetch_add(swapped, std::memory_order_relaxed);
+  return swapped;
+}
+
+// Stops the worker and deletes the programs that were never swapped in
+void ShaderWatcher::Delete()
+{
+  running = false;
+  if (worker.joinable())
+    worker.join();
+
+  for (Rebuilt &rebuilt : finished)
+  {
+    glDeleteSync(rebuilt.fence);
+    rebuilt.program->Delete();
+  }
+  finished.clear();
+
+#ifdef __linux__
+  if (inotifyFd >= 0)
+    close(inotifyFd);
+  inotifyFd = -1;
+#endif
+}
+
+void ShaderWatcher::workerLoop()
+{
+  makeCurrent();
+  while (running)
+  {
+    std::vector<std::string> changes = waitForChanges();
+    if (changes.empty())
+      continue;
+
+    std::vector<Program> affected;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (const Program &program : programs)
+      {
+        for (const std::string &change : changes)
+        {
+          if (change == program.vertexFile || change == program.fragmentFile)
+          {
+            affected.push_back(program);
+            break;
+          }
+        }
+      }
+    }
+    for (const Program &program : affected)
+      rebuild(program);
+  }
+  release();
+}
+
+// Waits a short while for edits and returns the paths of the files that changed
+std::vector<std::string> ShaderWatcher::waitForChanges()
+{
+  std::unordered_set<std::string> changed;
+
+#ifdef __linux__
+  if (inotifyFd >= 0)
+  {
+    int timeout = WATCH_INTERVAL_MS;
+    pollfd descriptor = {inotifyFd, POLLIN, 0};
+    while (poll(&descriptor, 1, timeout) > 0)
+    {
+      alignas(inotify_event) char buffer[4096];
+      ssize_t length;
+      while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+      {
+        for (char *at = buffer; at < buffer + length;)
+        {
+          const inotify_event *event = (const inotify_event *)at;
+          std::lock_guard<std::mutex> lock(mutex);
+          auto directory = watchedDirectories.find(event->wd);
+          if (event->len > 0 && directory != watchedDirectories.end())
+            changed.insert(directory->second + "/" + event->name);
+          at += sizeof(inotify_event) + event->len;
+        }
+      }
+      // Keep collecting while the editor is still busy saving
+      timeout = SETTLE_MS;
+    }
+    return std::vector<std::string>(changed.begin(), changed.end());
+  }
+#endif
+
+  // No inotify, compare modification times instead
+  std::this_thread::sleep_for(std::chrono::milliseconds(WATCH_INTERVAL_MS));
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto &file : modificationTimes)
+  {
+    long long time = modification_time(file.first);
+    if (time != file.second && time != -1)
+    {
+      file.second = time;
+      changed.insert(file.first);
+    }
+  }
+  return std::vector<std::string>(changed.begin(), changed.end());
+}
+
+// Builds a new program from the current files, queues it for Update on success
+void ShaderWatcher::rebuild(const Program &program)
+{
+  std::unique_ptr<Shader> rebuilt;
+  try
+  {
+    rebuilt.reset(new Shader(program.vertexFile.c_str(), program.fragmentFile.c_str()));
+  }
+  catch (const std::runtime_error &error)
+  {
+    // The file may be missing for a moment while an editor replaces it
+    std::cerr << "Warning: Keeping the previous program, " << error.what() << std::endl;
+    failures.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  if (!rebuilt->Linked())
+  {
+    std::cerr << "Warning: Keeping the previous program, " << program.vertexFile << " + "
+              << program.fragmentFile << " failed to build" << std::endl;
+    rebuilt->Delete();
+    failures.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  // The render context may only use the program once this context is done with it
+  GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  glFlush();
+  std::cout << "Reloaded " << program.vertexFile << " + " << program.fragmentFile << std::endl;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  finished.push_back(Rebuilt{program.shader, std::move(rebuilt), fence});
+}
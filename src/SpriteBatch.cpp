@@ -0,0 +1,177 @@
+#include "SpriteBatch.h"
+#include "RenderState.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
+
+// Index pattern of one quad, vertices are bottom left, top left, top right, bottom right
+static std::vector<GLuint> quad_indices(GLsizei maxSprites)
+{
+  std::vector<GLuint> indices((size_t)maxSprites * 6);
+  for (GLsizei i = 0; i < maxSprites; i++)
+  {
+    GLuint first = (GLuint)i * 4;
+    GLuint *quad = &indices[(size_t)i * 6];
+    quad[0] = first;
+    quad[1] = first + 2;
+    quad[2] = first + 1;
+    quad[3] = first;
+    quad[4] = first + 3;
+    quad[5] = first + 2;
+  }
+  return indices;
+}
+
+// Converts a 0-1 color into RGBA8 bytes in memory order
+static uint32_t pack_color(const glm::vec4 &color)
+{
+  uint32_t packed = 0;
+  for (int i = 0; i < 4; i++)
+  {
+    float channel = std::min(std::max(color[i], 0.0f), 1.0f);
+    packed |= (uint32_t)(channel * 255.0f + 0.5f) << (8 * i);
+  }
+  return packed;
+}
+
+// Constructor that allocates room for maxSprites per flush, larger batches are split
+SpriteBatch::SpriteBatch(GLsizei maxSprites)
+    : spriteCount(0), drawCalls(0), maxSprites(maxSprites), projection(1.0f),
+      vertices(GL_ARRAY_BUFFER, (GLsizeiptr)maxSprites * 4 * sizeof(Vertex)),
+      indices(quad_indices(maxSprites).data(), (GLsizeiptr)maxSprites * 6 * sizeof(GLuint))
+{
+  // The EBO constructor left the indices bound, attach them to the VAO
+  vao.Bind();
+  indices.Bind();
+  vao.LinkAttrib(vertices, 0, 2, GL_FLOAT, sizeof(Vertex), (void *)offsetof(Vertex, x));
+  vao.LinkAttrib(vertices, 1, 2, GL_FLOAT, sizeof(Vertex), (void *)offsetof(Vertex, u));
+  vao.LinkAttrib(vertices, 2, 4, GL_UNSIGNED_BYTE, sizeof(Vertex), (void *)offsetof(Vertex, color));
+  vao.Unbind();
+  indices.Unbind();
+}
+
+// Starts a new batch, projection maps sprite positions to clip space
+void SpriteBatch::Begin(const glm::mat4 &projection)
+{
+  this->projection = projection;
+  x.clear();
+  y.clear();
+  width.clear();
+  height.clear();
+  uvs.clear();
+  colors.clear();
+  keys.clear();
+  shaders.clear();
+}
+
+// Queues a sprite. The rectangle spans position to position + size, uv is (u0, v0, u1, v1).
+// Lower layers are drawn first
+void SpriteBatch::Draw(Shader &shader, GLuint texture, const glm::vec2 &position, const glm::vec2 &size,
+                       const glm::vec4 &uv, const glm::vec4 &color, uint8_t layer)
+{
+  x.push_back(position.x);
+  y.push_back(position.y);
+  width.push_back(size.x);
+  height.push_back(size.y);
+  uvs.push_back(uv);
+  colors.push_back(pack_color(color));
+  keys.push_back((uint64_t)layer << 56 | shaderSlot(shader) << 40 | texture);
+}
+
+// Sorts and draws every queued sprite
+void SpriteBatch::End()
+{
+  spriteCount = keys.size();
+  drawCalls = 0;
+  if (keys.empty())
+    return;
+
+  // Sort indices rather than moving every attribute around, ties keep their draw order
+  order.resize(keys.size());
+  for (size_t i = 0; i < order.size(); i++)
+    order[i] = (uint32_t)i;
+  std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+                   { return keys[a] < keys[b]; });
+
+  vao.Bind();
+  RenderState::ActiveTexture(GL_TEXTURE0);
+  for (size_t first = 0; first < order.size(); first += maxSprites)
+    flush(first, std::min(order.size() - first, (size_t)maxSprites));
+  vao.Unbind();
+}
+
+// Deletes the buffers
+void SpriteBatch::Delete()
+{
+  vao.Delete();
+  vertices.Delete();
+  indices.Delete();
+}
+
+// Returns the slot of a program, adding it if it is new this batch
+uint64_t SpriteBatch::shaderSlot(Shader &shader)
+{
+  // Batches use a handful of programs, a linear search beats hashing
+  for (size_t i = 0; i < shaders.size(); i++)
+  {
+    if (shaders[i] == &shader)
+      return i;
+  }
+  shaders.push_back(&shader);
+  return shaders.size() - 1;
+}
+
+// Writes and draws order[first, first + count)
+void SpriteBatch::flush(size_t first, size_t count)
+{
+  Vertex *vertex = (Vertex *)vertices.Map();
+  for (size_t i = first; i < first + count; i++)
+  {
+    uint32_t sprite = order[i];
+    float left = x[sprite], bottom = y[sprite];
+    float right = left + width[sprite], top = bottom + height[sprite];
+    const glm::vec4 &uv = uvs[sprite];
+    GLubyte color[4];
+    memcpy(color, &colors[sprite], 4);
+
+    vertex[0] = Vertex{left, bottom, uv.x, uv.y, {color[0], color[1], color[2], color[3]}};
+    vertex[1] = Vertex{left, top, uv.x, uv.w, {color[0], color[1], color[2], color[3]}};
+    vertex[2] = Vertex{right, top, uv.z, uv.w, {color[0], color[1], color[2], color[3]}};
+    vertex[3] = Vertex{right, bottom, uv.z, uv.y, {color[0], color[1], color[2], color[3]}};
+    vertex += 4;
+  }
+  vertices.Unmap();
+
+  // The segment starts at a multiple of the vertex size, address it with a base vertex
+  GLint baseVertex = (GLint)(vertices.offset / sizeof(Vertex));
+  uint64_t currentShader = ~0ull;
+  GLuint currentTexture = 0;
+  for (size_t run = first; run < first + count;)
+  {
+    uint64_t key = keys[order[run]];
+    size_t end = run + 1;
+    while (end < first + count && keys[order[end]] == key)
+      end++;
+
+    uint64_t slot = (key >> 40) & 0xFFFF;
+    GLuint texture = (GLuint)(key & 0xFFFFFFFFFFull);
+    if (slot != currentShader)
+    {
+      shaders[slot]->Activate();
+      shaders[slot]->setMat4("projection", projection);
+      currentShader = slot;
+    }
+    if (texture != currentTexture)
+    {
+      RenderState::BindTexture(GL_TEXTURE_2D, texture);
+      currentTexture = texture;
+    }
+
+    glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)(end - run) * 6, GL_UNSIGNED_INT,
+                             (void *)((run - first) * 6 * sizeof(GLuint)), baseVertex);
+    drawCalls++;
+    run = end;
+  }
+  vertices.Fence();
+}
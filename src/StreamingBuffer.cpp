@@ -0,0 +1,136 @@
+#include "StreamingBuffer.h"
+#include "RenderState.h"
+#include <iostream>
+#include <cstdlib>
+
+// Constructor that generates a buffer with room for segmentSize bytes per frame
+StreamingBuffer::StreamingBuffer(GLenum target, GLsizeiptr segmentSize)
+    : target(target), segmentSize(segmentSize), offset(0), stalls(0), mapped(nullptr), segment(SEGMENT_COUNT - 1)
+{
+  for (int i = 0; i < SEGMENT_COUNT; i++)
+    fences[i] = 0;
+
+  // The bundled glad only loads core entry points, so glBufferStorage exists from 4.4 on even
+  // where GL_ARB_buffer_storage is exposed earlier
+  persistent = GLAD_GL_VERSION_4_4;
+
+  glGenBuffers(1, &ID);
+  RenderState::BindBuffer(target, ID);
+
+  if (persistent)
+  {
+    // Immutable storage for all segments, mapped once for the lifetime of the buffer
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(target, segmentSize * SEGMENT_COUNT, nullptr, flags);
+    mapped = (unsigned char *)glMapBufferRange(target, 0, segmentSize * SEGMENT_COUNT, flags);
+    if (mapped == nullptr)
+    {
+      std::cerr << "Error: Failed to persistently map streaming buffer " << ID << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+  else
+  {
+    // A single segment is enough, orphaning gives every frame its own storage
+    glBufferData(target, segmentSize, nullptr, GL_STREAM_DRAW);
+  }
+
+  RenderState::BindBuffer(target, 0);
+}
+
+// Returns a write only pointer to the next segment, waiting for the GPU if it is still reading it
+void *StreamingBuffer::Map()
+{
+  segment = (segment + 1) % SEGMENT_COUNT;
+
+  if (!persistent)
+  {
+    // Orphan the old storage, the GPU keeps reading it while we fill the new one
+    offset = 0;
+    RenderState::BindBuffer(target, ID);
+    glBufferData(target, segmentSize, nullptr, GL_STREAM_DRAW);
+    void *data = glMapBufferRange(target, 0, segmentSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (data == nullptr)
+    {
+      std::cerr << "Error: Failed to map streaming buffer " << ID << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    return data;
+  }
+
+  offset = (GLintptr)segment * segmentSize;
+
+  // Wait until the draw calls that last read this segment have finished
+  if (fences[segment] != 0)
+  {
+    GLenum result = glClientWaitSync(fences[segment], 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+      stalls++;
+      do
+      {
+        result = glClientWaitSync(fences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+      } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    if (result == GL_WAIT_FAILED)
+      std::cerr << "Error: Waiting on streaming buffer fence failed" << std::endl;
+
+    glDeleteSync(fences[segment]);
+    fences[segment] = 0;
+  }
+
+  return mapped + offset;
+}
+
+// Ends writing to the current segment
+void StreamingBuffer::Unmap()
+{
+  // The persistent mapping is coherent, writes become visible without an explicit flush
+  if (!persistent)
+  {
+    RenderState::BindBuffer(target, ID);
+    glUnmapBuffer(target);
+  }
+}
+
+// Marks the current segment as in use by the draw calls issued so far
+void StreamingBuffer::Fence()
+{
+  if (!persistent)
+    return;
+
+  if (fences[segment] != 0)
+    glDeleteSync(fences[segment]);
+  fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+// Binds the buffer
+void StreamingBuffer::Bind()
+{
+  RenderState::BindBuffer(target, ID);
+}
+
+// Unbinds the buffer
+void StreamingBuffer::Unbind()
+{
+  RenderState::BindBuffer(target, 0);
+}
+
+// Deletes the buffer and its fences
+void StreamingBuffer::Delete()
+{
+  for (int i = 0; i < SEGMENT_COUNT; i++)
+  {
+    if (fences[i] != 0)
+      glDeleteSync(fences[i]);
+    fences[i] = 0;
+  }
+
+  if (persistent)
+  {
+    RenderState::BindBuffer(target, ID);
+    glUnmapBuffer(target);
+    RenderState::BindBuffer(target, 0);
+  }
+  RenderState::DeleteBuffer(ID);
+}
@@ -1,10 +1,23 @@
 #include "Texture.h"
+#include "RenderState.h"
+#include "CompressedImage.h"
+#include "MipChain.h"
+#include "GLCheck.h"
+#include "DebugOutput.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 Texture::Texture(const char *image, GLenum texType, GLenum slot, GLenum format, GLenum pixelType)
 {
   type = texType;
+
+  // Block compressed containers are uploaded as they are, there is nothing to decode
+  if (is_compressed_image(image))
+  {
+    loadCompressed(image, slot);
+    return;
+  }
+
   // Stores the width, height, and the number of color channels of the image
   int widthImg, heightImg, numColCh;
 
@@ -32,7 +45,7 @@ Texture::Texture(const char *image, GLenum texType, GLenum slot, GLenum format,
 
   // Generates an OpenGL texture object
   glGenTextures(1, &ID);
-  if (glGetError() != GL_NO_ERROR)
+  if (gl_check_failed())
   {
     std::cerr << "Error: Failed to generate texture object for " << image << std::endl;
     stbi_image_free(bytes);
@@ -47,26 +60,27 @@ Texture::Texture(const char *image, GLenum texType, GLenum slot, GLenum format,
     exit(EXIT_FAILURE);
   }
   // Assigns the texture to a Texture Unit
-  glActiveTexture(slot);
-  if (glGetError() != GL_NO_ERROR)
+  RenderState::ActiveTexture(slot);
+  if (gl_check_failed())
   {
     std::cerr << "Error: Failed to activate texture slot for " << image << std::endl;
     stbi_image_free(bytes);
     exit(EXIT_FAILURE);
   }
 
-  glBindTexture(texType, ID);
-  if (glGetError() != GL_NO_ERROR)
+  RenderState::BindTexture(texType, ID);
+  if (gl_check_failed())
   {
     std::cerr << "Error: Failed to bind texture for " << image << std::endl;
     stbi_image_free(bytes);
     exit(EXIT_FAILURE);
   }
+  DebugOutput::Label(GL_TEXTURE, ID, image);
 
   // Configures the type of algorithm that is used to make the image smaller or bigger
   glTexParameteri(texType, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
   glTexParameteri(texType, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  if (glGetError() != GL_NO_ERROR)
+  if (gl_check_failed())
   {
     std::cerr << "Error: Failed to set texture parameters for " << image << std::endl;
     stbi_image_free(bytes);
@@ -76,7 +90,7 @@ Texture::Texture(const char *image, GLenum texType, GLenum slot, GLenum format,
   // Configures the way the texture repeats (if it does at all)
   glTexParameteri(texType, GL_TEXTURE_WRAP_S, GL_REPEAT);
   glTexParameteri(texType, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  if (glGetError() != GL_NO_ERROR)
+  if (gl_check_failed())
   {
     std::cerr << "Error: Failed to configure texture wrapping for " << image << std::endl;
     stbi_image_free(bytes);
@@ -87,19 +101,28 @@ Texture::Texture(const char *image, GLenum texType, GLenum slot, GLenum format,
   GLenum internalFormat = (numColCh == 4) ? GL_RGBA : GL_RGB;
   GLenum imageFormat = (numColCh == 4) ? GL_RGBA : GL_RGB;
 
+  // Rows of RGB images (and of their odd sized mip levels) are tightly packed
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
   glTexImage2D(texType, 0, internalFormat, widthImg, heightImg, 0, imageFormat, pixelType, bytes);
-  if (glGetError() != GL_NO_ERROR)
+  if (gl_check_failed())
   {
     std::cerr << "Error: Failed to upload texture data for " << image << std::endl;
     stbi_image_free(bytes);
     exit(EXIT_FAILURE);
   }
 
-  // Generates MipMaps
-  glGenerateMipmap(texType);
-  if (glGetError() != GL_NO_ERROR)
+  // Generates MipMaps on the CPU and uploads every level, glGenerateMipmap is slow on
+  // software rasterizers and its filter quality differs between drivers
+  std::vector<MipLevel> mips = generate_mip_chain(bytes, widthImg, heightImg, numColCh, MIP_FILTER_BOX, false);
+  for (size_t level = 0; level < mips.size(); level++)
   {
-    std::cerr << "Error: Failed to generate mipmaps for " << image << std::endl;
+    glTexImage2D(texType, (GLint)level + 1, internalFormat, mips[level].width, mips[level].height, 0,
+                 imageFormat, pixelType, mips[level].pixels.data());
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  if (gl_check_failed())
+  {
+    std::cerr << "Error: Failed to upload mipmaps for " << image << std::endl;
     stbi_image_free(bytes);
     exit(EXIT_FAILURE);
   }
@@ -108,60 +131,147 @@ Texture::Texture(const char *image, GLenum texType, GLenum slot, GLenum format,
   stbi_image_free(bytes);
 
   // Unbinds the OpenGL Texture object so that it can't accidentally be modified
-  glBindTexture(texType, 0);
-  if (glGetError() != GL_NO_ERROR)
+  RenderState::BindTexture(texType, 0);
+  if (gl_check_failed())
   {
     std::cerr << "Error: Failed to unbind texture for " << image << std::endl;
     exit(EXIT_FAILURE);
   }
 }
 
-void Texture::texUnit(Shader &shader, const char *uniform, GLuint unit)
+// Uploads a baked texture and its mip chain straight from a memory mapped TexturePack
+Texture::Texture(const TexturePack &pack, const char *name, GLenum texType, GLenum slot)
 {
-  // Gets the location of the uniform
-  GLuint texUni = glGetUniformLocation(shader.ID, uniform);
-  if (texUni == -1)
+  type = texType;
+
+  const TexturePack::Entry *entry = pack.Find(name);
+  if (entry == nullptr)
   {
-    std::cerr << "Error: Uniform " << uniform << " not found in shader program." << std::endl;
+    std::cerr << "Error: Texture pack has no texture named " << name << std::endl;
     exit(EXIT_FAILURE);
   }
 
-  // Shader needs to be activated before changing the value of a uniform
-  shader.Activate();
-  glUniform1i(texUni, unit);
-  if (glGetError() != GL_NO_ERROR)
+  if (entry->format == 0 && !compressed_format_supported(entry->internalFormat))
   {
-    std::cerr << "Error: Failed to set uniform " << uniform << std::endl;
+    std::cerr << "Error: Compressed format 0x" << std::hex << entry->internalFormat << std::dec
+              << " of " << name << " is not supported by this driver" << std::endl;
     exit(EXIT_FAILURE);
   }
-}
 
-void Texture::Bind()
-{
-  glBindTexture(type, ID);
-  if (glGetError() != GL_NO_ERROR)
+  if (slot < GL_TEXTURE0 || slot > GL_TEXTURE31)
+  {
+    std::cerr << "Error: Invalid texture slot " << slot << ". Must be between GL_TEXTURE0 and GL_TEXTURE31." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  glGenTextures(1, &ID);
+  RenderState::ActiveTexture(slot);
+  RenderState::BindTexture(type, ID);
+  DebugOutput::Label(GL_TEXTURE, ID, name);
+
+  // Same sampling as textures decoded at runtime
+  glTexParameteri(type, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+  glTexParameteri(type, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(type, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(type, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+  // Every level was baked offline, nothing is generated here
+  glTexParameteri(type, GL_TEXTURE_MAX_LEVEL, (GLint)entry->levelCount - 1);
+  for (uint32_t level = 0; level < entry->levelCount; level++)
+    pack.UploadLevel(*entry, type, level);
+
+  if (gl_check_failed())
   {
-    std::cerr << "Error: Failed to bind texture with ID " << ID << std::endl;
+    std::cerr << "Error: Failed to upload baked texture " << name << std::endl;
     exit(EXIT_FAILURE);
   }
+
+  RenderState::BindTexture(type, 0);
 }
 
-void Texture::Unbind()
+// Uploads a block compressed DDS/KTX2 image and its stored mip chain
+void Texture::loadCompressed(const char *image, GLenum slot)
 {
-  glBindTexture(type, 0);
-  if (glGetError() != GL_NO_ERROR)
+  CompressedImage compressed;
+  if (!load_compressed_image(image, compressed))
+    exit(EXIT_FAILURE);
+
+  std::cout << "Loaded compressed image: " << image << " (" << compressed.width << "x" << compressed.height << ", "
+            << compressed.levels.size() << " levels, format 0x" << std::hex << compressed.format << std::dec << ")" << std::endl;
+
+  if (!compressed_format_supported(compressed.format))
+  {
+    std::cerr << "Error: Compressed format 0x" << std::hex << compressed.format << std::dec
+              << " of " << image << " is not supported by this driver" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (slot < GL_TEXTURE0 || slot > GL_TEXTURE31)
   {
-    std::cerr << "Error: Failed to unbind texture with ID " << ID << std::endl;
+    std::cerr << "Error: Invalid texture slot " << slot << ". Must be between GL_TEXTURE0 and GL_TEXTURE31." << std::endl;
     exit(EXIT_FAILURE);
   }
+
+  glGenTextures(1, &ID);
+  RenderState::ActiveTexture(slot);
+  RenderState::BindTexture(type, ID);
+  DebugOutput::Label(GL_TEXTURE, ID, image);
+
+  // Same sampling as uncompressed textures
+  glTexParameteri(type, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+  glTexParameteri(type, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(type, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(type, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+  // The mip chain comes from the file, only sample the levels it has
+  glTexParameteri(type, GL_TEXTURE_MAX_LEVEL, (GLint)compressed.levels.size() - 1);
+  for (size_t level = 0; level < compressed.levels.size(); level++)
+  {
+    const CompressedImage::Level &mip = compressed.levels[level];
+    glCompressedTexImage2D(type, (GLint)level, compressed.format, mip.width, mip.height, 0,
+                           (GLsizei)mip.size, compressed.data.data() + mip.offset);
+  }
+
+  if (gl_check_failed())
+  {
+    std::cerr << "Error: Failed to upload compressed texture data for " << image << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  RenderState::BindTexture(type, 0);
 }
 
-void Texture::Delete()
+void Texture::texUnit(Shader &shader, const char *uniform, GLuint unit)
 {
-  glDeleteTextures(1, &ID);
-  if (glGetError() != GL_NO_ERROR)
+  // Shader needs to be activated before changing the value of a uniform,
+  // which also waits for it if it is still compiling
+  shader.Activate();
+
+  // Gets the location of the uniform from the shader's cache
+  if (shader.GetUniformLocation(uniform) == -1)
   {
-    std::cerr << "Error: Failed to delete texture with ID " << ID << std::endl;
+    std::cerr << "Error: Uniform " << uniform << " not found in shader program." << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  shader.setInt(uniform, unit);
+  if (gl_check_failed())
+  {
+    std::cerr << "Error: Failed to set uniform " << uniform << std::endl;
     exit(EXIT_FAILURE);
   }
+}
+
+void Texture::Bind()
+{
+  RenderState::BindTexture(type, ID);
+}
+
+void Texture::Unbind()
+{
+  RenderState::BindTexture(type, 0);
+}
+
+void Texture::Delete()
+{
+  RenderState::DeleteTexture(ID);
 }
\ No newline at end of file
@@ -0,0 +1,376 @@
+#include "TextureCompressor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// Principal axis of a set of RGBA points found by power iteration on their covariance.
+// channels is 3 to ignore alpha, 4 to include it
+static void principal_axis(const float points[16][4], int channels, const float mean[4], float axis[4])
+{
+  float cov[4][4] = {};
+  for (int i = 0; i < 16; i++)
+    for (int a = 0; a < channels; a++)
+      for (int b = 0; b < channels; b++)
+        cov[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+
+  for (int a = 0; a < 4; a++)
+    axis[a] = a < channels ? 1.0f : 0.0f;
+  for (int iteration = 0; iteration < 8; iteration++)
+  {
+    float next[4] = {};
+    for (int a = 0; a < channels; a++)
+      for (int b = 0; b < channels; b++)
+        next[a] += cov[a][b] * axis[b];
+    float length = 0.0f;
+    for (int a = 0; a < channels; a++)
+      length += next[a] * next[a];
+    if (length < 1e-12f)
+      return;
+    length = std::sqrt(length);
+    for (int a = 0; a < channels; a++)
+      axis[a] = next[a] / length;
+  }
+}
+
+// Endpoints of a block along its principal axis, the extremes of the projected pixels
+static void fit_endpoints(const unsigned char *rgba, int channels, float low[4], float high[4])
+{
+  float points[16][4], mean[4] = {};
+  for (int i = 0; i < 16; i++)
+    for (int c = 0; c < 4; c++)
+    {
+      points[i][c] = rgba[i * 4 + c];
+      mean[c] += points[i][c] / 16.0f;
+    }
+
+  float axis[4];
+  principal_axis(points, channels, mean, axis);
+
+  float minT = 1e30f, maxT = -1e30f;
+  for (int i = 0; i < 16; i++)
+  {
+    float t = 0.0f;
+    for (int c = 0; c < channels; c++)
+      t += (points[i][c] - mean[c]) * axis[c];
+    minT = std::min(minT, t);
+    maxT = std::max(maxT, t);
+  }
+
+  // Inset the extremes slightly, the interpolated colors then cover the block better
+  float inset = (maxT - minT) / 32.0f;
+  minT += inset;
+  maxT -= inset;
+  for (int c = 0; c < 4; c++)
+  {
+    low[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * minT));
+    high[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * maxT));
+  }
+}
+
+static uint16_t pack_565(const float color[4])
+{
+  int r = (int)std::lround(color[0] * 31.0f / 255.0f);
+  int g = (int)std::lround(color[1] * 63.0f / 255.0f);
+  int b = (int)std::lround(color[2] * 31.0f / 255.0f);
+  return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpack_565(uint16_t packed, int color[3])
+{
+  int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+  color[0] = (r << 3) | (r >> 2);
+  color[1] = (g << 2) | (g >> 4);
+  color[2] = (b << 3) | (b >> 2);
+}
+
+// Encodes a 4x4 block of RGBA8 pixels (row major, 64 bytes)
+void compress_bc1_block(const unsigned char *rgba, unsigned char *out)
+{
+  float low[4], high[4];
+  fit_endpoints(rgba, 3, low, high);
+  uint16_t c0 = pack_565(high), c1 = pack_565(low);
+
+  uint32_t indices = 0;
+  if (c0 != c1)
+  {
+    // c0 > c1 selects the opaque 4 color mode
+    if (c0 < c1)
+      std::swap(c0, c1);
+
+    int palette[4][3];
+    unpack_565(c0, palette[0]);
+    unpack_565(c1, palette[1]);
+    for (int c = 0; c < 3; c++)
+    {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    for (int i = 0; i < 16; i++)
+    {
+      int best = 0, bestError = 1 << 30;
+      for (int p = 0; p < 4; p++)
+      {
+        int error = 0;
+        for (int c = 0; c < 3; c++)
+        {
+          int d = rgba[i * 4 + c] - palette[p][c];
+          error += d * d;
+        }
+        if (error < bestError)
+        {
+          bestError = error;
+          best = p;
+        }
+      }
+      indices |= (uint32_t)best << (i * 2);
+    }
+  }
+
+  out[0] = c0 & 0xFF;
+  out[1] = c0 >> 8;
+  out[2] = c1 & 0xFF;
+  out[3] = c1 >> 8;
+  for (int i = 0; i < 4; i++)
+    out[4 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+// BC3/BC4 style alpha block: two 8 bit endpoints and 3 bit indices into 8 interpolated values
+static void compress_alpha_block(const unsigned char *rgba, unsigned char *out)
+{
+  int a0 = 0, a1 = 255;
+  for (int i = 0; i < 16; i++)
+  {
+    a0 = std::max(a0, (int)rgba[i * 4 + 3]);
+    a1 = std::min(a1, (int)rgba[i * 4 + 3]);
+  }
+
+  uint64_t indices = 0;
+  if (a0 != a1)
+  {
+    // a0 > a1 selects the 8 value mode
+    int palette[8] = {a0, a1};
+    for (int p = 1; p < 7; p++)
+      palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+
+    for (int i = 0; i < 16; i++)
+    {
+      int best = 0, bestError = 1 << 30;
+      for (int p = 0; p < 8; p++)
+      {
+        int error = std::abs(rgba[i * 4 + 3] - palette[p]);
+        if (error < bestError)
+        {
+          bestError = error;
+          best = p;
+        }
+      }
+      indices |= (uint64_t)best << (i * 3);
+    }
+  }
+
+  out[0] = (unsigned char)a0;
+  out[1] = (unsigned char)a1;
+  for (int i = 0; i < 6; i++)
+    out[2 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+void compress_bc3_block(const unsigned char *rgba, unsigned char *out)
+{
+  compress_alpha_block(rgba, out);
+  compress_bc1_block(rgba, out + 8);
+}
+
+// Appends the low bits of value to a 128 bit little endian block
+static void put_bits(unsigned char *block, int &position, uint32_t value, int bits)
+{
+  for (int i = 0; i < bits; i++, position++)
+    if (value & (1u << i))
+      block[position / 8] |= (unsigned char)(1u << (position % 8));
+}
+
+// Encodes a 4x4 block of RGBA8 pixels as BC7 mode 6: one subset, RGBA 7.7.7.7 endpoints
+// with a p-bit each and 4 bit indices
+void compress_bc7_block(const unsigned char *rgba, unsigned char *out)
+{
+  static const int WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+  float endpoints[2][4];
+  fit_endpoints(rgba, 4, endpoints[0], endpoints[1]);
+
+  // Quantize each endpoint to 7 bits per channel, choosing the p-bit that lands closer
+  int quantized[2][4], pbit[2];
+  for (int e = 0; e < 2; e++)
+  {
+    int bestError = 1 << 30;
+    for (int p = 0; p < 2; p++)
+    {
+      int error = 0, values[4];
+      for (int c = 0; c < 4; c++)
+      {
+        values[c] = std::min(127, std::max(0, (int)std::lround((endpoints[e][c] - p) / 2.0f)));
+        int d = ((values[c] << 1) | p) - (int)std::lround(endpoints[e][c]);
+        error += d * d;
+      }
+      if (error < bestError)
+      {
+        bestError = error;
+        pbit[e] = p;
+        memcpy(quantized[e], values, sizeof(values));
+      }
+    }
+  }
+
+  int palette[16][4];
+  for (int c = 0; c < 4; c++)
+  {
+    int e0 = (quantized[0][c] << 1) | pbit[0];
+    int e1 = (quantized[1][c] << 1) | pbit[1];
+    for (int i = 0; i < 16; i++)
+      palette[i][c] = ((64 - WEIGHTS[i]) * e0 + WEIGHTS[i] * e1 + 32) >> 6;
+  }
+
+  int indices[16];
+  for (int i = 0; i < 16; i++)
+  {
+    int bestError = 1 << 30;
+    for (int p = 0; p < 16; p++)
+    {
+      int error = 0;
+      for (int c = 0; c < 4; c++)
+      {
+        int d = rgba[i * 4 + c] - palette[p][c];
+        error += d * d;
+      }
+      if (error < bestError)
+      {
+        bestError = error;
+        indices[i] = p;
+      }
+    }
+  }
+
+  // The first index is stored with 3 bits, so its top bit must be 0: swap the endpoints if needed
+  if (indices[0] & 8)
+  {
+    std::swap(quantized[0], quantized[1]);
+    std::swap(pbit[0], pbit[1]);
+    for (int i = 0; i < 16; i++)
+      indices[i] = 15 - indices[i];
+  }
+
+  memset(out, 0, 16);
+  int position = 0;
+  put_bits(out, position, 1u << 6, 7); // mode 6
+  for (int c = 0; c < 4; c++)
+  {
+    put_bits(out, position, quantized[0][c], 7);
+    put_bits(out, position, quantized[1][c], 7);
+  }
+  put_bits(out, position, pbit[0], 1);
+  put_bits(out, position, pbit[1], 1);
+  put_bits(out, position, indices[0], 3);
+  for (int i = 1; i < 16; i++)
+    put_bits(out, position, indices[i], 4);
+}
+
+// Encodes a whole RGBA8 image, edge blocks are padded by repeating the last row/column
+std::vector<unsigned char> compress_image(const unsigned char *rgba, int width, int height, BlockFormat format)
+{
+  int blocksX = std::max(1, (width + 3) / 4), blocksY = std::max(1, (height + 3) / 4);
+  size_t blockSize = format == BLOCK_BC1 ? 8 : 16;
+  std::vector<unsigned char> compressed(blocksX * blocksY * blockSize);
+
+  unsigned char block[64];
+  for (int by = 0; by < blocksY; by++)
+    for (int bx = 0; bx < blocksX; bx++)
+    {
+      for (int y = 0; y < 4; y++)
+        for (int x = 0; x < 4; x++)
+        {
+          int px = std::min(bx * 4 + x, width - 1), py = std::min(by * 4 + y, height - 1);
+          memcpy(&block[(y * 4 + x) * 4], &rgba[((size_t)py * width + px) * 4], 4);
+        }
+
+      unsigned char *out = &compressed[((size_t)by * blocksX + bx) * blockSize];
+      if (format == BLOCK_BC1)
+        compress_bc1_block(block, out);
+      else if (format == BLOCK_BC3)
+        compress_bc3_block(block, out);
+      else
+        compress_bc7_block(block, out);
+    }
+
+  return compressed;
+}
+
+static void write_u32(std::ofstream &out, uint32_t value)
+{
+  unsigned char bytes[4] = {(unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24)};
+  out.write((const char *)bytes, 4);
+}
+
+// Writes compressed mip levels (largest first) to a DDS file
+bool write_dds(const char *filename, BlockFormat format, bool srgb, int width, int height,
+               const std::vector<std::vector<unsigned char>> &levels)
+{
+  std::ofstream out(filename, std::ios::binary);
+  if (!out)
+  {
+    std::cerr << "Error: Failed to open " << filename << " for writing" << std::endl;
+    return false;
+  }
+
+  // Plain BC1/BC3 use the legacy FourCC codes every reader knows, the rest needs the DX10 header
+  const char *fourCC = "DX10";
+  if (!srgb && format == BLOCK_BC1)
+    fourCC = "DXT1";
+  else if (!srgb && format == BLOCK_BC3)
+    fourCC = "DXT5";
+
+  const uint32_t DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PIXELFORMAT = 0x1000;
+  const uint32_t DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000;
+  const uint32_t DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+  const uint32_t DDPF_FOURCC = 0x4;
+
+  out.write("DDS ", 4);
+  write_u32(out, 124);
+  write_u32(out, DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE);
+  write_u32(out, height);
+  write_u32(out, width);
+  write_u32(out, levels.empty() ? 0 : (uint32_t)levels[0].size());
+  write_u32(out, 0); // depth
+  write_u32(out, (uint32_t)levels.size());
+  for (int i = 0; i < 11; i++)
+    write_u32(out, 0); // reserved
+
+  // DDS_PIXELFORMAT
+  write_u32(out, 32);
+  write_u32(out, DDPF_FOURCC);
+  out.write(fourCC, 4);
+  for (int i = 0; i < 5; i++)
+    write_u32(out, 0); // bit count and masks
+
+  write_u32(out, DDSCAPS_TEXTURE | (levels.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0));
+  for (int i = 0; i < 4; i++)
+    write_u32(out, 0); // caps2-4, reserved
+
+  if (strcmp(fourCC, "DX10") == 0)
+  {
+    uint32_t dxgiFormat = format == BLOCK_BC1 ? 71 : format == BLOCK_BC3 ? 77
+                                                                         : 98;
+    write_u32(out, dxgiFormat + (srgb ? 1 : 0));
+    write_u32(out, 3); // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+    write_u32(out, 0);
+    write_u32(out, 1); // array size
+    write_u32(out, 0);
+  }
+
+  for (const std::vector<unsigned char> &level : levels)
+    out.write((const char *)level.data(), (std::streamsize)level.size());
+
+  return (bool)out;
+}
@@ -0,0 +1,494 @@
+#include "TextureLoader.h"
+#include "RenderState.h"
+#include "DebugOutput.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stb_image.h>
+
+AsyncTexture::AsyncTexture(const char *image, GLenum texType, GLuint placeholder)
+    : ID(0), type(texType), image(image), state(DECODING), placeholder(placeholder),
+      bytes(nullptr), width(0), height(0), numColCh(0), uploadedRows(0), pack(nullptr), packEntry(nullptr), uploadedLevels(0)
+{
+}
+
+// True once every mip level is uploaded
+bool AsyncTexture::Ready() const
+{
+  return state.load(std::memory_order_acquire) == READY;
+}
+
+// Binds the texture, or the placeholder while it is still loading
+void AsyncTexture::Bind()
+{
+  RenderState::BindTexture(type, Ready() ? ID : placeholder);
+}
+
+// Unbinds a texture
+void AsyncTexture::Unbind()
+{
+  RenderState::BindTexture(type, 0);
+}
+
+// Deletes the texture
+void AsyncTexture::Delete()
+{
+  if (ID != 0)
+    RenderState::DeleteTexture(ID);
+  ID = 0;
+  if (bytes != nullptr)
+    stbi_image_free(bytes);
+  bytes = nullptr;
+  mips.clear();
+  compressed.reset();
+}
+
+// Constructor that creates the placeholder texture, images are decoded as background jobs of jobs.
+// Must be called on the GL thread, which has to be the one that created jobs
+TextureLoader::TextureLoader(JobSystem &jobs, GLsizeiptr uploadBudget)
+    : uploadBudget(uploadBudget), pixelBuffer(GL_PIXEL_UNPACK_BUFFER, uploadBudget), jobs(&jobs), pending(0),
+      decoding(0)
+{
+  // 2x2 grey checkerboard shown while textures load
+  const unsigned char checker[] = {
+      96, 96, 96, 255, 160, 160, 160, 255,
+      160, 160, 160, 255, 96, 96, 96, 255};
+  glGenTextures(1, &placeholder);
+  RenderState::BindTexture(GL_TEXTURE_2D, placeholder);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, checker);
+  RenderState::BindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Queues an image for decoding and returns its handle right away
+std::shared_ptr<AsyncTexture> TextureLoader::Load(const char *image, GLenum texType)
+{
+  std::shared_ptr<AsyncTexture> texture = std::make_shared<AsyncTexture>(image, texType, placeholder);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    decodeQueue.push_back(texture);
+    pending++;
+    decoding++;
+  }
+  // Jobs only carry the loader, the texture is whichever is next in the queue when one runs.
+  // Decoding takes far longer than a frame, so it stays off the frame's jobs
+  TextureLoader *loader = this;
+  jobs->RunBackground(jobs->Create(&TextureLoader::decodeJob, &loader, sizeof(loader)));
+  return texture;
+}
+
+// Queues a baked texture of a pack for upload, there is nothing to decode. The pack must outlive the upload
+std::shared_ptr<AsyncTexture> TextureLoader::Load(const TexturePack &pack, const char *name, GLenum texType)
+{
+  std::shared_ptr<AsyncTexture> texture = std::make_shared<AsyncTexture>(name, texType, placeholder);
+  texture->pack = &pack;
+  texture->packEntry = pack.Find(name);
+  if (texture->packEntry == nullptr)
+    std::cerr << "Error: Texture pack has no texture named " << name << std::endl;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    uploadQueue.push_back(texture);
+    pending++;
+  }
+  decodedSignal.notify_one();
+  return texture;
+}
+
+// Job that decodes the next image of the decode queue, data is the loader
+void TextureLoader::decodeJob(JobSystem &, Job *, const void *data)
+{
+  (*(TextureLoader *const *)data)->decodeNext();
+}
+
+// Decodes the next image of the decode queue, if there still is one
+void TextureLoader::decodeNext()
+{
+  std::shared_ptr<AsyncTexture> texture;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (decodeQueue.empty())
+    {
+      // Delete dropped the image this job was for
+      decoding--;
+      decodedSignal.notify_all();
+      return;
+    }
+    texture = decodeQueue.front();
+    decodeQueue.pop_front();
+  }
+
+  // Same orientation as Texture, set per thread so threads don't race on the global flag
+  stbi_set_flip_vertically_on_load_thread(true);
+  if (is_compressed_image(texture->image.c_str()))
+  {
+    // Block compressed data only needs to be read, the GL thread checks the format is supported
+    texture->compressed.reset(new CompressedImage());
+    if (!load_compressed_image(texture->image.c_str(), *texture->compressed))
+      texture->compressed.reset();
+  }
+  else
+    texture->bytes = stbi_load(texture->image.c_str(), &texture->width, &texture->height, &texture->numColCh, 0);
+
+  if (texture->compressed)
+    std::cout << "Loaded compressed image: " << texture->image << " (" << texture->compressed->width << "x"
+              << texture->compressed->height << ", " << texture->compressed->levels.size() << " levels)" << std::endl;
+  else if (texture->bytes == nullptr || texture->width <= 0 || texture->height <= 0 || texture->numColCh <= 0)
+    std::cerr << "Error: Failed to load texture: " << texture->image << std::endl;
+  else
+  {
+    std::cout << "Loaded image: " << texture->image << " (" << texture->width << "x" << texture->height
+              << ", " << texture->numColCh << " channels)" << std::endl;
+    // Build the mip chain here too, so the GL thread only copies finished levels
+    texture->mips = generate_mip_chain(texture->bytes, texture->width, texture->height, texture->numColCh,
+                                       MIP_FILTER_BOX, false, 1);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    uploadQueue.push_back(texture);
+    decoding--;
+  }
+  decodedSignal.notify_all();
+}
+
+// Runs a queued decoding job on the calling thread, or waits for one to finish when there are none
+void TextureLoader::helpDecode()
+{
+  // Only called by threads that wait for the images anyway, so taking a decode here stalls nothing
+  if (jobs->RunBackgroundOne())
+    return;
+  std::unique_lock<std::mutex> lock(mutex);
+  size_t before = decoding;
+  decodedSignal.wait(lock, [&]()
+                     { return decoding < before || decoding == 0; });
+}
+
+// Uploads decoded images within the per frame budget, call once per frame on the GL thread
+void TextureLoader::Update()
+{
+  GLsizeiptr budget = uploadBudget;
+  while (budget > 0)
+  {
+    std::shared_ptr<AsyncTexture> texture;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (uploadQueue.empty())
+        return;
+      texture = uploadQueue.front();
+    }
+
+    if (texture->compressed || (texture->packEntry != nullptr && texture->packEntry->format == 0))
+      budget -= uploadLevels(*texture, budget);
+    else if (texture->bytes == nullptr && texture->packEntry == nullptr)
+      texture->state.store(AsyncTexture::FAILED, std::memory_order_release);
+    else
+      budget -= uploadRows(*texture, budget);
+
+    int state = texture->state.load(std::memory_order_relaxed);
+    if (state == AsyncTexture::READY || state == AsyncTexture::FAILED)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      uploadQueue.pop_front();
+      pending--;
+    }
+    else
+    {
+      // Out of budget in the middle of a texture, continue next frame
+      return;
+    }
+  }
+}
+
+// Uploads as many rows of a texture and its mip levels as the remaining budget allows, returns the bytes used.
+// The levels come from the decoded image and its mip chain, or from an uncompressed texture of a pack
+GLsizeiptr TextureLoader::uploadRows(AsyncTexture &texture, GLsizeiptr budget)
+{
+  // Chunks smaller than this go straight from client memory, waiting on a PBO segment isn't worth it
+  const GLsizeiptr DIRECT_UPLOAD_SIZE = 64 * 1024;
+
+  const TexturePack::Entry *entry = texture.packEntry;
+  GLenum format, internalFormat, type;
+  size_t levelCount;
+  if (entry != nullptr)
+  {
+    format = entry->format;
+    internalFormat = entry->internalFormat;
+    type = entry->type;
+    levelCount = entry->levelCount;
+  }
+  else
+  {
+    format = texture.numColCh == 4 ? GL_RGBA : texture.numColCh == 3 ? GL_RGB
+                                           : texture.numColCh == 2   ? GL_RG
+                                                                     : GL_RED;
+    internalFormat = texture.numColCh == 4 ? GL_RGBA8 : texture.numColCh == 3 ? GL_RGB8
+                                                    : texture.numColCh == 2   ? GL_RG8
+                                                                              : GL_R8;
+    type = GL_UNSIGNED_BYTE;
+    levelCount = texture.mips.size() + 1;
+  }
+
+  // Size and tightly packed pixels of a level
+  auto levelData = [&](size_t level, int &width, int &height, const unsigned char *&pixels, GLsizeiptr &rowSize)
+  {
+    if (entry != nullptr)
+    {
+      const TexturePack::Level &mip = entry->levels[level];
+      width = (int)mip.width;
+      height = (int)mip.height;
+      pixels = texture.pack->data + mip.offset;
+      rowSize = (GLsizeiptr)TexturePack::LevelSize(*entry, mip.width, 1);
+    }
+    else
+    {
+      width = level == 0 ? texture.width : texture.mips[level - 1].width;
+      height = level == 0 ? texture.height : texture.mips[level - 1].height;
+      pixels = level == 0 ? texture.bytes : texture.mips[level - 1].pixels.data();
+      rowSize = (GLsizeiptr)width * texture.numColCh;
+    }
+  };
+
+  if (texture.state.load(std::memory_order_relaxed) == AsyncTexture::DECODING)
+  {
+    // Allocate every level once, rows are filled in over the next frames
+    glGenTextures(1, &texture.ID);
+    RenderState::BindTexture(texture.type, texture.ID);
+    DebugOutput::Label(GL_TEXTURE, texture.ID, texture.image);
+    glTexParameteri(texture.type, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+    glTexParameteri(texture.type, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(texture.type, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(texture.type, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(texture.type, GL_TEXTURE_MAX_LEVEL, (GLint)levelCount - 1);
+    for (size_t level = 0; level < levelCount; level++)
+    {
+      int width, height;
+      const unsigned char *pixels;
+      GLsizeiptr rowSize;
+      levelData(level, width, height, pixels, rowSize);
+      glTexImage2D(texture.type, (GLint)level, (GLint)internalFormat, width, height, 0, format, type, nullptr);
+    }
+    texture.state.store(AsyncTexture::UPLOADING, std::memory_order_relaxed);
+  }
+
+  GLsizeiptr used = 0;
+  RenderState::BindTexture(texture.type, texture.ID);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  while (texture.uploadedLevels < levelCount)
+  {
+    size_t level = texture.uploadedLevels;
+    int width, height;
+    const unsigned char *pixels;
+    GLsizeiptr rowSize;
+    levelData(level, width, height, pixels, rowSize);
+
+    // At least one row per call so we always progress
+    if (used > 0 && budget - used < rowSize)
+      break;
+    int rows = (int)std::min<GLsizeiptr>(height - texture.uploadedRows, std::max<GLsizeiptr>((budget - used) / rowSize, 1));
+    if ((GLsizeiptr)rows * rowSize > pixelBuffer.segmentSize)
+      rows = (int)std::max<GLsizeiptr>(pixelBuffer.segmentSize / rowSize, 1);
+    GLsizeiptr bytes = (GLsizeiptr)rows * rowSize;
+    const unsigned char *source = pixels + (size_t)texture.uploadedRows * rowSize;
+
+    if (bytes >= DIRECT_UPLOAD_SIZE && bytes <= pixelBuffer.segmentSize)
+    {
+      // Stage the rows in the PBO so the driver copies them asynchronously
+      void *staging = pixelBuffer.Map();
+      memcpy(staging, source, bytes);
+      pixelBuffer.Unmap();
+
+      pixelBuffer.Bind();
+      glTexSubImage2D(texture.type, (GLint)level, 0, texture.uploadedRows, width, rows, format, type,
+                      (void *)pixelBuffer.offset);
+      pixelBuffer.Fence();
+      pixelBuffer.Unbind();
+    }
+    else
+    {
+      // Small chunks, or a single row larger than the PBO, go straight from client memory
+      glTexSubImage2D(texture.type, (GLint)level, 0, texture.uploadedRows, width, rows, format, type, source);
+    }
+
+    used += bytes;
+    texture.uploadedRows += rows;
+    if (texture.uploadedRows >= height)
+    {
+      texture.uploadedLevels++;
+      texture.uploadedRows = 0;
+    }
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  if (texture.uploadedLevels == levelCount)
+  {
+    stbi_image_free(texture.bytes);
+    texture.bytes = nullptr;
+    texture.mips.clear();
+    texture.packEntry = nullptr;
+    texture.state.store(AsyncTexture::READY, std::memory_order_release);
+  }
+  RenderState::BindTexture(texture.type, 0);
+
+  return used;
+}
+
+// Uploads as many block rows of a compressed texture and its mip levels as the remaining budget allows, returns
+// the bytes used. Compressed levels are final and compact, so they go straight from client (or mapped) memory
+// without the PBO
+GLsizeiptr TextureLoader::uploadLevels(AsyncTexture &texture, GLsizeiptr budget)
+{
+  // Rows of pixels in a row of blocks
+  const int BLOCK_SIZE = 4;
+
+  const CompressedImage *image = texture.compressed.get();
+  const TexturePack::Entry *entry = texture.packEntry;
+  GLenum compressedFormat = image != nullptr ? image->format : entry->internalFormat;
+  size_t levelCount = image != nullptr ? image->levels.size() : entry->levelCount;
+
+  // Size and blocks of a level
+  auto levelData = [&](size_t level, int &width, int &height, const unsigned char *&blocks, GLsizeiptr &size)
+  {
+    if (image != nullptr)
+    {
+      const CompressedImage::Level &mip = image->levels[level];
+      width = mip.width;
+      height = mip.height;
+      blocks = image->data.data() + mip.offset;
+      size = (GLsizeiptr)mip.size;
+    }
+    else
+    {
+      const TexturePack::Level &mip = entry->levels[level];
+      width = (int)mip.width;
+      height = (int)mip.height;
+      blocks = texture.pack->data + mip.offset;
+      size = (GLsizeiptr)mip.size;
+    }
+  };
+
+  if (texture.state.load(std::memory_order_relaxed) == AsyncTexture::DECODING)
+  {
+    if (!compressed_format_supported(compressedFormat))
+    {
+      std::cerr << "Error: Compressed format 0x" << std::hex << compressedFormat << std::dec
+                << " of " << texture.image << " is not supported by this driver" << std::endl;
+      texture.compressed.reset();
+      texture.packEntry = nullptr;
+      texture.state.store(AsyncTexture::FAILED, std::memory_order_release);
+      return 0;
+    }
+
+    // Allocate every level once, block rows are filled in over the next frames
+    glGenTextures(1, &texture.ID);
+    RenderState::BindTexture(texture.type, texture.ID);
+    DebugOutput::Label(GL_TEXTURE, texture.ID, texture.image);
+    glTexParameteri(texture.type, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+    glTexParameteri(texture.type, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(texture.type, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(texture.type, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(texture.type, GL_TEXTURE_MAX_LEVEL, (GLint)levelCount - 1);
+    for (size_t level = 0; level < levelCount; level++)
+    {
+      int width, height;
+      const unsigned char *blocks;
+      GLsizeiptr size;
+      levelData(level, width, height, blocks, size);
+      glCompressedTexImage2D(texture.type, (GLint)level, compressedFormat, width, height, 0, (GLsizei)size, nullptr);
+    }
+    texture.state.store(AsyncTexture::UPLOADING, std::memory_order_relaxed);
+  }
+
+  GLsizeiptr used = 0;
+  RenderState::BindTexture(texture.type, texture.ID);
+  while (texture.uploadedLevels < levelCount)
+  {
+    size_t level = texture.uploadedLevels;
+    int width, height;
+    const unsigned char *blocks;
+    GLsizeiptr size;
+    levelData(level, width, height, blocks, size);
+    int blockRows = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    GLsizeiptr blockRowSize = size / blockRows;
+
+    // At least one row of blocks per call so we always progress
+    if (used > 0 && budget - used < blockRowSize)
+      break;
+    int firstBlockRow = texture.uploadedRows / BLOCK_SIZE;
+    int rows = (int)std::min<GLsizeiptr>(blockRows - firstBlockRow, std::max<GLsizeiptr>((budget - used) / blockRowSize, 1));
+    GLsizeiptr bytes = (GLsizeiptr)rows * blockRowSize;
+    // The last band may end on a partial block at the bottom edge
+    int bandHeight = std::min(rows * BLOCK_SIZE, height - texture.uploadedRows);
+    glCompressedTexSubImage2D(texture.type, (GLint)level, 0, texture.uploadedRows, width, bandHeight, compressedFormat,
+                              (GLsizei)bytes, blocks + (size_t)firstBlockRow * blockRowSize);
+
+    used += bytes;
+    texture.uploadedRows += bandHeight;
+    if (texture.uploadedRows >= height)
+    {
+      texture.uploadedLevels++;
+      texture.uploadedRows = 0;
+    }
+  }
+
+  if (texture.uploadedLevels == levelCount)
+  {
+    texture.compressed.reset();
+    texture.packEntry = nullptr;
+    texture.state.store(AsyncTexture::READY, std::memory_order_release);
+  }
+  RenderState::BindTexture(texture.type, 0);
+
+  return used;
+}
+
+// Number of textures that are not ready (or failed) yet
+size_t TextureLoader::Pending()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return pending;
+}
+
+// Keeps updating until every queued texture is ready, for runs that need a deterministic scene
+void TextureLoader::WaitAll()
+{
+  while (Pending() > 0)
+  {
+    helpDecode();
+    Update();
+  }
+}
+
+// Waits for the decoding jobs that already started and deletes the placeholder
+void TextureLoader::Delete()
+{
+  // Jobs that didn't start yet find the queue empty and return right away
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    decodeQueue.clear();
+  }
+  while (true)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (decoding == 0)
+        break;
+    }
+    helpDecode();
+  }
+
+  // Free images that were decoded but never uploaded
+  for (std::shared_ptr<AsyncTexture> &texture : uploadQueue)
+  {
+    if (texture->bytes != nullptr)
+      stbi_image_free(texture->bytes);
+    texture->bytes = nullptr;
+    texture->compressed.reset();
+  }
+  uploadQueue.clear();
+  decodeQueue.clear();
+
+  pixelBuffer.Delete();
+  RenderState::DeleteTexture(placeholder);
+}
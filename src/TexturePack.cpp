@@ -0,0 +1,155 @@
+#include "TexturePack.h"
+#include "CompressedImage.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(TexturePack::Header) == 16, "TexturePack::Header layout is part of the file format");
+static_assert(sizeof(TexturePack::Entry) == 64 + 16 + TexturePack::MAX_LEVELS * 24, "TexturePack::Entry layout is part of the file format");
+
+// Constructor that memory maps a pack, exits if it is missing or malformed
+TexturePack::TexturePack(const char *filename)
+    : data(nullptr), size(0)
+{
+#ifdef _WIN32
+  // No mmap, read the whole pack instead
+  std::ifstream in(filename, std::ios::binary | std::ios::ate);
+  if (in)
+  {
+    size = (size_t)in.tellg();
+    unsigned char *buffer = new unsigned char[size];
+    in.seekg(0);
+    in.read((char *)buffer, (std::streamsize)size);
+    data = buffer;
+  }
+#else
+  int file = open(filename, O_RDONLY);
+  struct stat info;
+  if (file >= 0 && fstat(file, &info) == 0 && info.st_size > 0)
+  {
+    size = (size_t)info.st_size;
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    if (mapping != MAP_FAILED)
+      data = (const unsigned char *)mapping;
+  }
+  if (file >= 0)
+    close(file);
+#endif
+
+  if (data == nullptr)
+  {
+    std::cerr << "Error: Failed to map texture pack " << filename << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  // Validate everything up front so lookups and uploads can trust the tables
+  if (size < sizeof(Header) || memcmp(header()->magic, "TPAK", 4) != 0 || header()->version != VERSION ||
+      size < sizeof(Header) + (size_t)header()->textureCount * sizeof(Entry))
+  {
+    std::cerr << "Error: " << filename << " is not a version " << VERSION << " texture pack" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  for (uint32_t i = 0; i < header()->textureCount; i++)
+  {
+    const Entry &entry = entries()[i];
+    if (entry.levelCount == 0 || entry.levelCount > MAX_LEVELS)
+    {
+      std::cerr << "Error: " << filename << " has an invalid level count" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    for (uint32_t level = 0; level < entry.levelCount; level++)
+    {
+      const Level &mip = entry.levels[level];
+      if (mip.width == 0 || mip.height == 0 || mip.width > INT32_MAX || mip.height > INT32_MAX ||
+          LevelSize(entry, mip.width, mip.height) == 0 || mip.size < LevelSize(entry, mip.width, mip.height))
+      {
+        std::cerr << "Error: " << filename << " has an invalid level " << level << " of " << entry.name << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      if (mip.offset > size || mip.size > size - mip.offset)
+      {
+        std::cerr << "Error: " << filename << " is truncated" << std::endl;
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+}
+
+const TexturePack::Header *TexturePack::header() const
+{
+  return (const Header *)data;
+}
+
+const TexturePack::Entry *TexturePack::entries() const
+{
+  return (const Entry *)(data + sizeof(Header));
+}
+
+// Returns the entry of a texture, nullptr if the pack doesn't contain it
+const TexturePack::Entry *TexturePack::Find(const char *name) const
+{
+  for (uint32_t i = 0; i < header()->textureCount; i++)
+  {
+    if (strncmp(entries()[i].name, name, NAME_LENGTH) == 0)
+      return &entries()[i];
+  }
+  return nullptr;
+}
+
+// Uploads one mip level of an entry into the texture bound to target
+void TexturePack::UploadLevel(const Entry &entry, GLenum target, uint32_t level) const
+{
+  const Level &mip = entry.levels[level];
+  const unsigned char *pixels = data + mip.offset;
+
+  if (entry.format == 0)
+  {
+    glCompressedTexImage2D(target, (GLint)level, entry.internalFormat, (GLsizei)mip.width, (GLsizei)mip.height, 0,
+                           (GLsizei)mip.size, pixels);
+  }
+  else
+  {
+    // RGB rows are tightly packed
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(target, (GLint)level, (GLint)entry.internalFormat, (GLsizei)mip.width, (GLsizei)mip.height, 0,
+                 entry.format, entry.type, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  }
+}
+
+// Bytes a level of width x height needs in the entry's format, 0 for formats a pack can't hold
+uint64_t TexturePack::LevelSize(const Entry &entry, uint32_t width, uint32_t height)
+{
+  if (entry.format == 0)
+    return compressed_level_size(entry.internalFormat, (GLsizei)width, (GLsizei)height);
+  if (entry.type != GL_UNSIGNED_BYTE)
+    return 0;
+  uint64_t channels = entry.format == GL_RGBA ? 4 : entry.format == GL_RGB ? 3
+                                                : entry.format == GL_RG    ? 2
+                                                : entry.format == GL_RED   ? 1
+                                                                           : 0;
+  return (uint64_t)width * height * channels;
+}
+
+// Unmaps the pack
+void TexturePack::Delete()
+{
+  if (data == nullptr)
+    return;
+#ifdef _WIN32
+  delete[] data;
+#else
+  munmap((void *)data, size);
+#endif
+  data = nullptr;
+  size = 0;
+}
@@ -0,0 +1,211 @@
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TRANSFORM_SIMD_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TRANSFORM_SIMD_NEON
+#endif
+
+// Constructor that makes an empty hierarchy
+TransformHierarchy::TransformHierarchy()
+    : levels(1, 0), sorted(true)
+{
+}
+
+// Adds a node below parent (a handle, or TRANSFORM_ROOT) and returns its handle
+uint32_t TransformHierarchy::Add(uint32_t parent, const glm::vec3 &position, const glm::quat &rotation,
+                                 const glm::vec3 &scale)
+{
+  uint32_t handle = (uint32_t)slots.size();
+  uint32_t slot = (uint32_t)parents.size();
+  uint32_t parentSlot = parent == TRANSFORM_ROOT ? TRANSFORM_ROOT : slots[parent];
+  uint32_t depth = parent == TRANSFORM_ROOT ? 0 : depths[parentSlot] + 1;
+
+  // Appending keeps the order as long as nodes arrive level by level, and by parent within a level
+  bool inOrder = depths.empty() || depth > depths.back() ||
+                 (depth == depths.back() && (parentSlot == TRANSFORM_ROOT || parentSlot >= parents.back()));
+  if (sorted && inOrder)
+  {
+    if (depth == levels.size() - 1)
+      levels.push_back(levels.back() + 1);
+    else
+      levels.back()++;
+  }
+  else
+    sorted = false;
+
+  positions.push_back(position);
+  rotations.push_back(rotation);
+  scales.push_back(scale);
+  worlds.push_back(glm::mat4(1.0f));
+  parents.push_back(parentSlot);
+  depths.push_back(depth);
+  dirty.push_back(1);
+  handles.push_back(handle);
+  slots.push_back(slot);
+  return handle;
+}
+
+// Replaces a node's local transform
+void TransformHierarchy::SetLocal(uint32_t node, const glm::vec3 &position, const glm::quat &rotation,
+                                  const glm::vec3 &scale)
+{
+  uint32_t slot = slots[node];
+  positions[slot] = position;
+  rotations[slot] = rotation;
+  scales[slot] = scale;
+  dirty[slot] = 1;
+}
+
+// Replaces only the rotation of a node
+void TransformHierarchy::SetRotation(uint32_t node, const glm::quat &rotation)
+{
+  uint32_t slot = slots[node];
+  rotations[slot] = rotation;
+  dirty[slot] = 1;
+}
+
+// Reorders every array by depth, and within a depth by parent
+void TransformHierarchy::sort()
+{
+  // Counting sort by depth: the levels are the prefix sums of the number of nodes at each depth
+  uint32_t maxDepth = *std::max_element(depths.begin(), depths.end());
+  levels.assign(maxDepth + 2, 0);
+  for (uint32_t depth : depths)
+    levels[depth + 1]++;
+  for (uint32_t depth = 1; depth < levels.size(); depth++)
+    levels[depth] += levels[depth - 1];
+
+  std::vector<uint32_t> order(depths.size());
+  std::vector<uint32_t> next(levels.begin(), levels.end() - 1);
+  for (uint32_t slot = 0; slot < depths.size(); slot++)
+    order[next[depths[slot]]++] = slot;
+
+  // Then level by level by the new slot of the parent, which the level above already has, so
+  // Update reads the parents' world matrices front to back instead of all over the level above
+  std::vector<uint32_t> moved(depths.size());
+  for (size_t level = 0; level + 1 < levels.size(); level++)
+  {
+    uint32_t *first = order.data() + levels[level];
+    uint32_t *last = order.data() + levels[level + 1];
+    if (level > 0)
+      std::stable_sort(first, last, [&](uint32_t a, uint32_t b)
+                       { return moved[parents[a]] < moved[parents[b]]; });
+    for (uint32_t *slot = first; slot < last; slot++)
+      moved[*slot] = (uint32_t)(slot - order.data());
+  }
+
+  // Parents are remapped as they move, their new slot is known before any child is placed
+  std::vector<glm::vec3> sortedPositions(positions.size()), sortedScales(scales.size());
+  std::vector<glm::quat> sortedRotations(rotations.size());
+  std::vector<glm::mat4> sortedWorlds(worlds.size());
+  std::vector<uint32_t> sortedParents(parents.size()), sortedDepths(depths.size()), sortedHandles(handles.size());
+  std::vector<uint8_t> sortedDirty(dirty.size());
+  for (size_t slot = 0; slot < depths.size(); slot++)
+  {
+    uint32_t to = moved[slot];
+    sortedPositions[to] = positions[slot];
+    sortedRotations[to] = rotations[slot];
+    sortedScales[to] = scales[slot];
+    sortedWorlds[to] = worlds[slot];
+    sortedParents[to] = parents[slot] == TRANSFORM_ROOT ? TRANSFORM_ROOT : moved[parents[slot]];
+    sortedDepths[to] = depths[slot];
+    sortedHandles[to] = handles[slot];
+    sortedDirty[to] = dirty[slot];
+    slots[handles[slot]] = to;
+  }
+  positions.swap(sortedPositions);
+  rotations.swap(sortedRotations);
+  scales.swap(sortedScales);
+  worlds.swap(sortedWorlds);
+  parents.swap(sortedParents);
+  depths.swap(sortedDepths);
+  handles.swap(sortedHandles);
+  dirty.swap(sortedDirty);
+  sorted = true;
+}
+
+// World matrix from a local position, rotation and scale, times the parent's world matrix
+// when there is one. Both are affine, the last row is never multiplied
+static void compose(const glm::mat4 *parent, const glm::vec3 &position, const glm::quat &rotation,
+                    const glm::vec3 &scale, glm::mat4 &world)
+{
+  float x = rotation.x, y = rotation.y, z = rotation.z, w = rotation.w;
+  float local[4][4] = {
+      {(1.0f - 2.0f * (y * y + z * z)) * scale.x, 2.0f * (x * y + w * z) * scale.x, 2.0f * (x * z - w * y) * scale.x, 0.0f},
+      {2.0f * (x * y - w * z) * scale.y, (1.0f - 2.0f * (x * x + z * z)) * scale.y, 2.0f * (y * z + w * x) * scale.y, 0.0f},
+      {2.0f * (x * z + w * y) * scale.z, 2.0f * (y * z - w * x) * scale.z, (1.0f - 2.0f * (x * x + y * y)) * scale.z, 0.0f},
+      {position.x, position.y, position.z, 1.0f}};
+  float *out = &world[0][0];
+  if (parent == nullptr)
+  {
+    memcpy(out, local, sizeof(local));
+    return;
+  }
+
+  // Column j of the result is the parent's columns weighted by column j of the local matrix
+  const float *m = &(*parent)[0][0];
+#if defined(TRANSFORM_SIMD_SSE2)
+  __m128 c0 = _mm_loadu_ps(m), c1 = _mm_loadu_ps(m + 4), c2 = _mm_loadu_ps(m + 8), c3 = _mm_loadu_ps(m + 12);
+  for (int j = 0; j < 4; j++)
+  {
+    __m128 column = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(local[j][0])), _mm_mul_ps(c1, _mm_set1_ps(local[j][1])));
+    column = _mm_add_ps(column, _mm_mul_ps(c2, _mm_set1_ps(local[j][2])));
+    if (j == 3)
+      column = _mm_add_ps(column, c3);
+    _mm_storeu_ps(out + 4 * j, column);
+  }
+#elif defined(TRANSFORM_SIMD_NEON)
+  float32x4_t c0 = vld1q_f32(m), c1 = vld1q_f32(m + 4), c2 = vld1q_f32(m + 8), c3 = vld1q_f32(m + 12);
+  for (int j = 0; j < 4; j++)
+  {
+    float32x4_t column = vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(c0, local[j][0]), c1, local[j][1]), c2, local[j][2]);
+    if (j == 3)
+      column = vaddq_f32(column, c3);
+    vst1q_f32(out + 4 * j, column);
+  }
+#else
+  for (int j = 0; j < 4; j++)
+    for (int i = 0; i < 4; i++)
+      out[4 * j + i] = m[i] * local[j][0] + m[4 + i] * local[j][1] + m[8 + i] * local[j][2] + (j == 3 ? m[12 + i] : 0.0f);
+#endif
+}
+
+// Recomputes the dirty nodes among slots first..first + count - 1
+void TransformHierarchy::updateRange(uint32_t first, uint32_t count)
+{
+  for (uint32_t slot = first; slot < first + count; slot++)
+  {
+    // A node is recomputed when it changed or its parent was, which flags it for its own children
+    uint32_t parent = parents[slot];
+    if (!dirty[slot] && (parent == TRANSFORM_ROOT || !dirty[parent]))
+      continue;
+    dirty[slot] = 1;
+    compose(parent == TRANSFORM_ROOT ? nullptr : &worlds[parent], positions[slot], rotations[slot], scales[slot],
+            worlds[slot]);
+  }
+}
+
+// Recomputes the world matrices of dirty nodes and their descendants
+void TransformHierarchy::Update(JobSystem *jobs)
+{
+  if (!sorted)
+    sort();
+
+  // Each level only reads the one above it, so a level's jobs all finish before the next starts
+  for (size_t level = 0; level + 1 < levels.size(); level++)
+  {
+    uint32_t first = levels[level];
+    uint32_t count = levels[level + 1] - first;
+    if (jobs == nullptr || count <= TRANSFORM_JOB_NODES)
+      updateRange(first, count);
+    else
+      jobs->ParallelFor(count, TRANSFORM_JOB_NODES, [&](uint32_t begin, uint32_t size)
+                        { updateRange(first + begin, size); });
+  }
+  std::fill(dirty.begin(), dirty.end(), 0);
+}
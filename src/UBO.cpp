@@ -0,0 +1,39 @@
+#include "UBO.h"
+#include "RenderState.h"
+
+// Constructor that generates a Uniform Buffer Object of a given size and attaches it to a binding point
+UBO::UBO(GLsizeiptr size, GLuint binding)
+    : binding(binding), size(size)
+{
+  glGenBuffers(1, &ID);
+  RenderState::BindBuffer(GL_UNIFORM_BUFFER, ID);
+  glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+  RenderState::BindBufferBase(GL_UNIFORM_BUFFER, binding, ID);
+  RenderState::BindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// Overwrites the contents of the UBO starting at offset
+void UBO::Update(const void *data, GLsizeiptr dataSize, GLintptr offset)
+{
+  RenderState::BindBuffer(GL_UNIFORM_BUFFER, ID);
+  glBufferSubData(GL_UNIFORM_BUFFER, offset, dataSize, data);
+  RenderState::BindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// Binds the UBO
+void UBO::Bind()
+{
+  RenderState::BindBuffer(GL_UNIFORM_BUFFER, ID);
+}
+
+// Unbinds the UBO
+void UBO::Unbind()
+{
+  RenderState::BindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+// Deletes the UBO
+void UBO::Delete()
+{
+  RenderState::DeleteBuffer(ID);
+}
@@ -1,4 +1,6 @@
 #include "VAO.h"
+#include "RenderState.h"
+#include "DebugOutput.h"
 
 // Constructor that generates a VAO ID
 VAO::VAO()
@@ -7,28 +9,74 @@ VAO::VAO()
 }
 
 // Links a VBO to the VAO using a certain layout
-void VAO::LinkAttrib(VBO &VBO, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, void *offset)
+void VAO::LinkAttrib(VBO &VBO, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, void *offset,
+                     GLuint divisor)
 {
   VBO.Bind();
   glVertexAttribPointer(layout, numComponents, type, GL_FALSE, stride, offset);
+  glVertexAttribDivisor(layout, divisor);
   glEnableVertexAttribArray(layout);
   VBO.Unbind();
 }
 
+// Links a StreamingBuffer to the VAO, draws pick the current segment with a base vertex
+void VAO::LinkAttrib(StreamingBuffer &buffer, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride,
+                     void *offset, GLuint divisor)
+{
+  buffer.Bind();
+  glVertexAttribPointer(layout, numComponents, type, GL_FALSE, stride, offset);
+  glVertexAttribDivisor(layout, divisor);
+  glEnableVertexAttribArray(layout);
+  buffer.Unbind();
+}
+
+// Links every attribute of an interleaved VBO laid out as format, with its type and normalization
+void VAO::LinkFormat(VBO &VBO, const VertexFormat &format, GLuint divisor)
+{
+  VBO.Bind();
+  for (const VertexFormat::Attribute &attribute : format.attributes)
+  {
+    glVertexAttribPointer(attribute.location, attribute.components, attribute.type, attribute.normalized,
+                          format.stride, (void *)(size_t)attribute.offset);
+    glVertexAttribDivisor(attribute.location, divisor);
+    glEnableVertexAttribArray(attribute.location);
+  }
+  VBO.Unbind();
+}
+
+// Links a mat4 attribute, which takes the four locations layout to layout + 3, one per column
+void VAO::LinkMat4Attrib(VBO &VBO, GLuint layout, GLsizeiptr stride, void *offset, GLuint divisor)
+{
+  for (GLuint column = 0; column < 4; column++)
+    LinkAttrib(VBO, layout + column, 4, GL_FLOAT, stride, (char *)offset + column * 4 * sizeof(GLfloat), divisor);
+}
+
+void VAO::LinkMat4Attrib(StreamingBuffer &buffer, GLuint layout, GLsizeiptr stride, void *offset, GLuint divisor)
+{
+  for (GLuint column = 0; column < 4; column++)
+    LinkAttrib(buffer, layout + column, 4, GL_FLOAT, stride, (char *)offset + column * 4 * sizeof(GLfloat), divisor);
+}
+
+// Names the VAO for debug messages and capture tools
+void VAO::Label(const char *name)
+{
+  DebugOutput::Label(GL_VERTEX_ARRAY, ID, name);
+}
+
 // Binds the VAO
 void VAO::Bind()
 {
-  glBindVertexArray(ID);
+  RenderState::BindVertexArray(ID);
 }
 
 // Unbinds the VAO
 void VAO::Unbind()
 {
-  glBindVertexArray(0);
+  RenderState::BindVertexArray(0);
 }
 
 // Deletes the VAO
 void VAO::Delete()
 {
-  glDeleteVertexArrays(1, &ID);
+  RenderState::DeleteVertexArray(ID);
 }
\ No newline at end of file
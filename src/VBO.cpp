@@ -1,27 +1,28 @@
 #include "VBO.h"
+#include "RenderState.h"
 
 // Constructor that generates a Vertex Buffer Object and links it to vertices
 VBO::VBO(GLfloat *vertices, GLsizeiptr size)
 {
   glGenBuffers(1, &ID);
-  glBindBuffer(GL_ARRAY_BUFFER, ID);
+  RenderState::BindBuffer(GL_ARRAY_BUFFER, ID);
   glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_STATIC_DRAW);
 }
 
 // Binds the VBO
 void VBO::Bind()
 {
-  glBindBuffer(GL_ARRAY_BUFFER, ID);
+  RenderState::BindBuffer(GL_ARRAY_BUFFER, ID);
 }
 
 // Unbinds the VBO
 void VBO::Unbind()
 {
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  RenderState::BindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 // Deletes the VBO
 void VBO::Delete()
 {
-  glDeleteBuffers(1, &ID);
+  RenderState::DeleteBuffer(ID);
 }
\ No newline at end of file
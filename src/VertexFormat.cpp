@@ -0,0 +1,46 @@
+#include "VertexFormat.h"
+#include <cstdlib>
+#include <iostream>
+
+// Bytes an attribute of the given type and component count takes, before alignment
+GLuint vertex_attribute_size(GLint components, GLenum type)
+{
+  switch (type)
+  {
+  case GL_FLOAT:
+    return components * 4;
+  case GL_HALF_FLOAT:
+  case GL_UNSIGNED_SHORT:
+    return components * 2;
+  case GL_UNSIGNED_BYTE:
+    return components;
+  case GL_INT_2_10_10_10_REV:
+    return 4;
+  default:
+    return 0;
+  }
+}
+
+// Constructor of an empty format
+VertexFormat::VertexFormat()
+{
+  stride = 0;
+}
+
+// Appends an attribute after the previous ones
+VertexFormat &VertexFormat::Add(GLuint location, GLint components, GLenum type, GLboolean normalized)
+{
+  GLuint size = vertex_attribute_size(components, type);
+  if (size == 0 || components < 1 || components > 4 || (type == GL_INT_2_10_10_10_REV && components != 4))
+  {
+    std::cerr << "Error: Unsupported vertex attribute at location " << location << ": " << components
+              << " components of type 0x" << std::hex << type << std::dec << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  Attribute attribute = {location, components, type, normalized, (GLuint)stride};
+  attributes.push_back(attribute);
+  // Attributes that straddle 4 byte boundaries are slow to fetch or not fetched at all on some GPUs
+  stride += (GLsizei)((size + 3) & ~3u);
+  return *this;
+}
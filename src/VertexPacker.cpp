@@ -0,0 +1,288 @@
+#include "VertexPacker.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#define VERTEX_SIMD_F16C
+#define VERTEX_SIMD_SSE2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VERTEX_SIMD_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VERTEX_SIMD_NEON
+#endif
+
+// Name of the SIMD code path compiled in: "F16C", "SSE2", "NEON" or "scalar"
+const char *vertex_simd_path()
+{
+#if defined(VERTEX_SIMD_F16C)
+  return "F16C";
+#elif defined(VERTEX_SIMD_SSE2)
+  return "SSE2";
+#elif defined(VERTEX_SIMD_NEON)
+  return "NEON";
+#else
+  return "scalar";
+#endif
+}
+
+// Nearest half float of a float, overflowing to infinity, the scalar conversion the SIMD paths match
+uint16_t float_to_half(float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint32_t sign = (bits >> 16) & 0x8000;
+  uint32_t magnitude = bits & 0x7FFFFFFF;
+
+  // Infinity and NaN. NaNs become quiet and keep the top of their payload, as F16C and NEON do
+  if (magnitude >= 0x7F800000)
+    return (uint16_t)(sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 | ((magnitude >> 13) & 0x3FF) : 0));
+  // 65520 and up round to infinity
+  if (magnitude >= 0x477FF000)
+    return (uint16_t)(sign | 0x7C00);
+
+  // Below 2^-14 the result is subnormal. Adding 0.5 lines the half's mantissa up with the
+  // float's, so the FPU does the rounding
+  if (magnitude < 0x38800000)
+  {
+    float shifted;
+    memcpy(&shifted, &magnitude, sizeof(shifted));
+    shifted += 0.5f;
+    uint32_t rounded;
+    memcpy(&rounded, &shifted, sizeof(rounded));
+    return (uint16_t)(sign | (rounded - 0x3F000000));
+  }
+
+  // Rebias the exponent from 127 to 15 and round the 13 dropped mantissa bits to nearest even
+  uint32_t odd = (magnitude >> 13) & 1;
+  magnitude += 0xC8000FFF + odd;
+  return (uint16_t)(sign | (magnitude >> 13));
+}
+
+#if defined(VERTEX_SIMD_SSE2) && !defined(VERTEX_SIMD_F16C)
+// Four floats to half floats in the low 16 bits of each lane, the same steps as float_to_half.
+// Negative results keep their upper bits set, which _mm_packs_epi32 turns back into the 16 bit pattern
+static __m128i float_to_half_sse2(__m128 value)
+{
+  const __m128 signMask = _mm_set1_ps(-0.0f);
+  const __m128i halfMax = _mm_set1_epi32((127 + 16) << 23);
+  const __m128i minNormal = _mm_set1_epi32((127 - 14) << 23);
+  const __m128i subnormalMagic = _mm_set1_epi32(126 << 23);
+  const __m128i normalBias = _mm_set1_epi32(0xFFF - ((127 - 15) << 23));
+
+  __m128 sign = _mm_and_ps(value, signMask);
+  __m128 magnitude = _mm_xor_ps(value, sign);
+  __m128i bits = _mm_castps_si128(magnitude);
+
+  // Infinity for overflows, a quiet NaN keeping the top of its payload for NaNs
+  __m128i isNaN = _mm_castps_si128(_mm_cmpunord_ps(magnitude, magnitude));
+  __m128i payload = _mm_or_si128(_mm_set1_epi32(0x200), _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(0x3FF)));
+  __m128i special = _mm_or_si128(_mm_and_si128(isNaN, payload), _mm_set1_epi32(0x7C00));
+  __m128i isRegular = _mm_cmpgt_epi32(halfMax, bits);
+
+  // Subnormal results, rounded by the float add
+  __m128i isSubnormal = _mm_cmpgt_epi32(minNormal, bits);
+  __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(magnitude, _mm_castsi128_ps(subnormalMagic))), subnormalMagic);
+
+  // Normal results, rebiased and rounded to nearest even
+  __m128i odd = _mm_srai_epi32(_mm_slli_epi32(bits, 31 - 13), 31);
+  __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(bits, normalBias), odd), 13);
+
+  __m128i finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+  __m128i result = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, special));
+  return _mm_or_si128(result, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+}
+#endif
+
+// Converts 4 floats to half floats
+static void pack_half4(const float *in, uint16_t *out)
+{
+#if defined(VERTEX_SIMD_F16C)
+  _mm_storel_epi64((__m128i *)out, _mm_cvtps_ph(_mm_loadu_ps(in), _MM_FROUND_TO_NEAREST_INT));
+#elif defined(VERTEX_SIMD_SSE2)
+  __m128i halves = float_to_half_sse2(_mm_loadu_ps(in));
+  _mm_storel_epi64((__m128i *)out, _mm_packs_epi32(halves, halves));
+#elif defined(VERTEX_SIMD_NEON)
+  vst1_u16(out, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(in))));
+#else
+  for (int i = 0; i < 4; i++)
+    out[i] = float_to_half(in[i]);
+#endif
+}
+
+// Converts 4 floats in [0, 1] to unorm8
+static void pack_unorm8x4(const float *in, unsigned char *out)
+{
+#if defined(VERTEX_SIMD_SSE2)
+  __m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+  __m128i ints = _mm_cvtps_epi32(_mm_mul_ps(clamped, _mm_set1_ps(255.0f)));
+  __m128i words = _mm_packs_epi32(ints, ints);
+  int packed = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+  memcpy(out, &packed, 4);
+#elif defined(VERTEX_SIMD_NEON)
+  float32x4_t clamped = vminq_f32(vmaxq_f32(vld1q_f32(in), vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+  uint16x4_t words = vmovn_u32(vcvtnq_u32_f32(vmulq_f32(clamped, vdupq_n_f32(255.0f))));
+  uint8x8_t bytes = vmovn_u16(vcombine_u16(words, words));
+  vst1_lane_u32((uint32_t *)out, vreinterpret_u32_u8(bytes), 0);
+#else
+  for (int i = 0; i < 4; i++)
+    out[i] = (unsigned char)std::lrint(std::min(std::max(in[i], 0.0f), 1.0f) * 255.0f);
+#endif
+}
+
+// Converts 4 floats in [0, 1] to unorm16
+static void pack_unorm16x4(const float *in, uint16_t *out)
+{
+#if defined(VERTEX_SIMD_SSE2)
+  __m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+  __m128i ints = _mm_cvtps_epi32(_mm_mul_ps(clamped, _mm_set1_ps(65535.0f)));
+  // SSE2 can only pack with signed saturation, so shift into the signed range and back
+  __m128i bias = _mm_set1_epi32(32768);
+  __m128i words = _mm_packs_epi32(_mm_sub_epi32(ints, bias), _mm_sub_epi32(ints, bias));
+  _mm_storel_epi64((__m128i *)out, _mm_xor_si128(words, _mm_set1_epi16((short)0x8000)));
+#elif defined(VERTEX_SIMD_NEON)
+  float32x4_t clamped = vminq_f32(vmaxq_f32(vld1q_f32(in), vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+  vst1_u16(out, vmovn_u32(vcvtnq_u32_f32(vmulq_f32(clamped, vdupq_n_f32(65535.0f)))));
+#else
+  for (int i = 0; i < 4; i++)
+    out[i] = (uint16_t)std::lrint(std::min(std::max(in[i], 0.0f), 1.0f) * 65535.0f);
+#endif
+}
+
+// Converts 4 floats in [-1, 1] to a GL_INT_2_10_10_10_REV snorm, x in the lowest bits
+static uint32_t pack_snorm_2_10_10_10(const float *in)
+{
+  int32_t ints[4];
+#if defined(VERTEX_SIMD_SSE2)
+  __m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in), _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+  _mm_storeu_si128((__m128i *)ints, _mm_cvtps_epi32(_mm_mul_ps(clamped, _mm_setr_ps(511.0f, 511.0f, 511.0f, 1.0f))));
+#elif defined(VERTEX_SIMD_NEON)
+  float32x4_t clamped = vminq_f32(vmaxq_f32(vld1q_f32(in), vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f));
+  const float scales[4] = {511.0f, 511.0f, 511.0f, 1.0f};
+  vst1q_s32(ints, vcvtnq_s32_f32(vmulq_f32(clamped, vld1q_f32(scales))));
+#else
+  const float scales[4] = {511.0f, 511.0f, 511.0f, 1.0f};
+  for (int i = 0; i < 4; i++)
+    ints[i] = (int32_t)std::lrint(std::min(std::max(in[i], -1.0f), 1.0f) * scales[i]);
+#endif
+  return ((uint32_t)ints[0] & 0x3FF) | (((uint32_t)ints[1] & 0x3FF) << 10) | (((uint32_t)ints[2] & 0x3FF) << 20) |
+         (((uint32_t)ints[3] & 0x3) << 30);
+}
+
+// Converts float vertices (stride floats apart) into the attributes of format, reading attribute i from sources[i]
+std::vector<unsigned char> pack_vertices(const float *vertices, size_t vertexCount, size_t stride,
+                                         const VertexFormat &format, const VertexSource *sources)
+{
+  std::vector<unsigned char> packed(vertexCount * format.stride);
+
+  for (size_t a = 0; a < format.attributes.size(); a++)
+  {
+    const VertexFormat::Attribute &attribute = format.attributes[a];
+    const VertexSource &source = sources[a];
+    int copied = std::min(source.components, 4);
+    bool supported = attribute.type == GL_FLOAT || attribute.type == GL_HALF_FLOAT ||
+                     (attribute.normalized && (attribute.type == GL_UNSIGNED_BYTE || attribute.type == GL_UNSIGNED_SHORT ||
+                                               attribute.type == GL_INT_2_10_10_10_REV));
+    if (!supported)
+    {
+      std::cerr << "Error: Can't pack vertex attribute type 0x" << std::hex << attribute.type << std::dec
+                << (attribute.normalized ? "" : " without normalization") << std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+    // The type is picked once per attribute, the loops below only convert
+    unsigned char *out = packed.data() + attribute.offset;
+    const float *in = vertices + source.offset;
+    GLuint size = vertex_attribute_size(attribute.components, attribute.type);
+    for (size_t v = 0; v < vertexCount; v++, out += format.stride, in += stride)
+    {
+      float value[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+      memcpy(value, in, copied * sizeof(float));
+
+      switch (attribute.type)
+      {
+      case GL_HALF_FLOAT:
+      {
+        uint16_t halves[4];
+        pack_half4(value, halves);
+        memcpy(out, halves, size);
+        break;
+      }
+      case GL_UNSIGNED_BYTE:
+      {
+        unsigned char bytes[4];
+        pack_unorm8x4(value, bytes);
+        memcpy(out, bytes, size);
+        break;
+      }
+      case GL_UNSIGNED_SHORT:
+      {
+        uint16_t words[4];
+        pack_unorm16x4(value, words);
+        memcpy(out, words, size);
+        break;
+      }
+      case GL_INT_2_10_10_10_REV:
+      {
+        uint32_t word = pack_snorm_2_10_10_10(value);
+        memcpy(out, &word, 4);
+        break;
+      }
+      default:
+        memcpy(out, value, size);
+      }
+    }
+  }
+  return packed;
+}
+
+// 16 bytes per vertex instead of the 32 of MeshVertex
+VertexFormat compact_mesh_format(bool unitTexCoords)
+{
+  VertexFormat format;
+  format.Add(0, 4, GL_HALF_FLOAT);
+  format.Add(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE);
+  if (unitTexCoords)
+    format.Add(2, 2, GL_UNSIGNED_SHORT, GL_TRUE);
+  else
+    format.Add(2, 2, GL_HALF_FLOAT);
+  return format;
+}
+
+// Packs a mesh into compact_mesh_format, positions are first mapped into [-1, 1] for the most precision
+PackedMesh pack_mesh(const MeshData &mesh)
+{
+  PackedMesh packed;
+
+  // unorm16 can't hold texture coordinates that tile, those get half floats
+  bool unitTexCoords = true;
+  for (const MeshVertex &vertex : mesh.vertices)
+    unitTexCoords = unitTexCoords && vertex.texCoord[0] >= 0.0f && vertex.texCoord[0] <= 1.0f &&
+                    vertex.texCoord[1] >= 0.0f && vertex.texCoord[1] <= 1.0f;
+  packed.format = compact_mesh_format(unitTexCoords);
+
+  // Half floats are most precise around 0, so center the bounds on the origin and scale them to 1
+  for (int axis = 0; axis < 3; axis++)
+  {
+    packed.positionOffset[axis] = (mesh.boundsMin[axis] + mesh.boundsMax[axis]) * 0.5f;
+    float extent = (mesh.boundsMax[axis] - mesh.boundsMin[axis]) * 0.5f;
+    packed.positionScale[axis] = extent > 0.0f ? extent : 1.0f;
+  }
+  std::vector<MeshVertex> vertices(mesh.vertices);
+  for (MeshVertex &vertex : vertices)
+    for (int axis = 0; axis < 3; axis++)
+      vertex.position[axis] = (vertex.position[axis] - packed.positionOffset[axis]) / packed.positionScale[axis];
+
+  const VertexSource sources[] = {
+      {offsetof(MeshVertex, position) / sizeof(float), 3},
+      {offsetof(MeshVertex, normal) / sizeof(float), 3},
+      {offsetof(MeshVertex, texCoord) / sizeof(float), 2}};
+  packed.vertices = pack_vertices((const float *)vertices.data(), vertices.size(), sizeof(MeshVertex) / sizeof(float),
+                                  packed.format, sources);
+  return packed;
+}
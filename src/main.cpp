@@ -1,19 +1,58 @@
 #include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <functional>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "shaderClass.h"
+#include "ProgramCache.h"
+#include "ShaderBatch.h"
+#include "ShaderWatcher.h"
 #include "VAO.h"
 #include "VBO.h"
 #include "EBO.h"
+#include "MeshLoader.h"
+#include "MeshOptimizer.h"
+#include "VertexPacker.h"
+#include "FrustumCulling.h"
+#include "BVH.h"
+#include "TransformHierarchy.h"
+#include "JobSystem.h"
+#include "CommandList.h"
+#include "RenderThread.h"
+#include "IndirectBuffer.h"
+#include "GLExtensions.h"
+#include "UBO.h"
+#include "UniformBlocks.h"
 #include "Texture.h"
+#include "TextureLoader.h"
+#include "TexturePack.h"
+#include "FBO.h"
+#include "FrameTimer.h"
+#include "RenderState.h"
+#include "GLCheck.h"
+#include "DebugOutput.h"
+#ifdef HEADLESS_EGL
+#include "HeadlessContext.h"
+#endif
 #include <stb_image.h>
 
 void processInput(GLFWwindow *window);
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
+double get_time();
+std::vector<glm::mat4> instance_grid(int count);
 
 // Vertices coordinates
 GLfloat vertices[] = {
@@ -32,124 +71,729 @@ GLuint indices[] = {
 const unsigned int WIDTH = 800;
 const unsigned int HEIGHT = 800;
 
-int main()
+// Framebuffer size the window reported last, the loop records a viewport when it changed
+int viewportWidth = WIDTH;
+int viewportHeight = HEIGHT;
+bool viewportChanged = false;
+
+// Number of frames rendered in headless mode when --frames is not given
+const int DEFAULT_HEADLESS_FRAMES = 100;
+// Number of frames left out of the --bench results while the driver warms up
+const int BENCH_WARMUP_FRAMES = 10;
+// Bytes of texture data uploaded per frame while textures stream in
+const GLsizeiptr TEXTURE_UPLOAD_BUDGET = 8 * 1024 * 1024;
+// Instances one culling job tests
+const uint32_t CULL_JOB_INSTANCES = 16384;
+// Textures baked at build time (bake_textures target), used instead of decoding res/images when present
+const char *TEXTURE_PACK = "res/textures.tpack";
+// Linked shader program binaries, reused while the shaders and the driver don't change
+const char *SHADER_CACHE = "shader_cache";
+// Shaders copied next to the binary at configure time
+const char *SHADER_DIR = "res/shaders";
+
+int main(int argc, char **argv)
 {
-  // Initialize GLFW
-  glfwInit();
-
-  // Tell GLFW what version of OpenGL we are using
-  // In this case we are using OpenGL 3.3
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  // Tell GLFW we are using the CORE profile
-  // So that means we only have the modern functions
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-  // Create a GLFWwindow object of 800 by 800 pixels, naming it "YoutubeOpenGL"
-  GLFWwindow *window = glfwCreateWindow(WIDTH, HEIGHT, "LearnOpenGL-GLFW", NULL, NULL);
-  // Error check if the window fails to create
-  if (window == NULL)
-  {
-    std::cout << "Failed to create GLFW window" << std::endl;
-    glfwTerminate();
+  // Command line options
+  //   --headless      render into an offscreen FBO without creating a window
+  //   --frames N      stop after N frames (unbounded by default when windowed)
+  //   --dump FILE     write the last rendered frame to FILE as a PPM image
+  //   --bench FILE    time every frame and write the CPU/GPU percentiles to FILE as JSON
+  //   --hot-reload    rebuild shaders when they are edited
+  //   --instances N   draw N copies of the quad in a grid with one instanced draw call
+  //   --validate-gl N check glGetError once every N frames, also in release builds
+  //   --mesh FILE     draw an OBJ/glTF mesh instead of the quad, reordered for the vertex cache
+  //   --gl-debug      log the driver's KHR_debug messages in release builds, debug builds always do
+  //   --float-vertices upload 32 bit float vertices instead of the packed half float/unorm ones
+  //   --no-culling    draw every instance instead of only those inside the view frustum
+  //   --bvh           cull the instances through a BVH instead of testing each of them
+  //   --no-render-thread execute every frame on the main thread right after recording it
+  bool headless = false;
+  bool hotReload = false;
+  int instanceCount = 1;
+  int frameCount = 0;
+  int validateInterval = 0;
+  bool debugOutput = false;
+  bool floatVertices = false;
+  bool culling = true;
+  bool cullWithBVH = false;
+  bool useRenderThread = true;
+  const char *dumpFile = NULL;
+  const char *benchFile = NULL;
+  const char *meshFile = NULL;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--headless") == 0)
+      headless = true;
+    else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+      frameCount = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc)
+      dumpFile = argv[++i];
+    else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc)
+      benchFile = argv[++i];
+    else if (strcmp(argv[i], "--hot-reload") == 0)
+      hotReload = true;
+    else if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc)
+      instanceCount = std::max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--validate-gl") == 0 && i + 1 < argc)
+      validateInterval = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--mesh") == 0 && i + 1 < argc)
+      meshFile = argv[++i];
+    else if (strcmp(argv[i], "--gl-debug") == 0)
+      debugOutput = true;
+    else if (strcmp(argv[i], "--float-vertices") == 0)
+      floatVertices = true;
+    else if (strcmp(argv[i], "--no-culling") == 0)
+      culling = false;
+    else if (strcmp(argv[i], "--bvh") == 0)
+      cullWithBVH = true;
+    else if (strcmp(argv[i], "--no-render-thread") == 0)
+      useRenderThread = false;
+    else
+    {
+      std::cerr << "Usage: " << argv[0] << " [--headless] [--frames N] [--dump FILE] [--bench FILE] [--hot-reload] [--instances N] [--validate-gl N] [--mesh FILE] [--gl-debug] [--float-vertices] [--no-culling] [--bvh] [--no-render-thread]" << std::endl;
+      return -1;
+    }
+  }
+  if (headless && frameCount <= 0)
+    frameCount = DEFAULT_HEADLESS_FRAMES;
+
+  GLFWwindow *window = NULL;
+  // Invisible window whose context shares objects with the main one, shaders are rebuilt on it
+  GLFWwindow *reloadWindow = NULL;
+#ifdef HEADLESS_EGL
+  std::unique_ptr<HeadlessContext> headlessContext;
+  std::unique_ptr<HeadlessContext> reloadContext;
+#endif
+  std::unique_ptr<FBO> offscreen;
+
+  if (headless)
+  {
+#ifdef HEADLESS_EGL
+    // Create a surfaceless OpenGL 3.3 core context, no display server needed
+    headlessContext.reset(new HeadlessContext(3, 3));
+    headlessContext->MakeCurrent();
+
+    // Load GLAD through EGL since there is no GLFW window to ask
+    if (!gladLoadGLLoader((GLADloadproc)HeadlessContext::GetProcAddress))
+    {
+      std::cout << "Failed to load OpenGL functions" << std::endl;
+      return -1;
+    }
+#else
+    std::cout << "Headless mode is not available, rebuild with EGL support" << std::endl;
     return -1;
+#endif
+  }
+  else
+  {
+    // Initialize GLFW
+    glfwInit();
+
+    // Tell GLFW what version of OpenGL we are using
+    // In this case we are using OpenGL 3.3
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    // Tell GLFW we are using the CORE profile
+    // So that means we only have the modern functions
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#if GL_CHECKS
+    // Debug contexts report every error through KHR_debug, see GLCheck.h
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+#endif
+
+    // Create a GLFWwindow object of 800 by 800 pixels, naming it "YoutubeOpenGL"
+    window = glfwCreateWindow(WIDTH, HEIGHT, "LearnOpenGL-GLFW", NULL, NULL);
+    // Error check if the window fails to create
+    if (window == NULL)
+    {
+      std::cout << "Failed to create GLFW window" << std::endl;
+      glfwTerminate();
+      return -1;
+    }
+    // Introduce the window into the current context
+    glfwMakeContextCurrent(window);
+
+    // Load GLAD so it configures OpenGL
+    gladLoadGL();
+
+    // Don't let vsync cap the frame times we are measuring
+    if (benchFile != NULL)
+      glfwSwapInterval(0);
+  }
+
+  // Errors are reported by the driver in debug builds, nothing on the per frame path asks for them
+  gl_checks_init(validateInterval);
+  // Release builds only listen when asked to, without blocking the driver
+  if (debugOutput && !DebugOutput::Installed() && !DebugOutput::Install(false))
+    std::cerr << "Warning: --gl-debug needs KHR_debug (OpenGL 4.3)" << std::endl;
+
+  if (headless)
+  {
+    // Everything is drawn into an FBO of the same size as the window would be
+    offscreen.reset(new FBO(WIDTH, HEIGHT));
+    offscreen->Bind();
+    glViewport(0, 0, WIDTH, HEIGHT);
+  }
+  else
+  {
+    // Specify the viewport of OpenGL in the Window, the first frame records it
+    // In this case the viewport goes from x = 0, y = 0, to x = 800, y = 800
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    framebuffer_size_callback(window, framebufferWidth, framebufferHeight);
+
+    // Set the callback for when the window resizes
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
   }
-  // Introduce the window into the current context
-  glfwMakeContextCurrent(window);
 
-  // Load GLAD so it configures OpenGL
-  gladLoadGL();
-  // Specify the viewport of OpenGL in the Window
-  // In this case the viewport goes from x = 0, y = 0, to x = 800, y = 800
-  int framebufferWidth, framebufferHeight;
-  glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
-  framebuffer_size_callback(window, framebufferWidth, framebufferHeight);
+  // Hot reloading reads the shaders from the source tree, so edits to res/shaders take effect right away
+  std::string shaderDir = SHADER_DIR;
+#ifdef SHADER_SOURCE_DIR
+  if (hotReload && std::ifstream(SHADER_SOURCE_DIR "/default.vert"))
+    shaderDir = SHADER_SOURCE_DIR;
+#endif
+  std::string vertexFile = shaderDir + "/default.vert";
+  std::string fragmentFile = shaderDir + "/default.frag";
 
-  // Set the callback for when the window resizes
-  glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+  // Generates Shader object using shaders default.vert and default.frag, from the binary cache when warm.
+  // The batch only submits it, the driver compiles while the buffers and textures below are set up
+  ProgramCache programCache(SHADER_CACHE);
+  ShaderBatch shaders(&programCache);
+  Shader &shaderProgram = shaders.Add(vertexFile.c_str(), fragmentFile.c_str());
 
-  // Generates Shader object using shaders default.vert and default.frag
-  Shader shaderProgram("res/shaders/default.vert", "res/shaders/default.frag");
+  // Rebuilds the program on a second context whenever its files change
+  std::unique_ptr<ShaderWatcher> shaderWatcher;
+  if (hotReload)
+  {
+    if (headless)
+    {
+#ifdef HEADLESS_EGL
+      reloadContext.reset(new HeadlessContext(3, 3, headlessContext.get()));
+      HeadlessContext *context = reloadContext.get();
+      shaderWatcher.reset(new ShaderWatcher([context]
+                                            { context->MakeCurrent(); },
+                                            [context]
+                                            { context->Release(); }));
+#endif
+    }
+    else
+    {
+      glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+      reloadWindow = glfwCreateWindow(1, 1, "", NULL, window);
+      if (reloadWindow != NULL)
+        shaderWatcher.reset(new ShaderWatcher([reloadWindow]
+                                              { glfwMakeContextCurrent(reloadWindow); },
+                                              []
+                                              { glfwMakeContextCurrent(NULL); }));
+      else
+        std::cerr << "Warning: Failed to create a shared context, shader hot reload is off" << std::endl;
+    }
+    if (shaderWatcher)
+      shaderWatcher->Watch(shaderProgram, vertexFile.c_str(), fragmentFile.c_str());
+  }
 
   // Generates Vertex Array Object and binds it
   VAO VAO1;
   VAO1.Bind();
 
+  // The quad, or a mesh from --mesh with the same vertex layout
+  GLfloat *vertexData = vertices;
+  size_t vertexCount = sizeof(vertices) / (8 * sizeof(GLfloat));
+  GLuint *indexData = indices;
+  GLsizeiptr indexSize = sizeof(indices);
+  MeshData mesh;
+  // Centers the mesh and scales it to the size of the quad
+  glm::mat4 meshFit = glm::mat4(1.0f);
+  if (meshFile != NULL)
+  {
+    if (!load_mesh(meshFile, mesh))
+      return -1;
+
+    // Welding already happened while loading, the reorders are what the ACMR measures
+    float acmrBefore = compute_acmr(mesh.indices, mesh.vertices.size());
+    optimize_mesh(mesh);
+    std::cout << "Loaded mesh: " << meshFile << " (" << mesh.indices.size() / 3 << " triangles, "
+              << mesh.vertices.size() << " vertices, " << mesh.sourceVertexCount << " before welding), ACMR "
+              << acmrBefore << " -> " << compute_acmr(mesh.indices, mesh.vertices.size()) << std::endl;
+
+    vertexData = (GLfloat *)mesh.vertices.data();
+    vertexCount = mesh.vertices.size();
+    indexData = mesh.indices.data();
+    indexSize = mesh.indices.size() * sizeof(GLuint);
+
+    glm::vec3 boundsMin(mesh.boundsMin[0], mesh.boundsMin[1], mesh.boundsMin[2]);
+    glm::vec3 boundsMax(mesh.boundsMax[0], mesh.boundsMax[1], mesh.boundsMax[2]);
+    glm::vec3 extent = boundsMax - boundsMin;
+    float size = std::max(extent.x, std::max(extent.y, extent.z));
+    if (size > 0.0f)
+      meshFit = glm::scale(meshFit, glm::vec3(1.0f / size, 1.0f / size, 1.0f / size));
+    meshFit = glm::translate(meshFit, (boundsMin + boundsMax) * -0.5f);
+  }
+  GLsizei indexCount = (GLsizei)(indexSize / sizeof(GLuint));
+
+  // Bounds of the positions in the VBO, which the instance transforms place
+  glm::vec3 vertexMin(INFINITY, INFINITY, INFINITY);
+  glm::vec3 vertexMax(-INFINITY, -INFINITY, -INFINITY);
+  for (size_t v = 0; v < vertexCount; v++)
+    for (int axis = 0; axis < 3; axis++)
+    {
+      vertexMin[axis] = std::min(vertexMin[axis], vertexData[v * 8 + axis]);
+      vertexMax[axis] = std::max(vertexMax[axis], vertexData[v * 8 + axis]);
+    }
+
+  // The float layout: position, color (or normal) and texture coordinates
+  VertexFormat floatFormat;
+  floatFormat.Add(0, 3, GL_FLOAT).Add(1, 3, GL_FLOAT).Add(2, 2, GL_FLOAT);
+  VertexFormat vertexFormat = floatFormat;
+  std::vector<unsigned char> packedVertices;
+  if (!floatVertices && meshFile != NULL)
+  {
+    // Half float positions relative to the bounds, the model matrix maps them back
+    PackedMesh packed = pack_mesh(mesh);
+    packedVertices.swap(packed.vertices);
+    vertexFormat = packed.format;
+    meshFit = glm::translate(meshFit, glm::vec3(packed.positionOffset[0], packed.positionOffset[1], packed.positionOffset[2]));
+    meshFit = glm::scale(meshFit, glm::vec3(packed.positionScale[0], packed.positionScale[1], packed.positionScale[2]));
+    for (int axis = 0; axis < 3; axis++)
+    {
+      vertexMin[axis] = (vertexMin[axis] - packed.positionOffset[axis]) / packed.positionScale[axis];
+      vertexMax[axis] = (vertexMax[axis] - packed.positionOffset[axis]) / packed.positionScale[axis];
+    }
+  }
+  else if (!floatVertices)
+  {
+    // The quad's values are all exact as half floats and unorms: half float position, unorm8 color, unorm16 UVs
+    vertexFormat = VertexFormat();
+    vertexFormat.Add(0, 4, GL_HALF_FLOAT).Add(1, 4, GL_UNSIGNED_BYTE, GL_TRUE).Add(2, 2, GL_UNSIGNED_SHORT, GL_TRUE);
+    const VertexSource sources[] = {{0, 3}, {3, 3}, {6, 2}};
+    packedVertices = pack_vertices(vertexData, vertexCount, 8, vertexFormat, sources);
+  }
+  if (!packedVertices.empty())
+    vertexData = (GLfloat *)packedVertices.data();
+  // Worker threads for texture decoding, culling and transform updates, this thread runs jobs too while it waits
+  JobSystem jobs;
+
+  // The scene's transforms: the turntable, and the mesh on it. meshFit only scales and
+  // translates, so its diagonal and last column are the local transform
+  TransformHierarchy hierarchy;
+  uint32_t turntable = hierarchy.Add(TRANSFORM_ROOT, glm::vec3(0.0f, 0.0f, 0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+                                     glm::vec3(1.0f, 1.0f, 1.0f));
+  uint32_t meshNode = hierarchy.Add(turntable, glm::vec3(meshFit[3][0], meshFit[3][1], meshFit[3][2]),
+                                    glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(meshFit[0][0], meshFit[1][1], meshFit[2][2]));
+
+  std::cout << "Vertex size: " << vertexFormat.stride << " bytes (" << floatFormat.stride << " unpacked, "
+            << vertex_simd_path() << " packer)" << std::endl;
+
   // Generates Vertex Buffer Object and links it to vertices
-  VBO VBO1(vertices, sizeof(vertices));
+  VBO VBO1(vertexData, vertexCount * vertexFormat.stride);
   // Generates Element Buffer Object and links it to indices
-  EBO EBO1(indices, sizeof(indices));
+  EBO EBO1(indexData, indexSize);
+
+  // Per instance transforms, a grid of shrunken copies filling the quad's area (identity for one instance)
+  std::vector<glm::mat4> instances = instance_grid(instanceCount);
+  VBO instanceVBO((GLfloat *)instances.data(), instances.size() * sizeof(glm::mat4));
 
   // Links VBO to VAO
-  VAO1.LinkAttrib(VBO1, 0, 3, GL_FLOAT, 8 * sizeof(float), (void *)0);
-  VAO1.LinkAttrib(VBO1, 1, 3, GL_FLOAT, 8 * sizeof(float), (void *)(3 * sizeof(float)));
-  VAO1.LinkAttrib(VBO1, 2, 2, GL_FLOAT, 8 * sizeof(float), (void *)(6 * sizeof(float)));
+  VAO1.LinkFormat(VBO1, vertexFormat);
+  VAO1.LinkMat4Attrib(instanceVBO, 3, sizeof(glm::mat4), (void *)0);
+  // Names the VAO in debug messages and frame captures
+  VAO1.Label("Quad");
   // Unbind all to prevent accidentally modifying them
   VAO1.Unbind();
   VBO1.Unbind();
   EBO1.Unbind();
 
-  GLuint uniID = glGetUniformLocation(shaderProgram.ID, "scale");
+  // Bounds of every instance in the space the model matrix is applied to, they never move in it.
+  // Culling against the frustum of proj * view * model keeps them from being transformed each frame
+  CullingBounds instanceBounds;
+  BVH instanceBVH;
+  for (const glm::mat4 &instance : instances)
+  {
+    glm::vec3 instanceMin, instanceMax;
+    transform_bounds(instance, vertexMin, vertexMax, instanceMin, instanceMax);
+    instanceBounds.Add(instanceMin, instanceMax);
+    instanceBVH.Add(instanceMin, instanceMax);
+  }
+  if (cullWithBVH)
+    instanceBVH.Build();
+  std::vector<uint32_t> visibleInstances(instances.size());
+  // Visible instances each culling job found, at the start of its range of visibleInstances
+  std::vector<uint32_t> batchVisible((instances.size() + CULL_JOB_INSTANCES - 1) / CULL_JOB_INSTANCES);
+  // Visible instances that were drawn in total, to report how much culling saved
+  unsigned long long drawnInstances = 0;
+
+  // Draw commands of the frame, one per run of consecutive visible instances, which select
+  // theirs with the base instance (at most every other instance starts a run)
+  IndirectBuffer drawCommands((GLsizei)(instances.size() + 1) / 2);
+  // Without base instances (before OpenGL 4.2 or without indirect drawing) the transforms
+  // of the visible instances are instead copied to the front of the instance VBO
+  bool baseInstances = drawCommands.indirect && (GLAD_GL_VERSION_4_2 || has_gl_extension("GL_ARB_base_instance"));
+  std::vector<glm::mat4> visibleTransforms;
 
-  // Texture
-  Texture flower("res/images/img1.jpg", GL_TEXTURE_2D, GL_TEXTURE0, GL_RGBA, GL_UNSIGNED_BYTE);
-  flower.texUnit(shaderProgram, "tex0", 0);
+  // Generates the Uniform Buffer Object holding the camera matrices for every program
+  UBO cameraUBO(sizeof(CameraBlock), CAMERA_BLOCK_BINDING);
+
+  // Texture, decoded by a job and streamed in a few MB per frame, a placeholder is drawn meanwhile
+  TextureLoader textureLoader(jobs, TEXTURE_UPLOAD_BUDGET);
+  std::unique_ptr<TexturePack> texturePack;
+  std::shared_ptr<AsyncTexture> flower;
+  if (std::ifstream(TEXTURE_PACK))
+  {
+    // Pre-decoded and pre-mipmapped, uploaded straight from the memory mapped pack
+    texturePack.reset(new TexturePack(TEXTURE_PACK));
+    flower = textureLoader.Load(*texturePack, "img1", GL_TEXTURE_2D);
+  }
+  else
+    flower = textureLoader.Load("res/images/img1.jpg", GL_TEXTURE_2D);
+  RenderState::ActiveTexture(GL_TEXTURE0);
+  // First use of the program, waits for it if the driver is still compiling
+  shaderProgram.Activate();
+  shaderProgram.setInt("tex0", 0);
+  std::cout << "Shader programs: " << programCache.hits << " cached, " << programCache.misses << " compiled"
+            << (shaders.parallel ? " in parallel" : "") << std::endl;
+
+  // Headless runs measure the steady state scene, so they wait for every texture up front
+  if (headless)
+    textureLoader.WaitAll();
 
   float rotation = 0.0f;
-  double prevTime = glfwGetTime();
+  double prevTime = get_time();
+  int frame = 0;
+
+  // Only time frames when benchmarking, the queries are not free
+  std::unique_ptr<FrameTimer> frameTimer;
+  if (benchFile != NULL)
+    frameTimer.reset(new FrameTimer(BENCH_WARMUP_FRAMES));
+
+  // Uniform locations are cached by the Shader, the loop must not add any driver lookups
+  unsigned long setupLookups = Shader::driverLookups;
+  // State changes the loop sent to the driver and the redundant ones RenderState skipped
+  unsigned long issuedStateCalls = 0, elidedStateCalls = 0;
 
   // Enables the Depth Buffer
-  glEnable(GL_DEPTH_TEST);
+  RenderState::Enable(GL_DEPTH_TEST);
+
+  // Executes a recorded frame. While the loop runs this is the only code that talks to the
+  // driver, on the render thread that owns the context (or on this one with --no-render-thread)
+  auto executeFrame = [&](const CommandList &list)
+  {
+    if (frameTimer)
+      frameTimer->BeginFrame();
+    RenderState::ResetCounters();
 
-  // Main while loop
-  while (!glfwWindowShouldClose(window))
+    // Continue streaming textures within this frame's upload budget
+    DebugOutput::PushGroup("Texture streaming");
+    textureLoader.Update();
+    DebugOutput::PopGroup();
+    // Swap in shaders rebuilt since the last frame, the new program starts with default uniform values
+    if (shaderWatcher && shaderWatcher->Update() > 0)
+    {
+      shaderProgram.Activate();
+      shaderProgram.setInt("tex0", 0);
+    }
+
+    DebugOutput::PushGroup("Scene");
+    for (const RenderCommand *packet = list.First(); packet != nullptr; packet = list.Next(packet))
+    {
+      switch (packet->type)
+      {
+      case RENDER_COMMAND_VIEWPORT:
+      {
+        const ViewportCommand *viewport = (const ViewportCommand *)packet;
+        glViewport(viewport->x, viewport->y, viewport->width, viewport->height);
+        break;
+      }
+      case RENDER_COMMAND_CLEAR:
+      {
+        // Specify the color of the background
+        const ClearCommand *clear = (const ClearCommand *)packet;
+        glClearColor(clear->color[0], clear->color[1], clear->color[2], clear->color[3]);
+        // Clean the back buffer and depth buffer
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        break;
+      }
+      case RENDER_COMMAND_CAMERA:
+      {
+        // Uploads the camera once per frame, every program reads it from the shared binding point
+        const CameraCommand *cameraPacket = (const CameraCommand *)packet;
+        CameraBlock camera;
+        camera.view = cameraPacket->view;
+        camera.proj = cameraPacket->proj;
+        cameraUBO.Update(&camera, sizeof(camera));
+        break;
+      }
+      case RENDER_COMMAND_DRAW_INSTANCES:
+      {
+        const DrawInstancesCommand *draw = (const DrawInstancesCommand *)packet;
+        const InstanceRun *runs = draw->Runs();
+        // Tell OpenGL which Shader Program we want to use
+        shaderProgram.Activate();
+        // Outputs the per object matrix into the Vertex Shader
+        shaderProgram.setMat4("model", draw->model);
+        // Assigns a value to the uniform; NOTE: Must always be done after activating the Shader Program
+        shaderProgram.setFloat("scale", draw->scale);
+        // Binds texture so that is appears in rendering
+        flower->Bind();
+        // Bind the VAO so OpenGL knows to use it
+        VAO1.Bind();
+        if (!baseInstances && culling)
+        {
+          visibleTransforms.clear();
+          for (uint32_t run = 0; run < draw->runCount; run++)
+            visibleTransforms.insert(visibleTransforms.end(), instances.begin() + runs[run].first,
+                                     instances.begin() + runs[run].first + runs[run].count);
+          instanceVBO.Bind();
+          glBufferSubData(GL_ARRAY_BUFFER, 0, visibleTransforms.size() * sizeof(glm::mat4), visibleTransforms.data());
+          instanceVBO.Unbind();
+        }
+        // Draw primitives through a command buffer: number of indices, instances, first index, base vertex.
+        // One command per run, or one for all of them from the front of the instance VBO
+        DrawElementsIndirectCommand *command = drawCommands.Map();
+        GLsizei commandCount = 0;
+        for (uint32_t run = 0; run < draw->runCount; run++)
+        {
+          if (baseInstances || commandCount == 0)
+          {
+            command[commandCount].count = indexCount;
+            command[commandCount].instanceCount = 0;
+            command[commandCount].firstIndex = 0;
+            command[commandCount].baseVertex = 0;
+            command[commandCount].baseInstance = baseInstances ? runs[run].first : 0;
+            commandCount++;
+          }
+          command[commandCount - 1].instanceCount += runs[run].count;
+        }
+        drawCommands.Unmap(commandCount);
+        drawCommands.Draw(GL_TRIANGLES, GL_UNSIGNED_INT);
+        break;
+      }
+      }
+    }
+    DebugOutput::PopGroup();
+    issuedStateCalls += RenderState::issued;
+    elidedStateCalls += RenderState::elided;
+    // Only queries the driver every --validate-gl frames
+    gl_validate_frame();
+    // Sums up the driver messages muted since the last summary
+    DebugOutput::Update();
+
+    if (frameTimer)
+      frameTimer->EndFrame();
+
+    if (headless)
+    {
+      // Nothing to present, just make sure the frame is submitted
+      glFlush();
+      return;
+    }
+    // Swap the back buffer with the front buffer
+    glfwSwapBuffers(window);
+  };
+
+  // Hands the context to the render thread for the loop, and takes it back after it. The thread
+  // taking the context forgets its RenderState shadow, the other thread has bound things since
+  std::function<void()> makeCurrent, releaseContext;
+  if (headless)
+  {
+#ifdef HEADLESS_EGL
+    HeadlessContext *context = headlessContext.get();
+    makeCurrent = [context]
+    {
+      context->MakeCurrent();
+      RenderState::Invalidate();
+    };
+    releaseContext = [context]
+    { context->Release(); };
+#endif
+  }
+  else
+  {
+    makeCurrent = [window]
+    {
+      glfwMakeContextCurrent(window);
+      RenderState::Invalidate();
+    };
+    releaseContext = []
+    { glfwMakeContextCurrent(NULL); };
+  }
+  std::unique_ptr<RenderThread> renderThread;
+  // The frame's commands when they are executed right away on this thread
+  CommandList frameCommands;
+  if (useRenderThread)
+  {
+    releaseContext();
+    renderThread.reset(new RenderThread(makeCurrent, releaseContext, executeFrame));
+  }
+  // Seconds this thread spent simulating and recording frames
+  double recordTime = 0.0;
+  // Runs of consecutive visible instances, one draw command each
+  std::vector<InstanceRun> instanceRuns;
+
+  // Main while loop, bounded by --frames when given. Only simulates and records, the render
+  // thread executes frame N while this records frame N + 1
+  while ((frameCount == 0 || frame < frameCount) && (headless || !glfwWindowShouldClose(window)))
   {
-    // Specify the color of the background
-    glClearColor(0.07f, 0.13f, 0.17f, 1.0f);
-    // Clean the back buffer and depth buffer
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    // Tell OpenGL which Shader Program we want to use
-    shaderProgram.Activate();
+    CommandList &commands = renderThread ? renderThread->Begin() : frameCommands;
+    if (!renderThread)
+      frameCommands.Reset(frame);
+    double recordStart = get_time();
+
+    // The window reports resizes here, while polling events
+    if (viewportChanged)
+    {
+      commands.Viewport(0, 0, viewportWidth, viewportHeight);
+      viewportChanged = false;
+    }
+    commands.Clear(0.07f, 0.13f, 0.17f, 1.0f);
 
-    // Simple timer
-    double crntTime = glfwGetTime();
-    if (crntTime - prevTime >= 1 / 60)
+    // Simple timer, advances the rotation at most 60 times per second
+    double crntTime = get_time();
+    if (crntTime - prevTime >= 1.0 / 60.0)
     {
       rotation += 0.5f;
       prevTime = crntTime;
     }
 
+    // Turns the turntable, the mesh follows it
+    hierarchy.SetRotation(turntable, glm::angleAxis(glm::radians(rotation), glm::vec3(0.0f, 1.0f, 0.0f)));
+    hierarchy.Update(&jobs);
+    glm::mat4 model = hierarchy.World(meshNode);
+
     // Initializes matrices so they are not the null matrix
-    glm::mat4 model = glm::mat4(1.0f);
     glm::mat4 view = glm::mat4(1.0f);
     glm::mat4 proj = glm::mat4(1.0f);
 
     // Assigns different transformations to each matrix
-    model = glm::rotate(model, glm::radians(rotation), glm::vec3(0.0f, 1.0f, 0.0f));
     view = glm::translate(view, glm::vec3(0.0f, -0.5f, -2.0f));
     proj = glm::perspective(glm::radians(45.0f), (float)WIDTH / HEIGHT, 0.1f, 100.0f);
+    commands.Camera(view, proj);
 
-    // Outputs the matrices into the Vertex Shader
-    int modelLoc = glGetUniformLocation(shaderProgram.ID, "model");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    int viewLoc = glGetUniformLocation(shaderProgram.ID, "view");
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    int projLoc = glGetUniformLocation(shaderProgram.ID, "proj");
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(proj));
-
-    // Assigns a value to the uniform; NOTE: Must always be done after activating the Shader Program
-    glUniform1f(uniID, 0.5f);
-    // Binds texture so that is appears in rendering
-    flower.Bind();
-    // Bind the VAO so OpenGL knows to use it
-    VAO1.Bind();
-    // Draw primitives, number of indices, datatype of indices, index of indices
-    glDrawElements(GL_TRIANGLES, sizeof(indices) / sizeof(int), GL_UNSIGNED_INT, 0);
-    // Swap the back buffer with the front buffer
-    glfwSwapBuffers(window);
-    // Take care of all GLFW events
-    glfwPollEvents();
+    // Keeps the instances whose box touches the frustum, in the space of the instance bounds
+    size_t visibleCount = instances.size();
+    if (culling && cullWithBVH)
+    {
+      // The tree returns instances in leaf order, sorting them back lets neighbours share commands
+      visibleCount = instanceBVH.QueryFrustum(extract_frustum(proj * view * model), visibleInstances.data());
+      std::sort(visibleInstances.begin(), visibleInstances.begin() + visibleCount);
+    }
+    else if (culling)
+    {
+      // Jobs test a range each, then the ranges' visible instances are packed together in order
+      Frustum frustum = extract_frustum(proj * view * model);
+      jobs.ParallelFor((uint32_t)instances.size(), CULL_JOB_INSTANCES, [&](uint32_t first, uint32_t count)
+                       { batchVisible[first / CULL_JOB_INSTANCES] = (uint32_t)cull_boxes_range(
+                             frustum, instanceBounds, first, count, visibleInstances.data() + first); });
+      visibleCount = 0;
+      for (size_t batch = 0; batch < batchVisible.size(); batch++)
+      {
+        uint32_t *batchFirst = visibleInstances.data() + batch * CULL_JOB_INSTANCES;
+        std::copy(batchFirst, batchFirst + batchVisible[batch], visibleInstances.data() + visibleCount);
+        visibleCount += batchVisible[batch];
+      }
+    }
+    else
+      for (size_t i = 0; i < visibleCount; i++)
+        visibleInstances[i] = (uint32_t)i;
+    drawnInstances += visibleCount;
+
+    // Visible instances with consecutive indices share a run
+    instanceRuns.clear();
+    for (size_t i = 0; i < visibleCount; i++)
+    {
+      if (instanceRuns.empty() || visibleInstances[i] != instanceRuns.back().first + instanceRuns.back().count)
+        instanceRuns.push_back({visibleInstances[i], 0});
+      instanceRuns.back().count++;
+    }
+    commands.DrawInstances(model, 0.5f, instanceRuns.data(), (uint32_t)instanceRuns.size());
+    frame++;
+
+    recordTime += get_time() - recordStart;
+    if (renderThread)
+      renderThread->Submit();
+    else
+      executeFrame(frameCommands);
+
+    if (!headless)
+    {
+      // Take care of all GLFW events
+      glfwPollEvents();
+    }
+  }
+
+  // Lets the render thread finish the frames it still has, then this thread owns the context again
+  if (renderThread)
+  {
+    renderThread->Delete();
+    makeCurrent();
+  }
+
+  // Reports the frame times once every GPU query has come back
+  if (frameTimer)
+  {
+    frameTimer->Finish();
+    frameTimer->Report(std::cout);
+    std::cout << "Uniform location lookups during the loop: " << Shader::driverLookups - setupLookups << std::endl;
+    std::cout << "State calls per frame: " << (double)issuedStateCalls / frame << " issued, "
+              << (double)elidedStateCalls / frame << " elided" << std::endl;
+    std::cout << "Main thread per frame: " << recordTime * 1000.0 / frame << " ms simulating and recording, "
+              << (renderThread ? renderThread->waitTime * 1000.0 / frame : 0.0) << " ms waiting for the render thread"
+              << std::endl;
+    std::cout << "Instances drawn per frame: " << (double)drawnInstances / frame << " of " << instances.size()
+              << " (" << (cullWithBVH ? "BVH" : culling_simd_path()) << " culling" << (culling ? "" : " off") << ")"
+              << std::endl;
+    frameTimer->WriteJSON(benchFile);
+    frameTimer->Delete();
+  }
+
+  // Every driver message seen during the run, nothing is printed when there were none
+  DebugOutput::Report(std::cout);
+  if (shaderWatcher)
+    std::cout << "Shader hot reload: " << shaderWatcher->reloads.load() << " programs swapped in, "
+              << shaderWatcher->failures.load() << " rebuilds failed" << std::endl;
+
+  // Writes the last frame out so headless runs can be inspected
+  if (dumpFile != NULL)
+  {
+    if (headless)
+      offscreen->SavePPM(dumpFile);
+    else
+      std::cerr << "Warning: --dump is only supported together with --headless" << std::endl;
   }
+
+  // Delete all the objects we've created
+  VAO1.Delete();
+  VBO1.Delete();
+  instanceVBO.Delete();
+  EBO1.Delete();
+  drawCommands.Delete();
+  flower->Delete();
+  textureLoader.Delete();
+  jobs.Delete();
+  if (texturePack)
+    texturePack->Delete();
+  cameraUBO.Delete();
+  if (shaderWatcher)
+    shaderWatcher->Delete();
+  shaders.Delete();
+
+  if (headless)
+  {
+    offscreen->Delete();
+#ifdef HEADLESS_EGL
+    if (reloadContext)
+      reloadContext->Delete();
+    headlessContext->Delete();
+#endif
+  }
+  else
+  {
+    // Delete window before ending the program
+    if (reloadWindow != NULL)
+      glfwDestroyWindow(reloadWindow);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+  }
+  return 0;
 }
 
 void processInput(GLFWwindow *window)
@@ -160,5 +804,29 @@ void processInput(GLFWwindow *window)
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height)
 {
-  glViewport(0, 0, width, height);
-}
\ No newline at end of file
+  viewportWidth = width;
+  viewportHeight = height;
+  viewportChanged = true;
+}
+
+// Seconds since an arbitrary point, works without GLFW being initialized
+double get_time()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Transforms laying count copies of the quad out in a square grid over the quad's own area
+std::vector<glm::mat4> instance_grid(int count)
+{
+  int side = (int)std::ceil(std::sqrt((double)count));
+  std::vector<glm::mat4> transforms;
+  transforms.reserve(count);
+  for (int i = 0; i < count; i++)
+  {
+    float x = ((i % side) + 0.5f) / side - 0.5f;
+    float y = ((i / side) + 0.5f) / side - 0.5f;
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
+    transforms.push_back(glm::scale(transform, glm::vec3(1.0f / side)));
+  }
+  return transforms;
+}
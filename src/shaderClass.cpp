@@ -1,9 +1,31 @@
 #include "shaderClass.h"
+#include "RenderState.h"
+#include "UniformBlocks.h"
+#include "DebugOutput.h"
+#include "GLExtensions.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
+#include <utility>
 #include <glad/glad.h>
+#include <glm/gtc/type_ptr.hpp>
+
+// KHR_parallel_shader_compile, glad is generated without extensions
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+std::atomic<unsigned long> Shader::driverLookups(0);
+
+// FNV-1a hash of a uniform name
+static std::uint32_t hash_name(const char *name)
+{
+  std::uint32_t hash = 2166136261u;
+  for (; *name != '\0'; name++)
+    hash = (hash ^ (unsigned char)*name) * 16777619u;
+  return hash;
+}
 
 // Reads a text file and outputs a string with everything in the text file
 std::string get_file_contents(const char *filename)
@@ -21,55 +43,235 @@ std::string get_file_contents(const char *filename)
   }
 }
 
+// Returns true if the driver compiles and links on its own threads and can report progress
+static bool has_parallel_compile()
+{
+  static const bool available = has_gl_extension("GL_KHR_parallel_shader_compile") ||
+                                has_gl_extension("GL_ARB_parallel_shader_compile");
+  return available;
+}
+
 // Constructor that builds the Shader Program from 2 different shaders
-Shader::Shader(const char *vertexFile, const char *fragmentFile)
+Shader::Shader(const char *vertexFile, const char *fragmentFile, ProgramCache *cache, bool wait)
+    : pending(false), vertexShader(0), fragmentShader(0), cache(cache), cacheKey(0)
 {
   // Read vertexFile and fragmentFile and store the strings
   std::string vertexCode = get_file_contents(vertexFile);
   std::string fragmentCode = get_file_contents(fragmentFile);
 
+  // Create Shader Program Object and get its reference
+  ID = glCreateProgram();
+  DebugOutput::Label(GL_PROGRAM, ID, std::string(vertexFile) + " + " + fragmentFile);
+
+  // A cached binary skips compiling and linking altogether
+  if (cache != nullptr)
+  {
+    cacheKey = cache->Key({vertexCode, fragmentCode});
+    if (cache->Load(ID, cacheKey))
+    {
+      cacheUniforms();
+      bindUniformBlocks();
+      return;
+    }
+  }
+
   // Convert the shader source strings into character arrays
   const char *vertexSource = vertexCode.c_str();
   const char *fragmentSource = fragmentCode.c_str();
 
   // Create Vertex Shader Object and get its reference
-  GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+  vertexShader = glCreateShader(GL_VERTEX_SHADER);
   glShaderSource(vertexShader, 1, &vertexSource, nullptr);
   glCompileShader(vertexShader);
-  checkCompileErrors(vertexShader, "VERTEX");
 
   // Create Fragment Shader Object and get its reference
-  GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+  fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
   glShaderSource(fragmentShader, 1, &fragmentSource, nullptr);
   glCompileShader(fragmentShader);
-  checkCompileErrors(fragmentShader, "FRAGMENT");
 
-  // Create Shader Program Object and get its reference
-  ID = glCreateProgram();
   // Attach the Vertex and Fragment Shaders to the Shader Program
   glAttachShader(ID, vertexShader);
   glAttachShader(ID, fragmentShader);
-  // Link all the shaders together into the Shader Program
+  // Link all the shaders together into the Shader Program.
+  // Nothing asks for a status before Finish, so the driver is free to do all of this in the background
+  if (cache != nullptr)
+    cache->PrepareLink(ID);
   glLinkProgram(ID);
+  pending = true;
+
+  if (wait)
+    Finish();
+}
+
+// True once Finish won't block, never waits for the driver
+bool Shader::Ready() const
+{
+  if (!pending)
+    return true;
+  // Without the extension any status query blocks, so the program counts as busy until Finish
+  if (!has_parallel_compile())
+    return false;
+
+  GLint complete = GL_FALSE;
+  glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &complete);
+  return complete == GL_TRUE;
+}
+
+// Waits for the driver to finish compiling and linking, then checks for errors and caches the uniforms
+void Shader::Finish()
+{
+  if (!pending)
+    return;
+  pending = false;
+
+  checkCompileErrors(vertexShader, "VERTEX");
+  checkCompileErrors(fragmentShader, "FRAGMENT");
   checkCompileErrors(ID, "PROGRAM");
 
+  GLint linked = GL_FALSE;
+  glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+  if (cache != nullptr && linked)
+    cache->Store(ID, cacheKey);
+
+  // Look every uniform up once so drawing never has to ask the driver
+  cacheUniforms();
+  // Connect the shared uniform blocks to their fixed binding points
+  bindUniformBlocks();
+
   // Delete the now useless Vertex and Fragment Shader objects
   glDeleteShader(vertexShader);
   glDeleteShader(fragmentShader);
+  vertexShader = fragmentShader = 0;
 }
 
-// Activates the Shader Program
+// True if the program linked, only meaningful once it is finished
+bool Shader::Linked() const
+{
+  GLint linked = GL_FALSE;
+  glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+  return linked == GL_TRUE;
+}
+
+// Activates the Shader Program, finishing it first if needed
 void Shader::Activate()
 {
-  glUseProgram(ID);
+  Finish();
+  RenderState::UseProgram(ID);
 }
 
 // Deletes the Shader Program
 void Shader::Delete()
 {
+  if (pending)
+  {
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    pending = false;
+  }
   glDeleteProgram(ID);
 }
 
+// Queries every active uniform of the linked program and caches its location
+void Shader::cacheUniforms()
+{
+  GLint count = 0, maxLength = 0;
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+  // Gather the names first, arrays add a second entry and the table is sized from the total
+  std::vector<std::pair<std::string, GLint>> entries;
+  std::vector<GLchar> name(maxLength > 0 ? maxLength : 1);
+  for (GLint i = 0; i < count; i++)
+  {
+    GLint size;
+    GLenum type;
+    GLsizei length = 0;
+    glGetActiveUniform(ID, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, name.data());
+    std::string uniformName(name.data(), length);
+
+    GLint location = glGetUniformLocation(ID, uniformName.c_str());
+    driverLookups++;
+    // Members of uniform blocks have no location
+    if (location < 0)
+      continue;
+
+    entries.emplace_back(uniformName, location);
+    // Arrays are reported as "name[0]", make them reachable as "name" too
+    if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+      entries.emplace_back(uniformName.substr(0, uniformName.size() - 3), location);
+  }
+
+  // Power of two capacity kept at most half full so probes stay short and a miss always
+  // reaches an empty slot
+  size_t capacity = 8;
+  while (capacity < entries.size() * 2)
+    capacity *= 2;
+  uniformTable.assign(capacity, UniformSlot{0, -1, std::string()});
+  for (const std::pair<std::string, GLint> &entry : entries)
+    insertUniform(entry.first, entry.second);
+}
+
+void Shader::insertUniform(const std::string &name, GLint location)
+{
+  std::uint32_t hash = hash_name(name.c_str());
+  size_t mask = uniformTable.size() - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask)
+  {
+    if (uniformTable[i].location < 0)
+    {
+      uniformTable[i] = UniformSlot{hash, location, name};
+      return;
+    }
+  }
+}
+
+// Connects every shared uniform block the program uses to its binding point
+void Shader::bindUniformBlocks()
+{
+  for (const UniformBlockBinding &block : UNIFORM_BLOCK_BINDINGS)
+  {
+    GLuint index = glGetUniformBlockIndex(ID, block.name);
+    if (index != GL_INVALID_INDEX)
+      glUniformBlockBinding(ID, index, block.binding);
+  }
+}
+
+// Returns the cached location of a uniform, -1 if the program has no such active uniform.
+// The program must be finished, unfinished programs have no uniforms yet
+GLint Shader::GetUniformLocation(const char *name) const
+{
+  if (uniformTable.empty())
+    return -1;
+
+  std::uint32_t hash = hash_name(name);
+  size_t mask = uniformTable.size() - 1;
+  size_t i = hash & mask;
+  for (size_t probes = 0; probes < uniformTable.size() && uniformTable[i].location >= 0; probes++, i = (i + 1) & mask)
+  {
+    if (uniformTable[i].hash == hash && uniformTable[i].name == name)
+      return uniformTable[i].location;
+  }
+  return -1;
+}
+
+// Sets a uniform of the Shader Program, which must be active.
+// Unknown names resolve to -1, which OpenGL silently ignores just like
+// uniforms the compiler optimized away
+void Shader::setMat4(const char *name, const glm::mat4 &value) const
+{
+  glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::setFloat(const char *name, GLfloat value) const
+{
+  glUniform1f(GetUniformLocation(name), value);
+}
+
+void Shader::setInt(const char *name, GLint value) const
+{
+  glUniform1i(GetUniformLocation(name), value);
+}
+
 // Checks for compilation and linking errors
 void Shader::checkCompileErrors(GLuint shader, const std::string &type)
 {
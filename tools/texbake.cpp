@@ -0,0 +1,178 @@
+// Offline texture baker: decodes images once at build time and writes them, with their
+// full mip chains, into a page aligned TexturePack that the engine memory maps.
+//
+//   texbake [--format raw|bc1|bc3|bc7] output.tpack input.jpg...
+//
+// raw keeps the decoded 8 bit RGB/RGBA pixels, the bcN formats block compress every level.
+// Textures are named after their file without directory and extension.
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stb_image.h>
+
+#include "TexturePack.h"
+#include "TextureCompressor.h"
+#include "CompressedImage.h"
+#include "MipChain.h"
+
+// Mip levels of one texture, largest first
+struct BakedTexture
+{
+  TexturePack::Entry entry;
+  std::vector<std::vector<unsigned char>> levels;
+};
+
+// "res/images/img1.jpg" -> "img1"
+static std::string texture_name(const std::string &path)
+{
+  size_t slash = path.find_last_of("/\\");
+  std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+  size_t dot = name.find_last_of('.');
+  return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+static bool bake(const char *path, const std::string &format, BakedTexture &baked)
+{
+  bool raw = format == "raw";
+
+  // Same orientation as Texture, rows bottom first
+  stbi_set_flip_vertically_on_load(true);
+  int width, height, numColCh;
+  if (!stbi_info(path, &width, &height, &numColCh))
+  {
+    std::cerr << "Error: Failed to read " << path << ": " << stbi_failure_reason() << std::endl;
+    return false;
+  }
+  // Raw textures keep RGB or RGBA, the block compressors always take RGBA
+  int channels = (raw && numColCh < 4) ? 3 : 4;
+  unsigned char *bytes = stbi_load(path, &width, &height, &numColCh, channels);
+  if (!bytes)
+  {
+    std::cerr << "Error: Failed to load " << path << ": " << stbi_failure_reason() << std::endl;
+    return false;
+  }
+  std::vector<unsigned char> level(bytes, bytes + (size_t)width * height * channels);
+  stbi_image_free(bytes);
+
+  memset(&baked.entry, 0, sizeof(baked.entry));
+  std::string name = texture_name(path);
+  if (name.size() >= TexturePack::NAME_LENGTH)
+  {
+    std::cerr << "Error: Texture name " << name << " is too long" << std::endl;
+    return false;
+  }
+  strncpy(baked.entry.name, name.c_str(), TexturePack::NAME_LENGTH - 1);
+
+  BlockFormat blockFormat = BLOCK_BC1;
+  if (raw)
+  {
+    baked.entry.internalFormat = channels == 4 ? GL_RGBA8 : GL_RGB8;
+    baked.entry.format = channels == 4 ? GL_RGBA : GL_RGB;
+    baked.entry.type = GL_UNSIGNED_BYTE;
+  }
+  else
+  {
+    blockFormat = format == "bc7" ? BLOCK_BC7 : format == "bc3" ? BLOCK_BC3
+                                                                : BLOCK_BC1;
+    baked.entry.internalFormat = format == "bc7" ? GL_COMPRESSED_RGBA_BPTC_UNORM : format == "bc3" ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+                                                                                                   : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+  }
+
+  // Level 0 followed by the chain below it, filtered on every core
+  std::vector<MipLevel> chain = generate_mip_chain(level.data(), width, height, channels, MIP_FILTER_BOX, false);
+  chain.insert(chain.begin(), MipLevel{width, height, std::move(level)});
+  if (chain.size() > TexturePack::MAX_LEVELS)
+  {
+    std::cerr << "Error: " << path << " needs more than " << TexturePack::MAX_LEVELS << " mip levels" << std::endl;
+    return false;
+  }
+  for (const MipLevel &mip : chain)
+  {
+    TexturePack::Level &info = baked.entry.levels[baked.levels.size()];
+    info.width = (uint32_t)mip.width;
+    info.height = (uint32_t)mip.height;
+    baked.levels.push_back(raw ? mip.pixels : compress_image(mip.pixels.data(), mip.width, mip.height, blockFormat));
+    info.size = baked.levels.back().size();
+  }
+  baked.entry.levelCount = (uint32_t)baked.levels.size();
+
+  std::cout << "Baked " << path << " as " << name << " (" << width << "x" << height << ", "
+            << baked.levels.size() << " levels, " << format << ")" << std::endl;
+  return true;
+}
+
+static uint64_t align_up(uint64_t value)
+{
+  return (value + TexturePack::PACK_ALIGNMENT - 1) / TexturePack::PACK_ALIGNMENT * TexturePack::PACK_ALIGNMENT;
+}
+
+int main(int argc, char **argv)
+{
+  std::string format = "raw";
+  std::vector<const char *> files;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+      format = argv[++i];
+    else
+      files.push_back(argv[i]);
+  }
+
+  if (files.size() < 2 || (format != "raw" && format != "bc1" && format != "bc3" && format != "bc7"))
+  {
+    std::cerr << "Usage: " << argv[0] << " [--format raw|bc1|bc3|bc7] output.tpack input..." << std::endl;
+    return 1;
+  }
+
+  std::vector<BakedTexture> textures(files.size() - 1);
+  for (size_t i = 1; i < files.size(); i++)
+  {
+    if (!bake(files[i], format, textures[i - 1]))
+      return 1;
+  }
+
+  // Assign every level a page aligned offset after the tables
+  uint64_t offset = align_up(sizeof(TexturePack::Header) + textures.size() * sizeof(TexturePack::Entry));
+  for (BakedTexture &texture : textures)
+    for (uint32_t level = 0; level < texture.entry.levelCount; level++)
+    {
+      texture.entry.levels[level].offset = offset;
+      offset = align_up(offset + texture.entry.levels[level].size);
+    }
+
+  // Write to a temporary file first so an interrupted bake never leaves a truncated pack behind
+  std::string temporary = std::string(files[0]) + ".tmp";
+  std::ofstream out(temporary, std::ios::binary);
+  if (!out)
+  {
+    std::cerr << "Error: Failed to open " << temporary << " for writing" << std::endl;
+    return 1;
+  }
+
+  TexturePack::Header header = {{'T', 'P', 'A', 'K'}, TexturePack::VERSION, (uint32_t)textures.size(), 0};
+  out.write((const char *)&header, sizeof(header));
+  for (BakedTexture &texture : textures)
+    out.write((const char *)&texture.entry, sizeof(texture.entry));
+
+  for (BakedTexture &texture : textures)
+    for (uint32_t level = 0; level < texture.entry.levelCount; level++)
+    {
+      // Zero padding up to the level's page
+      std::vector<char> padding((size_t)(texture.entry.levels[level].offset - (uint64_t)out.tellp()), 0);
+      out.write(padding.data(), (std::streamsize)padding.size());
+      out.write((const char *)texture.levels[level].data(), (std::streamsize)texture.levels[level].size());
+    }
+
+  out.close();
+  if (!out || std::rename(temporary.c_str(), files[0]) != 0)
+  {
+    std::cerr << "Error: Failed to write " << files[0] << std::endl;
+    return 1;
+  }
+
+  std::cout << "Wrote " << files[0] << " (" << textures.size() << " textures, " << offset / 1024 << " KiB)" << std::endl;
+  return 0;
+}
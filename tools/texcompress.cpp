@@ -0,0 +1,104 @@
+// Offline texture compressor: converts an image (anything stb_image reads) into a
+// block compressed DDS file with a full mip chain, ready for glCompressedTexImage2D.
+//
+//   texcompress [--format bc1|bc3|bc7] [--filter box|kaiser] [--srgb] [--no-mips] input.jpg output.dds
+//
+// --srgb also filters the mip chain in linear light, so dark and bright texels average correctly.
+// Rows are written bottom row first, the same orientation Texture uploads JPEGs in.
+#include <cstring>
+#include <iterator>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stb_image.h>
+
+#include "TextureCompressor.h"
+#include "MipChain.h"
+
+int main(int argc, char **argv)
+{
+  BlockFormat format = BLOCK_BC1;
+  bool srgb = false;
+  bool mips = true;
+  MipFilter filter = MIP_FILTER_BOX;
+  std::vector<const char *> files;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+    {
+      std::string name = argv[++i];
+      if (name == "bc1")
+        format = BLOCK_BC1;
+      else if (name == "bc3")
+        format = BLOCK_BC3;
+      else if (name == "bc7")
+        format = BLOCK_BC7;
+      else
+      {
+        std::cerr << "Unknown format " << name << ", expected bc1, bc3 or bc7" << std::endl;
+        return 1;
+      }
+    }
+    else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+    {
+      std::string name = argv[++i];
+      if (name == "box")
+        filter = MIP_FILTER_BOX;
+      else if (name == "kaiser")
+        filter = MIP_FILTER_KAISER;
+      else
+      {
+        std::cerr << "Unknown filter " << name << ", expected box or kaiser" << std::endl;
+        return 1;
+      }
+    }
+    else if (strcmp(argv[i], "--srgb") == 0)
+      srgb = true;
+    else if (strcmp(argv[i], "--no-mips") == 0)
+      mips = false;
+    else
+      files.push_back(argv[i]);
+  }
+
+  if (files.size() != 2)
+  {
+    std::cerr << "Usage: " << argv[0] << " [--format bc1|bc3|bc7] [--filter box|kaiser] [--srgb] [--no-mips] input output.dds" << std::endl;
+    return 1;
+  }
+
+  // Same orientation as Texture, so compressed and uncompressed images render alike
+  stbi_set_flip_vertically_on_load(true);
+  int width, height, numColCh;
+  unsigned char *bytes = stbi_load(files[0], &width, &height, &numColCh, 4);
+  if (!bytes)
+  {
+    std::cerr << "Error: Failed to load " << files[0] << ": " << stbi_failure_reason() << std::endl;
+    return 1;
+  }
+
+  std::vector<MipLevel> chain;
+  chain.push_back(MipLevel{width, height, std::vector<unsigned char>(bytes, bytes + (size_t)width * height * 4)});
+  stbi_image_free(bytes);
+  if (mips)
+  {
+    std::vector<MipLevel> below = generate_mip_chain(chain[0].pixels.data(), width, height, 4, filter, srgb);
+    std::move(below.begin(), below.end(), std::back_inserter(chain));
+  }
+
+  std::vector<std::vector<unsigned char>> levels;
+  size_t uncompressedSize = 0, compressedSize = 0;
+  for (const MipLevel &level : chain)
+  {
+    levels.push_back(compress_image(level.pixels.data(), level.width, level.height, format));
+    uncompressedSize += level.pixels.size();
+    compressedSize += levels.back().size();
+  }
+
+  if (!write_dds(files[1], format, srgb, width, height, levels))
+    return 1;
+
+  std::cout << files[0] << " -> " << files[1] << " (" << width << "x" << height << ", " << levels.size()
+            << " levels, " << uncompressedSize / 1024 << " KiB RGBA8 -> " << compressedSize / 1024 << " KiB)" << std::endl;
+  return 0;
+}